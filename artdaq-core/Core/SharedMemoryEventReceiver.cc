@@ -1,63 +1,273 @@
-
 #include "artdaq-core/Core/SharedMemoryEventReceiver.hh"
 
+#include <sys/mman.h>
 #include <sys/time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <thread>
+#include "artdaq-core/Data/EventTOC.hh"
 #include "artdaq-core/Data/Fragment.hh"
 #define TRACE_NAME "SharedMemoryEventReceiver"
 #include "TRACE/tracemf.h"
 
+#define TLVL_PARALLEL 35
+#define TLVL_LOOKAHEAD 36
+
+namespace {
+/// Longest time ReadyForRead blocks in the selector before checking for an end-of-data condition
+constexpr uint64_t END_OF_DATA_CHECK_US = 100000;
+/// Longest time the lookahead worker blocks before checking whether it should stop claiming
+constexpr uint64_t LOOKAHEAD_CHECK_US = 10000;
+/// While waiting for the lookahead worker, how often ReadyForRead checks for broadcasts (as SharedMemorySelector does)
+constexpr uint64_t LOOKAHEAD_BROADCAST_CHECK_US = 1000;
+}  // namespace
+
 artdaq::SharedMemoryEventReceiver::SharedMemoryEventReceiver(uint32_t shm_key, uint32_t broadcast_shm_key)
-    : current_read_buffer_(-1)
-    , initialized_(false)
-    , current_header_(nullptr)
-    , current_data_source_(nullptr)
+    : initialized_(false)
     , data_(shm_key)
     , broadcasts_(broadcast_shm_key)
+    , lookahead_enabled_(false)
+    , lookahead_armed_(false)
+    , lookahead_claiming_(false)
+    , lookahead_stop_(false)
 {
 	TLOG(TLVL_DEBUG + 33) << "SharedMemoryEventReceiver CONSTRUCTOR";
+	// Broadcasts have strict priority over data
+	selector_.AddLane(broadcasts_);
+	selector_.AddLane(data_);
+	SetWaitPolicy(WaitPolicy::Idle());
+}
+
+artdaq::SharedMemoryEventReceiver::~SharedMemoryEventReceiver()
+{
+	stopLookahead_(true);
+}
+
+void artdaq::SharedMemoryEventReceiver::SetLookahead(bool enable)
+{
+	if (!enable)
+	{
+		// An event which was already claimed is still handed out by the next ReadyForRead
+		stopLookahead_(false);
+	}
+	lookahead_enabled_ = enable;
+}
+
+void artdaq::SharedMemoryEventReceiver::startLookahead_()
+{
+	if (!lookahead_enabled_ || data_.GetConsumerGroup() != 0)
+	{
+		return;
+	}
+	if (!lookahead_thread_.joinable())
+	{
+		lookahead_thread_ = std::thread([this]() { lookaheadLoop_(); });
+	}
+	{
+		std::lock_guard<std::mutex> lk(lookahead_mutex_);
+		lookahead_armed_ = true;
+	}
+	lookahead_cv_.notify_all();
+}
+
+void artdaq::SharedMemoryEventReceiver::pauseLookahead_()
+{
+	std::unique_lock<std::mutex> lk(lookahead_mutex_);
+	lookahead_armed_ = false;
+	lookahead_cv_.wait(lk, [this]() { return !lookahead_claiming_; });
+}
+
+void artdaq::SharedMemoryEventReceiver::stopLookahead_(bool give_back)
+{
+	{
+		std::lock_guard<std::mutex> lk(lookahead_mutex_);
+		lookahead_stop_ = true;
+		lookahead_armed_ = false;
+	}
+	lookahead_cv_.notify_all();
+	if (lookahead_thread_.joinable())
+	{
+		lookahead_thread_.join();
+	}
+	lookahead_stop_ = false;
+	if (give_back)
+	{
+		lookahead_.giveBack_();
+	}
+}
+
+void artdaq::SharedMemoryEventReceiver::lookaheadLoop_()
+{
+	// Only data_ and lookahead_ are used here; the selector stays with the calling thread
+	std::unique_lock<std::mutex> lk(lookahead_mutex_);
+	while (true)
+	{
+		lookahead_cv_.wait(lk, [this]() { return lookahead_stop_ || (lookahead_armed_ && !lookahead_.IsHeld()); });
+		if (lookahead_stop_)
+		{
+			break;
+		}
+		lookahead_claiming_ = true;
+		lk.unlock();
+
+		Event claimed;
+		while (lookahead_armed_ && data_.GetConsumerGroup() == 0)
+		{
+			// Read the counter first, so that a buffer marked Full in between is not waited for
+			auto generation = data_.GetFullGeneration();
+			auto buf = data_.GetBufferForReading();
+			if (buf != -1)
+			{
+				claimed.attach_(&data_, buf, false);
+				claimed.adviseWillNeed_();
+				break;
+			}
+			data_.WaitForFullGeneration(generation, LOOKAHEAD_CHECK_US);
+		}
+
+		lk.lock();
+		lookahead_claiming_ = false;
+		// Whether or not a buffer was claimed, the next handover (or a waiting ReadyForRead) arms the worker again
+		lookahead_armed_ = false;
+		if (claimed.IsHeld())
+		{
+			lookahead_.swap_(claimed);
+			TLOG(TLVL_LOOKAHEAD) << "Lookahead claimed buffer " << lookahead_.buffer_ << " with " << lookahead_.index_.size() << " Fragments";
+		}
+		lookahead_cv_.notify_all();
+	}
+}
+
+bool artdaq::SharedMemoryEventReceiver::takeLookahead_(Event& event)
+{
+	{
+		std::lock_guard<std::mutex> lk(lookahead_mutex_);
+		if (!lookahead_.IsHeld())
+		{
+			return false;
+		}
+	}
+	// Broadcasts keep their priority over the claimed event
+	if (acquire_(event, true, 0))
+	{
+		TLOG(TLVL_DEBUG + 33) << "takeLookahead_: Returning broadcast ahead of the lookahead event";
+		return true;
+	}
+	{
+		std::lock_guard<std::mutex> lk(lookahead_mutex_);
+		event.swap_(lookahead_);
+	}
+	bool err = false;
+	if (event.ReadHeader(err) == nullptr || err)
+	{
+		TLOG(TLVL_WARNING) << "takeLookahead_: Lookahead buffer was in incorrect state, dropping it";
+		event.Release();
+		return false;
+	}
+	event.prefetch_();
+	TLOG(TLVL_DEBUG + 33) << "takeLookahead_: Returning lookahead event with sequence ID " << event.header_->sequence_id;
+	return true;
+}
+
+bool artdaq::SharedMemoryEventReceiver::waitLookahead_(Event& event, size_t timeout_us)
+{
+	// Data events only come from the worker, so that they are not taken out of order
+	auto start = std::chrono::steady_clock::now();
+	while (true)
+	{
+		if (takeLookahead_(event) || acquire_(event, true, 0))
+		{
+			return true;
+		}
+		auto elapsed = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+		if (elapsed >= timeout_us)
+		{
+			return false;
+		}
+		if (broadcasts_.IsEndOfData() || data_.IsEndOfData())
+		{
+			TLOG(TLVL_DEBUG + 33) << "End-Of-Data condition detected, returning false";
+			return false;
+		}
+
+		std::unique_lock<std::mutex> lk(lookahead_mutex_);
+		lookahead_armed_ = true;
+		lookahead_cv_.notify_all();
+		lookahead_cv_.wait_for(lk, std::chrono::microseconds(std::min(static_cast<uint64_t>(timeout_us) - elapsed, LOOKAHEAD_BROADCAST_CHECK_US)), [this]() { return lookahead_.IsHeld(); });
+	}
+}
+
+void artdaq::SharedMemoryEventReceiver::SetWaitPolicy(WaitPolicy const& policy)
+{
+	data_.SetWaitPolicy(policy);
+	broadcasts_.SetWaitPolicy(policy);
 }
 
 bool artdaq::SharedMemoryEventReceiver::ReadyForRead(bool broadcast, size_t timeout_us)
 {
 	TLOG(TLVL_DEBUG + 33) << "ReadyForRead BEGIN timeout_us=" << timeout_us;
-	if (current_read_buffer_ != -1 && (current_data_source_ != nullptr) && (current_header_ != nullptr))
+	if (current_.IsHeld())
 	{
 		TLOG(TLVL_DEBUG + 33) << "ReadyForRead Returning true because already reading buffer";
 		return true;
 	}
 
+	bool ret = false;
+	if (!broadcast && lookahead_thread_.joinable() && data_.GetConsumerGroup() == 0)
+	{
+		ret = waitLookahead_(current_, timeout_us);
+	}
+	else
+	{
+		ret = (!broadcast && takeLookahead_(current_)) || acquire_(current_, broadcast, timeout_us);
+	}
+	if (ret && !current_.IsBroadcast())
+	{
+		startLookahead_();
+	}
+	TLOG(TLVL_DEBUG + 33) << "ReadyForRead returning " << std::boolalpha << ret;
+	return ret;
+}
+
+bool artdaq::SharedMemoryEventReceiver::acquire_(Event& event, bool broadcast, size_t timeout_us)
+{
 	bool first = true;
-	auto start_time = TimeUtils::gettimeofday_us();
-	uint64_t time_diff = 0;
-	uint64_t max_sleep = 5000000;  // 5 seconds
-	int buf = -1;
-	while (first || time_diff < timeout_us)
+	auto waiter = data_.GetWaitPolicy().MakeWaiter();
+	uint64_t elapsed = 0;
+	while (first || (elapsed = waiter.ElapsedMicroseconds()) < timeout_us)
 	{
-		if (broadcasts_.ReadyForRead())
+		// While the wait policy spins, only poll the lanes. Afterwards, block in the selector until a buffer is marked Full.
+		auto block_us = first || waiter.Spinning() ? 0 : std::min(timeout_us - elapsed, END_OF_DATA_CHECK_US);
+		auto lane = selector_.Select(block_us, broadcast ? 1 : 2);
+		int buf = -1;
+		if (lane == 0)
 		{
 			buf = broadcasts_.GetBufferForReading();
-			current_data_source_ = &broadcasts_;
 		}
-		else if (!broadcast && data_.ReadyForRead())
+		else if (lane == 1)
 		{
 			buf = data_.GetBufferForReading();
-			current_data_source_ = &data_;
 		}
-		if (buf != -1 && (current_data_source_ != nullptr))
+		if (buf != -1)
 		{
-			current_read_buffer_ = buf;
-			current_data_source_->ResetReadPos(buf);
-			current_header_ = reinterpret_cast<detail::RawEventHeader*>(current_data_source_->GetReadPos(buf));  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
-			TLOG(TLVL_DEBUG + 33) << "ReadyForRead Found buffer, returning true. event hdr sequence_id=" << current_header_->sequence_id;
+			event.attach_(lane == 0 ? &broadcasts_ : &data_, buf, lane == 0);
+			TLOG(TLVL_DEBUG + 33) << "acquire_ Found buffer " << buf << ", event hdr sequence_id=" << event.header_->sequence_id;
 
 			// Ignore any Init fragments after the first
-			if (current_data_source_ == &broadcasts_)
+			if (event.IsBroadcast())
 			{
 				bool err;
-				auto types = GetFragmentTypes(err);
+				auto types = event.GetFragmentTypes(err);
 				if (!err && (types.count(Fragment::type_t(Fragment::InitFragmentType)) != 0u) && initialized_)
 				{
-					ReleaseBuffer();
+					event.Release();
 					continue;
 				}
 				if (!err && (types.count(Fragment::type_t(Fragment::InitFragmentType)) != 0u))
@@ -68,116 +278,596 @@ bool artdaq::SharedMemoryEventReceiver::ReadyForRead(bool broadcast, size_t time
 
 			return true;
 		}
-		current_data_source_ = nullptr;
 		first = false;
 
-		if (broadcasts_.IsEndOfData() || data_.IsEndOfData())
+		if (!waiter.Spinning() && (broadcasts_.IsEndOfData() || data_.IsEndOfData()))
 		{
 			TLOG(TLVL_DEBUG + 33) << "End-Of-Data condition detected, returning false";
 			return false;
 		}
 
-		time_diff = TimeUtils::gettimeofday_us() - start_time;
-		auto sleep_time = time_diff;
-		if (sleep_time < 10000) sleep_time = 10000;
-		if (sleep_time > max_sleep) sleep_time = max_sleep;
-		usleep(sleep_time);
+		if (waiter.Spinning())
+		{
+			waiter.Wait();
+		}
 	}
-	TLOG(TLVL_DEBUG + 33) << "ReadyForRead returning false";
 	return false;
 }
 
-artdaq::detail::RawEventHeader* artdaq::SharedMemoryEventReceiver::ReadHeader(bool& err)
+size_t artdaq::SharedMemoryEventReceiver::ParallelReceive(size_t threads, size_t window, std::function<void(Event&)> const& process, std::function<bool(Event&)> const& deliver, size_t timeout_us)
+{
+	struct Task
+	{
+		Event event;
+		bool done{false};
+		std::exception_ptr error;
+	};
+
+	// An event claimed by lookahead is dispatched first; no more are claimed while the workers run
+	pauseLookahead_();
+	threads = std::max(threads, static_cast<size_t>(1));
+	window = std::max(window, static_cast<size_t>(1));
+	TLOG(TLVL_PARALLEL) << "ParallelReceive BEGIN threads=" << threads << ", window=" << window;
+
+	std::mutex mutex;
+	std::condition_variable work_cv;
+	std::condition_variable done_cv;
+	std::deque<Task*> queue;
+	std::multimap<Fragment::sequence_id_t, std::unique_ptr<Task>> in_flight;  // Ordered by sequence ID; the first entry is delivered next
+	bool stopping = false;
+
+	auto worker = [&]() {
+		std::unique_lock<std::mutex> lk(mutex);
+		while (true)
+		{
+			work_cv.wait(lk, [&]() { return stopping || !queue.empty(); });
+			if (queue.empty())
+			{
+				return;
+			}
+			auto task = queue.front();
+			queue.pop_front();
+			lk.unlock();
+			try
+			{
+				process(task->event);
+			}
+			catch (...)
+			{
+				task->error = std::current_exception();
+			}
+			lk.lock();
+			task->done = true;
+			done_cv.notify_all();
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (size_t ii = 0; ii < threads; ++ii)
+	{
+		workers.emplace_back(worker);
+	}
+	// Stop and join the workers however this function exits; held events are released by their destructors
+	struct Joiner
+	{
+		std::function<void()> join;
+		~Joiner() { join(); }
+	} joiner{[&]() {
+		{
+			std::lock_guard<std::mutex> lk(mutex);
+			stopping = true;
+			queue.clear();
+		}
+		work_cv.notify_all();
+		for (auto& thread : workers)
+		{
+			thread.join();
+		}
+	}};
+
+	size_t delivered = 0;
+	bool running = true;
+	std::exception_ptr error;
+
+	// Deliver processed events from the front of the window. With all set, wait for every held event.
+	auto drain = [&](bool all) {
+		while (true)
+		{
+			std::unique_ptr<Task> task;
+			{
+				std::unique_lock<std::mutex> lk(mutex);
+				if (all || in_flight.size() >= window)
+				{
+					done_cv.wait(lk, [&]() { return in_flight.empty() || in_flight.begin()->second->done; });
+				}
+				if (in_flight.empty() || !in_flight.begin()->second->done)
+				{
+					return;
+				}
+				task = std::move(in_flight.begin()->second);
+				in_flight.erase(in_flight.begin());
+			}
+			if (task->error && !error)
+			{
+				error = task->error;
+				running = false;
+			}
+			if (running && !task->error)
+			{
+				++delivered;
+				running = deliver(task->event);
+			}
+			task->event.Release();
+		}
+	};
+
+	while (running)
+	{
+		drain(false);
+		if (!running)
+		{
+			break;
+		}
+
+		auto task = std::make_unique<Task>();
+		if (!takeLookahead_(task->event) && !acquire_(task->event, false, timeout_us))
+		{
+			TLOG(TLVL_PARALLEL) << "ParallelReceive: No event received (end of data or timeout)";
+			break;
+		}
+
+		if (task->event.IsBroadcast())
+		{
+			// Everything received before the broadcast is handed back first
+			drain(true);
+			if (running)
+			{
+				++delivered;
+				running = deliver(task->event);
+			}
+			continue;
+		}
+
+		bool err = false;
+		auto hdr = task->event.ReadHeader(err);
+		if (err || hdr == nullptr)
+		{
+			TLOG(TLVL_WARNING) << "ParallelReceive: Buffer was in incorrect state, skipping it";
+			continue;
+		}
+		TLOG(TLVL_PARALLEL) << "ParallelReceive: Dispatching event with sequence ID " << hdr->sequence_id;
+		std::lock_guard<std::mutex> lk(mutex);
+		queue.push_back(task.get());
+		in_flight.emplace(hdr->sequence_id, std::move(task));
+		work_cv.notify_one();
+	}
+	drain(true);
+
+	TLOG(TLVL_PARALLEL) << "ParallelReceive END, delivered " << delivered << " events";
+	if (error)
+	{
+		std::rethrow_exception(error);
+	}
+	return delivered;
+}
+
+void artdaq::SharedMemoryEventReceiver::Event::attach_(SharedMemoryManager* source, int buffer, bool broadcast)
+{
+	Release();
+	source_ = source;
+	buffer_ = buffer;
+	broadcast_ = broadcast;
+	source_->ResetReadPos(buffer);
+	header_ = reinterpret_cast<detail::RawEventHeader*>(source_->GetReadPos(buffer));  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	buildIndex_();
+}
+
+void artdaq::SharedMemoryEventReceiver::Event::giveBack_()
+{
+	if (source_ != nullptr && buffer_ != -1 && source_->CheckBuffer(buffer_, SharedMemoryManager::BufferSemaphoreFlags::Reading))
+	{
+		TLOG(TLVL_DEBUG + 33) << "giveBack_: Marking unread buffer " << buffer_ << " Full again";
+		source_->MarkBufferFull(buffer_);
+	}
+	forget_();
+}
+
+void artdaq::SharedMemoryEventReceiver::Event::swap_(Event& other)
+{
+	std::swap(buffer_, other.buffer_);
+	std::swap(broadcast_, other.broadcast_);
+	std::swap(header_, other.header_);
+	std::swap(source_, other.source_);
+	pieces_.swap(other.pieces_);
+	index_.swap(other.index_);
+	std::swap(index_valid_, other.index_valid_);
+	view_storage_.swap(other.view_storage_);
+}
+
+void artdaq::SharedMemoryEventReceiver::Event::prefetch_() const
+{
+	// Bring the event header and each Fragment header, with the start of its payload, into this core's cache
+	__builtin_prefetch(header_);
+	for (auto const& entry : index_)
+	{
+		auto offset = entry.offset;
+		for (auto const& piece : pieces_)
+		{
+			if (offset < piece.second)
+			{
+				__builtin_prefetch(piece.first + offset);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+				if (offset + sizeof(detail::RawFragmentHeader) < piece.second)
+				{
+					__builtin_prefetch(piece.first + offset + sizeof(detail::RawFragmentHeader));  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+				}
+				break;
+			}
+			offset -= piece.second;
+		}
+	}
+}
+
+void artdaq::SharedMemoryEventReceiver::Event::adviseWillNeed_() const
+{
+	static auto const page_size = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+	for (auto const& piece : pieces_)
+	{
+		auto begin = reinterpret_cast<uintptr_t>(piece.first) & ~(page_size - 1);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+		auto end = reinterpret_cast<uintptr_t>(piece.first) + piece.second;        // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+		if (end > begin && madvise(reinterpret_cast<void*>(begin), end - begin, MADV_WILLNEED) != 0)  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,performance-no-int-to-ptr)
+		{
+			TLOG(TLVL_LOOKAHEAD) << "adviseWillNeed_: madvise failed: " << strerror(errno);
+		}
+	}
+}
+
+void artdaq::SharedMemoryEventReceiver::Event::forget_()
+{
+	buffer_ = -1;
+	broadcast_ = false;
+	header_ = nullptr;
+	source_ = nullptr;
+	pieces_.clear();
+	index_.clear();
+	index_valid_ = false;
+	view_storage_.clear();
+}
+
+void artdaq::SharedMemoryEventReceiver::Event::checkHeld_(char const* caller) const
+{
+	if (!IsHeld())
+	{
+		throw cet::exception("AccessViolation") << "Cannot call " << caller << " when not currently reading a buffer! Call ReadHeader() first!";  // NOLINT(cert-err60-cpp)
+	}
+}
+
+void artdaq::SharedMemoryEventReceiver::Event::Release()
+{
+	TLOG(TLVL_DEBUG + 33) << "Release BEGIN";
+	try
+	{
+		if (source_ != nullptr)
+		{
+			source_->MarkBufferEmpty(buffer_, false, false);
+		}
+	}
+	catch (cet::exception const& e)
+	{
+		TLOG(TLVL_WARNING) << "A cet::exception occured while trying to release the buffer: " << e;
+	}
+	catch (...)
+	{
+		TLOG(TLVL_ERROR) << "An unknown exception occured while trying to release the buffer";
+	}
+	forget_();
+	TLOG(TLVL_DEBUG + 33) << "Release END";
+}
+
+artdaq::detail::RawEventHeader* artdaq::SharedMemoryEventReceiver::Event::ReadHeader(bool& err)
 {
 	TLOG(TLVL_DEBUG + 33) << "ReadHeader BEGIN";
-	if (current_read_buffer_ != -1 && (current_data_source_ != nullptr))
+	if (buffer_ != -1 && (source_ != nullptr))
 	{
-		err = !current_data_source_->CheckBuffer(current_read_buffer_, SharedMemoryManager::BufferSemaphoreFlags::Reading);
+		err = !source_->CheckBuffer(buffer_, SharedMemoryManager::BufferSemaphoreFlags::Reading);
 		if (err)
 		{
 			TLOG(TLVL_WARNING) << "Buffer was in incorrect state, resetting";
-			current_data_source_ = nullptr;
-			current_read_buffer_ = -1;
-			current_header_ = nullptr;
+			forget_();
 			return nullptr;
 		}
 	}
 	TLOG(TLVL_DEBUG + 33) << "Already have buffer, returning stored header";
-	return current_header_;
+	return header_;
+}
+
+std::set<artdaq::Fragment::type_t> artdaq::SharedMemoryEventReceiver::Event::GetFragmentTypes(bool& err)
+{
+	checkHeld_("GetFragmentTypes");
+
+	auto output = std::set<Fragment::type_t>();
+	err = !checkIndex_();
+	if (err)
+	{
+		return output;
+	}
+
+	for (auto const& entry : index_)
+	{
+		output.insert(entry.type);
+	}
+	return output;
 }
 
-std::set<artdaq::Fragment::type_t> artdaq::SharedMemoryEventReceiver::GetFragmentTypes(bool& err)
+std::vector<artdaq::SharedMemoryEventReceiver::FragmentIndexEntry> artdaq::SharedMemoryEventReceiver::Event::GetFragmentIndex(bool& err)
 {
-	if (current_read_buffer_ == -1 || (current_header_ == nullptr) || (current_data_source_ == nullptr))
+	checkHeld_("GetFragmentIndex");
+	err = !checkIndex_();
+	if (err)
 	{
-		throw cet::exception("AccessViolation") << "Cannot call GetFragmentTypes when not currently reading a buffer! Call ReadHeader() first!";  // NOLINT(cert-err60-cpp)
+		return std::vector<FragmentIndexEntry>();
 	}
+	return index_;
+}
 
-	err = !current_data_source_->CheckBuffer(current_read_buffer_, SharedMemoryManager::BufferSemaphoreFlags::Reading);
+std::unique_ptr<artdaq::Fragments> artdaq::SharedMemoryEventReceiver::Event::GetFragmentsByType(bool& err, Fragment::type_t type)
+{
+	checkHeld_("GetFragmentsByType");
+	err = !checkIndex_();
 	if (err)
 	{
-		return std::set<Fragment::type_t>();
+		return nullptr;
 	}
 
-	current_data_source_->ResetReadPos(current_read_buffer_);
-	current_data_source_->IncrementReadPos(current_read_buffer_, sizeof(detail::RawEventHeader));
-	auto output = std::set<Fragment::type_t>();
+	std::unique_ptr<Fragments> output(new Fragments());
 
-	while (current_data_source_->MoreDataInBuffer(current_read_buffer_))
+	for (auto const& entry : index_)
 	{
-		err = !current_data_source_->CheckBuffer(current_read_buffer_, SharedMemoryManager::BufferSemaphoreFlags::Reading);
-		if (err)
+		if (entry.type == type || type == Fragment::InvalidFragmentType)
 		{
-			return std::set<Fragment::type_t>();
+			output->emplace_back(entry.word_count - detail::RawFragmentHeader::num_words());
+			gather_(pieces_, entry.offset, output->back().headerAddress(), entry.word_count * sizeof(RawDataType));
+			output->back().autoResize();
 		}
-		auto fragHdr = reinterpret_cast<artdaq::detail::RawFragmentHeader*>(current_data_source_->GetReadPos(current_read_buffer_));  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
-		output.insert(fragHdr->type);
-		current_data_source_->IncrementReadPos(current_read_buffer_, fragHdr->word_count * sizeof(RawDataType));
 	}
 
 	return output;
 }
 
-std::unique_ptr<artdaq::Fragments> artdaq::SharedMemoryEventReceiver::GetFragmentsByType(bool& err, Fragment::type_t type)
+artdaq::FragmentViews artdaq::SharedMemoryEventReceiver::Event::GetFragmentViewsByType(bool& err, Fragment::type_t type)
 {
-	if ((current_data_source_ == nullptr) || (current_header_ == nullptr) || current_read_buffer_ == -1)
+	checkHeld_("GetFragmentViewsByType");
+	err = !checkIndex_();
+	if (err)
+	{
+		return FragmentViews();
+	}
+
+	FragmentViews output;
+	for (auto const& entry : index_)
 	{
-		throw cet::exception("AccessViolation") << "Cannot call GetFragmentsByType when not currently reading a buffer! Call ReadHeader() first!";  // NOLINT(cert-err60-cpp)
+		if (entry.type == type || type == Fragment::InvalidFragmentType)
+		{
+			output.push_back(viewAt_(entry));
+		}
 	}
-	err = !current_data_source_->CheckBuffer(current_read_buffer_, SharedMemoryManager::BufferSemaphoreFlags::Reading);
+
+	return output;
+}
+
+std::unique_ptr<artdaq::Fragments> artdaq::SharedMemoryEventReceiver::Event::GetFragmentsBySelection(bool& err, FragmentSelection const& selection)
+{
+	checkHeld_("GetFragmentsBySelection");
+	err = !checkIndex_();
 	if (err)
 	{
 		return nullptr;
 	}
 
-	current_data_source_->ResetReadPos(current_read_buffer_);
-	current_data_source_->IncrementReadPos(current_read_buffer_, sizeof(detail::RawEventHeader));
-
 	std::unique_ptr<Fragments> output(new Fragments());
+	for (auto const& entry : index_)
+	{
+		if (selects_(entry, selection))
+		{
+			output->emplace_back(entry.word_count - detail::RawFragmentHeader::num_words());
+			gather_(pieces_, entry.offset, output->back().headerAddress(), entry.word_count * sizeof(RawDataType));
+			output->back().autoResize();
+		}
+	}
+	TLOG(TLVL_DEBUG + 34) << "GetFragmentsBySelection: Selected " << output->size() << " of " << index_.size() << " Fragments";
+	return output;
+}
 
-	while (current_data_source_->MoreDataInBuffer(current_read_buffer_))
+artdaq::FragmentViews artdaq::SharedMemoryEventReceiver::Event::GetFragmentViewsBySelection(bool& err, FragmentSelection const& selection)
+{
+	checkHeld_("GetFragmentViewsBySelection");
+	err = !checkIndex_();
+	if (err)
 	{
-		err = !current_data_source_->CheckBuffer(current_read_buffer_, SharedMemoryManager::BufferSemaphoreFlags::Reading);
-		if (err)
+		return FragmentViews();
+	}
+
+	FragmentViews output;
+	for (auto const& entry : index_)
+	{
+		if (selects_(entry, selection))
 		{
-			return nullptr;
+			output.push_back(viewAt_(entry));
+		}
+	}
+	TLOG(TLVL_DEBUG + 34) << "GetFragmentViewsBySelection: Selected " << output.size() << " of " << index_.size() << " Fragments";
+	return output;
+}
+
+bool artdaq::SharedMemoryEventReceiver::Event::selects_(FragmentIndexEntry const& entry, FragmentSelection const& selection) const
+{
+	if (!selection.Matches(entry.type, entry.fragment_id))
+	{
+		return false;
+	}
+	if (!selection.HasTimestampRange())
+	{
+		return true;
+	}
+
+	// Only the header is read, even if the Fragment is split across buffers
+	detail::RawFragmentHeader fragHdr;
+	gather_(pieces_, entry.offset, &fragHdr, sizeof(fragHdr));
+	Fragment::timestamp_t timestamp = fragHdr.timestamp;
+	if (fragHdr.version == 0)
+	{
+		detail::RawFragmentHeaderV0 oldHdr;
+		gather_(pieces_, entry.offset, &oldHdr, sizeof(oldHdr));
+		timestamp = oldHdr.upgrade().timestamp;
+	}
+	else if (fragHdr.version == 1)
+	{
+		detail::RawFragmentHeaderV1 oldHdr;
+		gather_(pieces_, entry.offset, &oldHdr, sizeof(oldHdr));
+		timestamp = oldHdr.upgrade().timestamp;
+	}
+	return selection.MatchesTimestamp(timestamp);
+}
+
+bool artdaq::SharedMemoryEventReceiver::Event::buildIndex_()
+{
+	index_.clear();
+	index_valid_ = false;
+	pieces_ = source_->GetGatherView(buffer_);
+	size_t total = 0;
+	for (auto const& piece : pieces_)
+	{
+		total += piece.second;
+	}
+
+	size_t pos = sizeof(detail::RawEventHeader);
+	if (pos + sizeof(detail::RawFragmentHeader) <= total)
+	{
+		detail::RawFragmentHeader tocHdr;
+		gather_(pieces_, pos, &tocHdr, sizeof(tocHdr));
+		if (tocHdr.type == Fragment::EventTOCFragmentType)
+		{
+			if (indexFromTOC_(pos, tocHdr.word_count, total))
+			{
+				index_valid_ = true;
+				return true;
+			}
+			TLOG(TLVL_WARNING) << "buildIndex_: Ignoring malformed EventTOC, walking the Fragment headers instead";
+			index_.clear();
 		}
-		auto fragHdr = reinterpret_cast<artdaq::detail::RawFragmentHeader*>(current_data_source_->GetReadPos(current_read_buffer_));  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
-		if (fragHdr->type == type || type == Fragment::InvalidFragmentType)
+	}
+
+	while (pos + sizeof(detail::RawFragmentHeader) <= total)
+	{
+		detail::RawFragmentHeader fragHdr;
+		gather_(pieces_, pos, &fragHdr, sizeof(fragHdr));
+		size_t word_count = fragHdr.word_count;
+		if (word_count == 0 || pos + word_count * sizeof(RawDataType) > total)
 		{
-			output->emplace_back(fragHdr->word_count - detail::RawFragmentHeader::num_words());
-			current_data_source_->Read(current_read_buffer_, output->back().headerAddress(), fragHdr->word_count * sizeof(RawDataType));
-			output->back().autoResize();
+			TLOG(TLVL_WARNING) << "buildIndex_: Fragment at offset " << pos << " with " << word_count << " words does not fit in the event (" << total << " bytes)";
+			index_.clear();
+			return false;
 		}
-		else
+		if (fragHdr.type != Fragment::EventTOCFragmentType)
 		{
-			current_data_source_->IncrementReadPos(current_read_buffer_, fragHdr->word_count * sizeof(RawDataType));
+			index_.push_back(FragmentIndexEntry{pos, static_cast<Fragment::type_t>(fragHdr.type), static_cast<Fragment::fragment_id_t>(fragHdr.fragment_id), word_count});
 		}
+		pos += word_count * sizeof(RawDataType);
 	}
+	TLOG(TLVL_DEBUG + 34) << "buildIndex_: Indexed " << index_.size() << " Fragments in " << pieces_.size() << " buffer(s)";
+	index_valid_ = true;
+	return true;
+}
 
-	return output;
+bool artdaq::SharedMemoryEventReceiver::Event::indexFromTOC_(size_t pos, size_t word_count, size_t total)
+{
+	if (word_count == 0 || pos + word_count * sizeof(RawDataType) > total)
+	{
+		return false;
+	}
+	try
+	{
+		EventTOC toc(viewAt_(FragmentIndexEntry{pos, Fragment::EventTOCFragmentType, Fragment::InvalidFragmentID, word_count}));
+		// The entries must tile the rest of the event exactly
+		size_t expected = pos + word_count * sizeof(RawDataType);
+		index_.reserve(toc.size());
+		for (auto const& entry : toc)
+		{
+			if (entry.offset != expected || entry.word_count == 0 || expected + entry.word_count * sizeof(RawDataType) > total)
+			{
+				TLOG(TLVL_WARNING) << "indexFromTOC_: EventTOC entry at offset " << entry.offset << " with " << entry.word_count << " words does not match the event layout";
+				return false;
+			}
+			index_.push_back(FragmentIndexEntry{entry.offset, entry.type, entry.fragment_id, entry.word_count});
+			expected += entry.word_count * sizeof(RawDataType);
+		}
+		if (expected != total)
+		{
+			TLOG(TLVL_WARNING) << "indexFromTOC_: EventTOC covers " << expected << " bytes of a " << total << " byte event";
+			return false;
+		}
+	}
+	catch (cet::exception const& e)
+	{
+		TLOG(TLVL_WARNING) << "indexFromTOC_: " << e;
+		return false;
+	}
+	TLOG(TLVL_DEBUG + 34) << "indexFromTOC_: Indexed " << index_.size() << " Fragments from the EventTOC";
+	return true;
+}
+
+bool artdaq::SharedMemoryEventReceiver::Event::checkIndex_()
+{
+	return index_valid_ && source_->CheckBuffer(buffer_, SharedMemoryManager::BufferSemaphoreFlags::Reading);
+}
+
+artdaq::FragmentView artdaq::SharedMemoryEventReceiver::Event::viewAt_(FragmentIndexEntry const& entry)
+{
+	auto bytes = entry.word_count * sizeof(RawDataType);
+	auto offset = entry.offset;
+	for (auto const& piece : pieces_)
+	{
+		if (offset >= piece.second)
+		{
+			offset -= piece.second;
+			continue;
+		}
+		auto addr = piece.first + offset;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		if (bytes <= piece.second - offset && reinterpret_cast<uintptr_t>(addr) % alignof(RawDataType) == 0)  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+		{
+			return FragmentView(reinterpret_cast<RawDataType const*>(addr));  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+		}
+		break;
+	}
+
+	TLOG(TLVL_DEBUG + 34) << "viewAt_: Fragment at offset " << entry.offset << " is split across buffers, copying " << bytes << " bytes";
+	view_storage_.emplace_back(entry.word_count);
+	gather_(pieces_, entry.offset, view_storage_.back().data(), bytes);
+	return FragmentView(view_storage_.back().data());
+}
+
+void artdaq::SharedMemoryEventReceiver::Event::gather_(std::vector<std::pair<uint8_t const*, size_t>> const& pieces, size_t offset, void* data, size_t size)
+{
+	auto out = static_cast<uint8_t*>(data);
+	for (auto const& piece : pieces)
+	{
+		if (size == 0)
+		{
+			break;
+		}
+		if (offset >= piece.second)
+		{
+			offset -= piece.second;
+			continue;
+		}
+		auto count = std::min(size, piece.second - offset);
+		memcpy(out, piece.first + offset, count);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		out += count;                              // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		size -= count;
+		offset = 0;
+	}
 }
 
+
 std::string artdaq::SharedMemoryEventReceiver::printBuffers_(SharedMemoryManager* data_source)
 {
 	std::ostringstream ostr;
@@ -223,27 +913,3 @@ std::string artdaq::SharedMemoryEventReceiver::toString()
 
 	return ostr.str();
 }
-
-void artdaq::SharedMemoryEventReceiver::ReleaseBuffer()
-{
-	TLOG(TLVL_DEBUG + 33) << "ReleaseBuffer BEGIN";
-	try
-	{
-		if (current_data_source_ != nullptr)
-		{
-			current_data_source_->MarkBufferEmpty(current_read_buffer_, false, false);
-		}
-	}
-	catch (cet::exception const& e)
-	{
-		TLOG(TLVL_WARNING) << "A cet::exception occured while trying to release the buffer: " << e;
-	}
-	catch (...)
-	{
-		TLOG(TLVL_ERROR) << "An unknown exception occured while trying to release the buffer";
-	}
-	current_read_buffer_ = -1;
-	current_header_ = nullptr;
-	current_data_source_ = nullptr;
-	TLOG(TLVL_DEBUG + 33) << "ReleaseBuffer END";
-}
@@ -1,10 +1,20 @@
 #ifndef artdaq_core_Core_SharedMemoryEventReceiver_hh
 #define artdaq_core_Core_SharedMemoryEventReceiver_hh 1
 
+#include <atomic>
+#include <bitset>
+#include <condition_variable>
+#include <functional>
+#include <limits>
+#include <list>
+#include <mutex>
 #include <set>
+#include <thread>
 
 #include "artdaq-core/Core/SharedMemoryManager.hh"
+#include "artdaq-core/Core/SharedMemorySelector.hh"
 #include "artdaq-core/Data/Fragment.hh"
+#include "artdaq-core/Data/FragmentView.hh"
 #include "artdaq-core/Data/RawEvent.hh"
 
 namespace artdaq {
@@ -14,6 +24,173 @@ namespace artdaq {
 class SharedMemoryEventReceiver
 {
 public:
+	/**
+	 * \brief Location and identity of one Fragment in the event being read
+	 */
+	struct FragmentIndexEntry
+	{
+		size_t offset;                        ///< Offset of the Fragment header from the start of the event, in bytes
+		Fragment::type_t type;                ///< Type of the Fragment
+		Fragment::fragment_id_t fragment_id;  ///< Fragment ID of the Fragment
+		size_t word_count;                    ///< Size of the Fragment, in RawDataType words
+	};
+
+	/**
+	 * \brief Which Fragments of an event to return from GetFragmentsBySelection and GetFragmentViewsBySelection
+	 *
+	 * A Fragment is selected if it passes every criterion. The type and Fragment ID criteria are checked against the
+	 * Fragment index; the timestamp range, if set, is checked against the Fragment header in shared memory. Only
+	 * selected Fragments are copied or viewed.
+	 */
+	struct FragmentSelection
+	{
+		std::bitset<256> type_mask;                                                                       ///< Types to select. If no bit is set, every type is selected.
+		std::set<Fragment::fragment_id_t> fragment_ids;                                                   ///< Fragment IDs to select. If empty, every Fragment ID is selected.
+		Fragment::fragment_id_t first_fragment_id{0};                                                     ///< Lowest Fragment ID to select
+		Fragment::fragment_id_t last_fragment_id{std::numeric_limits<Fragment::fragment_id_t>::max()};    ///< Highest Fragment ID to select
+		Fragment::timestamp_t first_timestamp{0};                                                         ///< Lowest timestamp to select
+		Fragment::timestamp_t last_timestamp{std::numeric_limits<Fragment::timestamp_t>::max()};          ///< Highest timestamp to select
+
+		/**
+		 * \brief Whether a Fragment with the given type and Fragment ID passes the type and Fragment ID criteria
+		 * \param type Type of the Fragment
+		 * \param fragment_id Fragment ID of the Fragment
+		 * \return True if the Fragment passes
+		 */
+		bool Matches(Fragment::type_t type, Fragment::fragment_id_t fragment_id) const
+		{
+			return (type_mask.none() || type_mask.test(type)) && fragment_id >= first_fragment_id && fragment_id <= last_fragment_id &&
+			       (fragment_ids.empty() || fragment_ids.count(fragment_id) != 0u);
+		}
+
+		/**
+		 * \brief Whether a timestamp is within the timestamp range
+		 * \param timestamp Timestamp of the Fragment
+		 * \return True if the timestamp passes
+		 */
+		bool MatchesTimestamp(Fragment::timestamp_t timestamp) const { return timestamp >= first_timestamp && timestamp <= last_timestamp; }
+
+		/**
+		 * \brief Whether the timestamp range excludes any timestamp, so that Fragment headers have to be read
+		 * \return True if a timestamp range is set
+		 */
+		bool HasTimestampRange() const { return first_timestamp != 0 || last_timestamp != std::numeric_limits<Fragment::timestamp_t>::max(); }
+	};
+
+	/**
+	 * \brief One event held for reading, with its Fragment index
+	 *
+	 * The receiver keeps one Event for ReadyForRead and the accessors below; ParallelReceive holds several at once,
+	 * so that they can be processed on different threads. An Event's methods may be called from any one thread at a time.
+	 */
+	class Event
+	{
+	public:
+		Event() = default;
+		~Event() { Release(); }
+
+		/**
+		 * \brief Whether the Event currently holds a buffer
+		 * \return True if a buffer is held
+		 */
+		bool IsHeld() const { return buffer_ != -1 && source_ != nullptr && header_ != nullptr; }
+
+		/**
+		 * \brief Whether the held buffer came from the broadcast segment
+		 * \return True for a broadcast
+		 */
+		bool IsBroadcast() const { return broadcast_; }
+
+		/**
+		 * \brief Get the Event header
+		 * \param err Flag used to indicate if an error has occurred
+		 * \return Pointer to RawEventHeader from buffer
+		 */
+		detail::RawEventHeader* ReadHeader(bool& err);
+
+		/**
+		 * \brief Get the index of the Fragments in the event (see SharedMemoryEventReceiver::GetFragmentIndex)
+		 * \param err Flag used to indicate if an error has occurred
+		 * \return One FragmentIndexEntry per Fragment, in the order they appear in the event
+		 */
+		std::vector<FragmentIndexEntry> GetFragmentIndex(bool& err);
+
+		/**
+		 * \brief Get a set of Fragment Types present in the event
+		 * \param err Flag used to indicate if an error has occurred
+		 * \return std::set of Fragment::type_t of all Fragment types in the event
+		 */
+		std::set<Fragment::type_t> GetFragmentTypes(bool& err);
+
+		/**
+		 * \brief Get a pointer to the Fragments of a given type in the event
+		 * \param err Flag used to indicate if an error has occurred
+		 * \param type Type of Fragments to get. (Use InvalidFragmentType to get all Fragments)
+		 * \return std::unique_ptr to a Fragments object containing returned Fragment objects
+		 */
+		std::unique_ptr<Fragments> GetFragmentsByType(bool& err, Fragment::type_t type);
+
+		/**
+		 * \brief Get read-only views of the Fragments of a given type in the event, without copying them
+		 * \param err Flag used to indicate if an error has occurred
+		 * \param type Type of Fragments to get. (Use InvalidFragmentType to get all Fragments)
+		 * \return FragmentViews pointing into the held buffer. They are valid until Release is called.
+		 */
+		FragmentViews GetFragmentViewsByType(bool& err, Fragment::type_t type);
+
+		/**
+		 * \brief Get copies of the selected Fragments in the event (see SharedMemoryEventReceiver::GetFragmentsBySelection)
+		 * \param err Flag used to indicate if an error has occurred
+		 * \param selection Which Fragments to copy
+		 * \return std::unique_ptr to a Fragments object containing the selected Fragments, in event order
+		 */
+		std::unique_ptr<Fragments> GetFragmentsBySelection(bool& err, FragmentSelection const& selection);
+
+		/**
+		 * \brief Get read-only views of the selected Fragments in the event (see SharedMemoryEventReceiver::GetFragmentViewsBySelection)
+		 * \param err Flag used to indicate if an error has occurred
+		 * \param selection Which Fragments to view
+		 * \return FragmentViews of the selected Fragments, in event order. They are valid until the Event is released.
+		 */
+		FragmentViews GetFragmentViewsBySelection(bool& err, FragmentSelection const& selection);
+
+		/**
+		 * \brief Release the held buffer to the Empty state
+		 */
+		void Release();
+
+	private:
+		Event(Event const&) = delete;
+		Event(Event&&) = delete;
+		Event& operator=(Event const&) = delete;
+		Event& operator=(Event&&) = delete;
+
+		friend class SharedMemoryEventReceiver;
+
+		void attach_(SharedMemoryManager* source, int buffer, bool broadcast);
+		void giveBack_();
+		void swap_(Event& other);
+		void prefetch_() const;
+		void adviseWillNeed_() const;
+		void forget_();
+		void checkHeld_(char const* caller) const;
+		bool buildIndex_();
+		bool indexFromTOC_(size_t pos, size_t word_count, size_t total);
+		bool checkIndex_();
+		bool selects_(FragmentIndexEntry const& entry, FragmentSelection const& selection) const;
+		FragmentView viewAt_(FragmentIndexEntry const& entry);
+		static void gather_(std::vector<std::pair<uint8_t const*, size_t>> const& pieces, size_t offset, void* data, size_t size);
+
+		int buffer_{-1};
+		bool broadcast_{false};
+		detail::RawEventHeader* header_{nullptr};
+		SharedMemoryManager* source_{nullptr};
+		std::vector<std::pair<uint8_t const*, size_t>> pieces_;  ///< Gather view of the held buffer
+		std::vector<FragmentIndexEntry> index_;                  ///< Fragments in the held buffer
+		bool index_valid_{false};
+		std::list<std::vector<RawDataType>> view_storage_;  ///< Copies of split Fragments, kept until Release
+	};
+
 	/**
 	 * \brief Connect to a Shared Memory segment using the given parameters
 	 * \param shm_key Key of the Shared Memory segment
@@ -23,29 +200,80 @@ public:
 	/**
 	 * \brief SharedMemoryEventReceiver Destructor
 	 */
-	virtual ~SharedMemoryEventReceiver() = default;
+	virtual ~SharedMemoryEventReceiver();
 
 	/**
 	 * \brief Determine whether an event is available for reading
 	 * \param broadcast (Default false) Whether to wait for a broadcast buffer only
 	 * \param timeout_us (Default 1000000) Time to wait for buffer to become available.
 	 * \return Whether an event is available for reading
+	 *
+	 * Broadcasts are always returned before data events. A segment is only scanned when a buffer was marked Full
+	 * in it since its last empty scan (see SharedMemorySelector).
 	 */
 	bool ReadyForRead(bool broadcast = false, size_t timeout_us = 1000000);
 
+	/**
+	 * \brief Set the policy used by ReadyForRead when waiting for an event
+	 * \param policy WaitPolicy to use. Only its spin and yield phases are used; afterwards, ReadyForRead blocks
+	 * until a buffer is marked Full. The default is WaitPolicy::Idle(), which blocks right away.
+	 */
+	void SetWaitPolicy(WaitPolicy const& policy);
+
+	/**
+	 * \brief Claim the next data event in the background while the current one is being processed
+	 * \param enable Whether to look ahead
+	 *
+	 * A worker thread, started by the first ReadyForRead, claims the next data buffer whenever an event is handed
+	 * over, waiting for one to be marked Full if necessary. It builds its Fragment index and asks the kernel to fault
+	 * its pages in (madvise(MADV_WILLNEED)). The next ReadyForRead hands it over and prefetches its Fragment headers
+	 * into the cache, so it starts hot. While the worker runs, ReadyForRead takes data events only from it, so they
+	 * stay in order. Broadcasts still take priority over the claimed event. The claimed buffer is held by this
+	 * reader, so other readers of the segment cannot take it. Disabling lookahead stops the worker; an already
+	 * claimed event is still returned by the next ReadyForRead (or dispatched first by ParallelReceive). If the
+	 * receiver is destroyed while holding one, it is marked Full again for other readers. Consumer groups do not
+	 * look ahead, and the worker does not claim events while ParallelReceive runs.
+	 */
+	void SetLookahead(bool enable);
+
+	/**
+	 * \brief Whether lookahead is enabled (see SetLookahead)
+	 * \return True if lookahead is enabled
+	 */
+	bool GetLookahead() const { return lookahead_enabled_; }
+
+	/**
+	 * \brief Read data events on behalf of a consumer group (see SharedMemoryManager::AddConsumerGroup)
+	 * \param group ID of the consumer group, or 0 to read as a regular reader
+	 * \return Whether the consumer group is registered
+	 */
+	bool SetConsumerGroup(int group) { return data_.SetConsumerGroup(group); }
+
 	/**
 	 * \brief Get the Event header
 	 * \param err Flag used to indicate if an error has occurred
 	 * \return Pointer to RawEventHeader from buffer
 	 */
-	detail::RawEventHeader* ReadHeader(bool& err);
+	detail::RawEventHeader* ReadHeader(bool& err) { return current_.ReadHeader(err); }
+
+	/**
+	 * \brief Get the index of the Fragments in the event
+	 * \param err Flag used to indicate if an error has occurred
+	 * \return One FragmentIndexEntry per Fragment, in the order they appear in the event
+	 *
+	 * The index is built once, when ReadyForRead acquires the buffer. GetFragmentTypes, GetFragmentsByType and
+	 * GetFragmentViewsByType are answered from it instead of walking the Fragment headers again. If the event
+	 * starts with a table of contents (see EventTOC), the index is taken from it without reading the other
+	 * Fragment headers; the table of contents itself is not listed.
+	 */
+	std::vector<FragmentIndexEntry> GetFragmentIndex(bool& err) { return current_.GetFragmentIndex(err); }
 
 	/**
 	 * \brief Get a set of Fragment Types present in the event
 	 * \param err Flag used to indicate if an error has occurred
 	 * \return std::set of Fragment::type_t of all Fragment types in the event
 	 */
-	std::set<Fragment::type_t> GetFragmentTypes(bool& err);
+	std::set<Fragment::type_t> GetFragmentTypes(bool& err) { return current_.GetFragmentTypes(err); }
 
 	/**
 	 * \brief Get a pointer to the Fragments of a given type in the event
@@ -53,7 +281,55 @@ public:
 	 * \param type Type of Fragments to get. (Use InvalidFragmentType to get all Fragments)
 	 * \return std::unique_ptr to a Fragments object containing returned Fragment objects
 	 */
-	std::unique_ptr<Fragments> GetFragmentsByType(bool& err, Fragment::type_t type);
+	std::unique_ptr<Fragments> GetFragmentsByType(bool& err, Fragment::type_t type) { return current_.GetFragmentsByType(err, type); }
+
+	/**
+	 * \brief Get read-only views of the Fragments of a given type in the event, without copying them
+	 * \param err Flag used to indicate if an error has occurred
+	 * \param type Type of Fragments to get. (Use InvalidFragmentType to get all Fragments)
+	 * \return FragmentViews pointing into the buffer currently being read. They are valid until ReleaseBuffer is called.
+	 *
+	 * Only a Fragment which is split across two buffers of a chained event (see SharedMemoryManager::SetMaxChainLength)
+	 * is copied, into storage owned by the receiver. Use FragmentView::materialize to keep a Fragment after ReleaseBuffer.
+	 */
+	FragmentViews GetFragmentViewsByType(bool& err, Fragment::type_t type) { return current_.GetFragmentViewsByType(err, type); }
+
+	/**
+	 * \brief Get copies of only the Fragments in the event which pass a FragmentSelection
+	 * \param err Flag used to indicate if an error has occurred
+	 * \param selection Which Fragments to copy
+	 * \return std::unique_ptr to a Fragments object containing the selected Fragments, in event order
+	 *
+	 * The selection is evaluated against the Fragment index and, for a timestamp range, the Fragment headers in place,
+	 * so Fragments which are not selected are never copied.
+	 */
+	std::unique_ptr<Fragments> GetFragmentsBySelection(bool& err, FragmentSelection const& selection) { return current_.GetFragmentsBySelection(err, selection); }
+
+	/**
+	 * \brief Get read-only views of only the Fragments in the event which pass a FragmentSelection
+	 * \param err Flag used to indicate if an error has occurred
+	 * \param selection Which Fragments to view
+	 * \return FragmentViews of the selected Fragments, in event order. They are valid until ReleaseBuffer is called.
+	 */
+	FragmentViews GetFragmentViewsBySelection(bool& err, FragmentSelection const& selection) { return current_.GetFragmentViewsBySelection(err, selection); }
+
+	/**
+	 * \brief Process data events on a pool of worker threads, handing them back in sequence ID order
+	 * \param threads Number of worker threads
+	 * \param window Maximum number of events held at once (at least 1)
+	 * \param process Called on a worker thread for each data event
+	 * \param deliver Called on the calling thread for each event once it has been processed; the buffer is released
+	 * when it returns. Return false to stop receiving.
+	 * \param timeout_us Return once no event has arrived for this long (and all held events have been delivered)
+	 * \return Number of events delivered
+	 * \exception Rethrows the first exception thrown by process, after the workers have stopped
+	 *
+	 * Data events are delivered in increasing sequence ID among the events in flight: an event is delivered once it
+	 * and every event with a lower sequence ID that is held have been processed. Broadcasts are not processed by the
+	 * workers; when one arrives, all held data events are delivered first, then the broadcast. Receiving stops at
+	 * end of data. The single-buffer accessors (ReadyForRead and so on) must not be used while ParallelReceive runs.
+	 */
+	size_t ParallelReceive(size_t threads, size_t window, std::function<void(Event&)> const& process, std::function<bool(Event&)> const& deliver, size_t timeout_us = 1000000);
 
 	/**
 	 * \brief Write out information about the Shared Memory to a string
@@ -64,7 +340,7 @@ public:
 	/**
 	 * \brief Release the buffer currently being read to the Empty state
 	 */
-	void ReleaseBuffer();
+	void ReleaseBuffer() { current_.Release(); }
 
 	/**
 	 * \brief Returns the Rank of the writing process
@@ -103,13 +379,27 @@ private:
 	SharedMemoryEventReceiver& operator=(SharedMemoryEventReceiver&&) = delete;
 
 	std::string printBuffers_(SharedMemoryManager* data_source);
+	bool acquire_(Event& event, bool broadcast, size_t timeout_us);
+	bool takeLookahead_(Event& event);
+	bool waitLookahead_(Event& event, size_t timeout_us);
+	void startLookahead_();
+	void pauseLookahead_();
+	void stopLookahead_(bool give_back);
+	void lookaheadLoop_();
 
-	int current_read_buffer_;
 	bool initialized_;
-	detail::RawEventHeader* current_header_;
-	SharedMemoryManager* current_data_source_;
 	SharedMemoryManager data_;
 	SharedMemoryManager broadcasts_;
+	SharedMemorySelector selector_;
+	Event current_;
+	bool lookahead_enabled_;
+	Event lookahead_;  ///< Next data event, claimed by lookahead_thread_. Guarded by lookahead_mutex_.
+	std::thread lookahead_thread_;
+	std::mutex lookahead_mutex_;
+	std::condition_variable lookahead_cv_;
+	std::atomic<bool> lookahead_armed_;  ///< The worker may claim the next data event
+	bool lookahead_claiming_;            ///< The worker is waiting for a data buffer, outside of lookahead_mutex_
+	bool lookahead_stop_;
 };
 }  // namespace artdaq
 
@@ -34,36 +34,25 @@ int artdaq::SharedMemoryFragmentManager::WriteFragment(Fragment&& fragment, bool
 		TLOG(TLVL_INFO) << "WriteFragment: Shared memory was successfully reconnected";
 	}
 
-	auto waitStart = std::chrono::steady_clock::now();
-	while (!ReadyForWrite(overwrite) && TimeUtils::GetElapsedTimeMicroseconds(waitStart) < 1000)
+	auto waiter = GetWaitPolicy().MakeWaiter();
+	while (!ReadyForWrite(overwrite) && (!overwrite || timeout_us == 0 || waiter.ElapsedMicroseconds() < timeout_us))
 	{
-		// BURN THAT CPU!
-	}
-	if (!ReadyForWrite(overwrite))
-	{
-		int64_t loopCount = 0;
-		size_t sleepTime = 1000;  // microseconds
-		int64_t nloops = (timeout_us - 1000) / sleepTime;
-
-		while (!ReadyForWrite(overwrite) && (!overwrite || timeout_us == 0 || loopCount < nloops))
+		// IsEndOfData is a system call, so skip it while spinning
+		if (!waiter.Spinning() && (!IsValid() || IsEndOfData()))
 		{
-			if (!IsValid() || IsEndOfData())
+			TLOG(TLVL_WARNING) << "WriteFragment: Shared memory is not connected! Attempting reconnect...";
+			auto sts = Attach(timeout_us);
+			if (!sts)
 			{
-				TLOG(TLVL_WARNING) << "WriteFragment: Shared memory is not connected! Attempting reconnect...";
-				auto sts = Attach(timeout_us);
-				if (!sts)
-				{
-					return -1;
-				}
-				TLOG(TLVL_INFO) << "WriteFragment: Shared memory was successfully reconnected";
+				return -1;
 			}
-			usleep(sleepTime);
-			++loopCount;
+			TLOG(TLVL_INFO) << "WriteFragment: Shared memory was successfully reconnected";
 		}
+		waiter.Wait();
 	}
 	if (!ReadyForWrite(overwrite))
 	{
-		TLOG(TLVL_WARNING) << "No available buffers after waiting for " << TimeUtils::GetElapsedTimeMicroseconds(waitStart) << " us.";
+		TLOG(TLVL_WARNING) << "No available buffers after waiting for " << waiter.ElapsedMicroseconds() << " us.";
 		return -3;
 	}
 
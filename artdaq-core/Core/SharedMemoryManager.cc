@@ -1,13 +1,25 @@
 #define TRACE_NAME "SharedMemoryManager"
 #include <sys/ipc.h>
 #include <sys/shm.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
 #include <cstring>
+#include <limits>
 #include <list>
+#include <sstream>
 #include <unordered_map>
 #ifndef SHM_DEST  // Lynn reports that this is missing on Mac OS X?!?
 #define SHM_DEST 01000
 #endif
 #include <csignal>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <ctime>
+#endif
 #include "TRACE/tracemf.h"
 #include "artdaq-core/Core/SharedMemoryManager.hh"
 #include "artdaq-core/Utilities/TraceLock.hh"
@@ -28,6 +40,27 @@
 #define TLVL_READ 54
 #define TLVL_CHKBUFFER 55
 
+namespace {
+/// Minimum time between updates of the consumption rate published by the readers
+constexpr uint64_t CONSUMPTION_RATE_INTERVAL_US = 100000;
+
+/// Whether a process has exited. Unknown processes (pid 0) are assumed alive.
+bool processIsGone(int pid)
+{
+	return pid > 0 && kill(pid, 0) != 0 && errno == ESRCH;
+}
+
+/// Inode of this process's PID namespace (0 if unknown). PIDs can only be compared between processes in the same one.
+uint64_t pidNamespace()
+{
+	static uint64_t const ns = []() -> uint64_t {
+		struct stat st = {};
+		return stat("/proc/self/ns/pid", &st) == 0 ? st.st_ino : 0;
+	}();
+	return ns;
+}
+}  // namespace
+
 static std::list<artdaq::SharedMemoryManager const*> instances = std::list<artdaq::SharedMemoryManager const*>();
 
 static std::unordered_map<int, struct sigaction> old_actions = std::unordered_map<int, struct sigaction>();
@@ -68,12 +101,23 @@ static void signal_handler(int signum)
 	sigaction(signum, &old_actions[signum], nullptr);
 }
 
-artdaq::SharedMemoryManager::SharedMemoryManager(uint32_t shm_key, size_t buffer_count, size_t buffer_size, uint64_t buffer_timeout_us, bool destructive_read_mode)
+artdaq::SharedMemoryManager::SharedMemoryManager(uint32_t shm_key, size_t buffer_count, size_t buffer_size, uint64_t buffer_timeout_us, bool destructive_read_mode, bool warm_restart)
     : shm_segment_id_(-1)
     , shm_ptr_(nullptr)
     , shm_key_(shm_key)
     , manager_id_(-1)
+    , segment_count_(0)
+    , attached_buffer_count_(0)
     , last_seen_id_(0)
+    , wait_policy_(WaitPolicy::Default())
+    , consumer_group_(0)
+    , locality_(-1)
+    , stolen_buffer_count_(0)
+    , warm_restart_(warm_restart)
+    , warm_restarted_(false)
+    , max_chain_length_(1)
+    , last_sweep_us_(0)
+    , recount_needed_(false)
 {
 	requested_shm_parameters_.buffer_count = buffer_count;
 	requested_shm_parameters_.buffer_size = buffer_size;
@@ -187,8 +231,10 @@ bool artdaq::SharedMemoryManager::Attach(size_t timeout_usec)
 		}
 		else
 		{
+			auto waiter = wait_policy_.MakeWaiter();
 			while (shm_segment_id_ == -1 && TimeUtils::GetElapsedTimeMicroseconds(start_time) < timeout_us)
 			{
+				waiter.Wait();
 				shm_segment_id_ = shmget(shm_key_, shmSize, 0666);
 			}
 		}
@@ -207,18 +253,58 @@ bool artdaq::SharedMemoryManager::Attach(size_t timeout_usec)
 		    << std::hex << static_cast<void*>(shm_ptr_) << std::dec;
 		if ((shm_ptr_ != nullptr) && shm_ptr_ != reinterpret_cast<void*>(-1))  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
 		{
-			if (manager_id_ == 0)
+			warm_restarted_ = false;
+			if (manager_id_ == 0 && warm_restart_ && shm_ptr_->ready_magic == 0xCAFE1111 && layoutMatches_())
+			{
+				if (!warmAttach_())
+				{
+					Detach();
+					return false;
+				}
+			}
+			else if (manager_id_ == 0)
 			{
 				if (shm_ptr_->ready_magic == 0xCAFE1111)
 				{
+					// Extension segments are IPC_PRIVATE, so they are only reachable through the table being reset below
+					std::ostringstream extensions;
+					if (shm_ptr_->layout_signature == layoutSignature_())
+					{
+						auto count = std::min(shm_ptr_->extension_count.load(), MAX_SEGMENT_EXTENSIONS);
+						for (int ii = 0; ii < count; ++ii)
+						{
+							auto segment_id = shm_ptr_->extension_segment_ids[ii];
+							if (shmctl(segment_id, IPC_RMID, nullptr) == 0)
+							{
+								extensions << " " << segment_id;
+							}
+							else
+							{
+								TLOG(TLVL_WARNING) << "Failed to remove extension segment " << ii << " (shmid " << segment_id << "), errno=" << errno << " (" << strerror(errno) << ")";
+							}
+						}
+					}
 					TLOG(TLVL_WARNING) << "Owner encountered already-initialized Shared Memory! "
 					                   << "Once the system is shut down, you can use one of the following commands "
 					                   << "to clean up this shared memory: 'ipcrm -M 0x" << std::hex << shm_key_
-					                   << "' or 'ipcrm -m " << std::dec << shm_segment_id_ << "'.";
+					                   << "' or 'ipcrm -m " << std::dec << shm_segment_id_ << "'."
+					                   << (extensions.str().empty() ? "" : " Removed its extension segments (shmids" + extensions.str() + ").");
 					// exit(-2);
 				}
 				TLOG(TLVL_ATTACH) << "Owner initializing Shared Memory";
 				shm_ptr_->next_id = 1;
+				for (auto& manager : shm_ptr_->managers)
+				{
+					manager.manager_id = -1;
+					manager.pid = 0;
+					manager.pid_namespace = 0;
+					for (auto& owned : manager.owned)
+					{
+						owned = -1;
+					}
+					manager.owned_overflow = false;
+				}
+				registerManager_();
 				shm_ptr_->next_sequence_id = 0;
 				shm_ptr_->reader_pos = 0;
 				shm_ptr_->writer_pos = 0;
@@ -226,11 +312,24 @@ bool artdaq::SharedMemoryManager::Attach(size_t timeout_usec)
 				shm_ptr_->buffer_count = requested_shm_parameters_.buffer_count;
 				shm_ptr_->buffer_timeout_us = requested_shm_parameters_.buffer_timeout_us;
 				shm_ptr_->destructive_read_mode = requested_shm_parameters_.destructive_read_mode;
+				shm_ptr_->last_full_buffer = -1;
+				shm_ptr_->full_generation = 0;
+				shm_ptr_->full_waiters = 0;
+				shm_ptr_->consumed_count = 0;
+				shm_ptr_->consumed_sample_count = 0;
+				shm_ptr_->consumed_sample_time_us = TimeUtils::gettime_monotonic_coarse_us();
+				shm_ptr_->consume_rate_mhz = 0;
+				shm_ptr_->extension_count = 0;
+				shm_ptr_->consumer_group_slots = 0;
+				shm_ptr_->consumer_groups = 0;
+				for (auto& prescale : shm_ptr_->consumer_group_prescales)
+				{
+					prescale = 0;
+				}
 
-				buffer_ptrs_ = std::vector<ShmBuffer*>(shm_ptr_->buffer_count);
+				addSegment_(shm_segment_id_, reinterpret_cast<uint8_t*>(shm_ptr_), sizeof(ShmStruct), shm_ptr_->buffer_count);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
 				for (int ii = 0; ii < static_cast<int>(requested_shm_parameters_.buffer_count); ++ii)
 				{
-					buffer_ptrs_[ii] = reinterpret_cast<ShmBuffer*>(reinterpret_cast<uint8_t*>(shm_ptr_ + 1) + ii * sizeof(ShmBuffer));  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
 					if (getBufferInfo_(ii) == nullptr)
 					{
 						return false;
@@ -239,36 +338,57 @@ bool artdaq::SharedMemoryManager::Attach(size_t timeout_usec)
 					getBufferInfo_(ii)->readPos = 0;
 					getBufferInfo_(ii)->sem = BufferSemaphoreFlags::Empty;
 					getBufferInfo_(ii)->sem_id = -1;
-					getBufferInfo_(ii)->last_touch_time = TimeUtils::gettimeofday_us();
+					getBufferInfo_(ii)->last_touch_time = TimeUtils::gettime_monotonic_coarse_us();
+					getBufferInfo_(ii)->generation = 0;
+					getBufferInfo_(ii)->pending_groups = 0;
+					getBufferInfo_(ii)->group_claims = 0;
+					getBufferInfo_(ii)->locality = -1;
+					getBufferInfo_(ii)->targeted = false;
+					getBufferInfo_(ii)->regions_expected = 0;
+					getBufferInfo_(ii)->chain_next = -1;
 				}
 
+				shm_ptr_->free_count = shm_ptr_->buffer_count;
+				shm_ptr_->ready_count = 0;
+				shm_ptr_->writing_count = 0;
+				shm_ptr_->targeted_full_count = 0;
+				for (auto& entry : shm_ptr_->sequence_index)
+				{
+					entry = -1;
+				}
+				shm_ptr_->sequence_index_evictions = 0;
+				shm_ptr_->sequence_index_checked = 0;
+
+				shm_ptr_->layout_signature = layoutSignature_();
 				shm_ptr_->ready_magic = 0xCAFE1111;
 			}
 			else
 			{
 				TLOG(TLVL_ATTACH) << "Waiting for owner to initalize Shared Memory";
-				while (shm_ptr_->ready_magic != 0xCAFE1111) { usleep(1000); }
+				auto waiter = wait_policy_.MakeWaiter();
+				while (shm_ptr_->ready_magic != 0xCAFE1111) { waiter.Wait(); }
 				TLOG(TLVL_ATTACH) << "Getting ID from Shared Memory";
 				GetNewId();
 				shm_ptr_->lowest_seq_id_read = 0;
 				TLOG(TLVL_ATTACH) << "Getting Shared Memory Size parameters";
 
 				requested_shm_parameters_.buffer_count = shm_ptr_->buffer_count;
-				buffer_ptrs_ = std::vector<ShmBuffer*>(shm_ptr_->buffer_count);
-				for (int ii = 0; ii < shm_ptr_->buffer_count; ++ii)
+				addSegment_(shm_segment_id_, reinterpret_cast<uint8_t*>(shm_ptr_), sizeof(ShmStruct), shm_ptr_->buffer_count);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+				if (!refreshSegments_())
 				{
-					buffer_ptrs_[ii] = reinterpret_cast<ShmBuffer*>(reinterpret_cast<uint8_t*>(shm_ptr_ + 1) + ii * sizeof(ShmBuffer));  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+					TLOG(TLVL_ERROR) << "Failed to attach to the extension segments of shared memory with key 0x" << std::hex << shm_key_;
+					Detach();
+					return false;
 				}
 			}
 
 			// last_seen_id_ = shm_ptr_->next_sequence_id;
-			buffer_mutexes_ = std::vector<std::mutex>(shm_ptr_->buffer_count);
 
 			TLOG(TLVL_ATTACH) << "Initialization Complete: "
 			                  << "key: 0x" << std::hex << shm_key_
 			                  << ", manager ID: " << std::dec << manager_id_
 			                  << ", Buffer size: " << shm_ptr_->buffer_size
-			                  << ", Buffer count: " << shm_ptr_->buffer_count;
+			                  << ", Buffer count: " << bufferCount_();
 			return true;
 		}
 
@@ -285,15 +405,131 @@ bool artdaq::SharedMemoryManager::Attach(size_t timeout_usec)
 	return false;
 }
 
+void artdaq::SharedMemoryManager::addSegment_(int segment_id, uint8_t* base, size_t header_size, int buffer_count)
+{
+	auto index = segment_count_.load();
+	auto& seg = segments_[index];
+	seg.segment_id = segment_id;
+	seg.base = base;
+	seg.buffers = reinterpret_cast<ShmBuffer*>(base + header_size);     // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	seg.data = base + header_size + buffer_count * sizeof(ShmBuffer);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	seg.first_buffer = bufferCount_();
+	seg.buffer_count = buffer_count;
+	seg.mutexes = std::make_unique<std::mutex[]>(buffer_count);            // NOLINT(cppcoreguidelines-avoid-c-arrays,modernize-avoid-c-arrays)
+	seg.group_owned = std::make_unique<std::atomic<bool>[]>(buffer_count);  // NOLINT(cppcoreguidelines-avoid-c-arrays,modernize-avoid-c-arrays)
+	seg.group_read_pos = std::make_unique<size_t[]>(buffer_count);         // NOLINT(cppcoreguidelines-avoid-c-arrays,modernize-avoid-c-arrays)
+	for (int ii = 0; ii < buffer_count; ++ii)
+	{
+		seg.group_owned[ii] = false;
+	}
+
+	// Publish the segment before the new buffer count, so that any thread which sees the new count can find the segment
+	segment_count_.store(index + 1, std::memory_order_release);
+	attached_buffer_count_.store(seg.first_buffer + buffer_count, std::memory_order_release);
+	TLOG(TLVL_ATTACH) << "Mapped segment " << index << " (shmid " << segment_id << ") containing buffers " << seg.first_buffer << " through " << seg.first_buffer + buffer_count - 1;
+}
+
+bool artdaq::SharedMemoryManager::refreshSegments_()
+{
+	if (shm_ptr_ == nullptr)
+	{
+		return false;
+	}
+	if (shm_ptr_->extension_count.load(std::memory_order_acquire) + 1 == segment_count_.load(std::memory_order_acquire))
+	{
+		return true;
+	}
+
+	std::lock_guard<std::mutex> lk(segment_mutex_);
+	auto extensions = shm_ptr_->extension_count.load(std::memory_order_acquire);
+	for (auto ii = segment_count_.load() - 1; ii < extensions; ++ii)
+	{
+		auto segment_id = shm_ptr_->extension_segment_ids[ii];
+		auto ptr = shmat(segment_id, nullptr, 0);
+		if (ptr == reinterpret_cast<void*>(-1))  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,performance-no-int-to-ptr)
+		{
+			TLOG(TLVL_ERROR) << "Failed to attach to extension segment " << ii << " (shmid " << segment_id << "), errno=" << errno << " (" << strerror(errno) << ")";
+			return false;
+		}
+		addSegment_(segment_id, static_cast<uint8_t*>(ptr), 0, shm_ptr_->extension_buffer_counts[ii]);
+	}
+	return true;
+}
+
+bool artdaq::SharedMemoryManager::AddBuffers(size_t count)
+{
+	if (!IsValid() || manager_id_ != 0 || count == 0)
+	{
+		TLOG(TLVL_WARNING) << "AddBuffers: Only the owner of a valid shared memory segment may add buffers";
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lk(segment_mutex_);
+	auto index = shm_ptr_->extension_count.load();
+	if (index >= MAX_SEGMENT_EXTENSIONS)
+	{
+		TLOG(TLVL_ERROR) << "AddBuffers: Shared memory with key 0x" << std::hex << shm_key_ << std::dec << " already has the maximum number of extension segments (" << MAX_SEGMENT_EXTENSIONS << ")";
+		return false;
+	}
+
+	size_t segSize = count * (shm_ptr_->buffer_size + sizeof(ShmBuffer));
+	auto segment_id = shmget(IPC_PRIVATE, segSize, IPC_CREAT | 0666);
+	if (segment_id == -1)
+	{
+		TLOG(TLVL_ERROR) << "AddBuffers: Error creating extension segment of size " << segSize << ", errno=" << errno << " (" << strerror(errno) << ")";
+		return false;
+	}
+	auto ptr = shmat(segment_id, nullptr, 0);
+	if (ptr == reinterpret_cast<void*>(-1))  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,performance-no-int-to-ptr)
+	{
+		TLOG(TLVL_ERROR) << "AddBuffers: Error attaching extension segment, errno=" << errno << " (" << strerror(errno) << ")";
+		shmctl(segment_id, IPC_RMID, nullptr);
+		return false;
+	}
+
+	auto buffers = static_cast<ShmBuffer*>(ptr);
+	for (size_t ii = 0; ii < count; ++ii)
+	{
+		auto buf = &buffers[ii];  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		buf->writePos = 0;
+		buf->readPos = 0;
+		buf->sem = BufferSemaphoreFlags::Empty;
+		buf->sem_id = -1;
+		buf->sequence_id = 0;
+		buf->last_touch_time = TimeUtils::gettime_monotonic_coarse_us();
+		buf->generation = 0;
+		buf->pending_groups = 0;
+		buf->group_claims = 0;
+		buf->locality = -1;
+		buf->targeted = false;
+		buf->regions_expected = 0;
+		buf->chain_next = -1;
+	}
+	addSegment_(segment_id, static_cast<uint8_t*>(ptr), 0, count);
+
+	shm_ptr_->extension_segment_ids[index] = segment_id;
+	shm_ptr_->extension_buffer_counts[index] = count;
+	shm_ptr_->extension_count.store(index + 1, std::memory_order_release);
+	shm_ptr_->free_count += static_cast<int>(count);
+
+	TLOG(TLVL_INFO) << "AddBuffers: Added " << count << " buffers to shared memory with key 0x" << std::hex << shm_key_ << std::dec << ", new buffer count is " << bufferCount_();
+	return true;
+}
+
 int artdaq::SharedMemoryManager::GetBufferForReading()
 {
 	TLOG(TLVL_GETBUFFER) << "GetBufferForReading BEGIN";
+	refreshSegments_();
+	if (isConsumerGroup_())
+	{
+		return getBufferForGroup_();
+	}
 
 	std::lock_guard<std::mutex> lk(search_mutex_);
 	// TraceLock lk(search_mutex_, 11, "GetBufferForReadingSearch");
 	auto rp = shm_ptr_->reader_pos.load();
 
-	TLOG(TLVL_GETBUFFER) << "GetBufferForReading lock acquired, scanning " << shm_ptr_->buffer_count << " buffers";
+	TLOG(TLVL_GETBUFFER) << "GetBufferForReading lock acquired, scanning " << bufferCount_() << " buffers";
 
 	for (int retry = 0; retry < 5; retry++)
 	{
@@ -302,10 +538,12 @@ int artdaq::SharedMemoryManager::GetBufferForReading()
 		int buffer_num = -1;
 		ShmBuffer* buffer_ptr = nullptr;
 		uint64_t seqID = -1;
+		ShmBuffer* steal_ptr = nullptr;
+		int steal_num = -1;
 
-		for (auto ii = 0; ii < shm_ptr_->buffer_count; ++ii)
+		for (auto ii = 0; ii < bufferCount_(); ++ii)
 		{
-			auto buffer = (ii + rp) % shm_ptr_->buffer_count;
+			auto buffer = (ii + rp) % bufferCount_();
 
 			TLOG(TLVL_GETBUFFER + 1) << "GetBufferForReading Checking if buffer " << buffer << " is stale. Shm destructive_read_mode=" << shm_ptr_->destructive_read_mode;
 			ResetBuffer(buffer);
@@ -323,12 +561,21 @@ int artdaq::SharedMemoryManager::GetBufferForReading()
 			                         << " (expected " << FlagToString(BufferSemaphoreFlags::Full) << "), sem_id=" << sem_id << ", seq_id=" << buf->sequence_id << " )";
 			if (sem == BufferSemaphoreFlags::Full && (sem_id == -1 || sem_id == manager_id_) && (shm_ptr_->destructive_read_mode || buf->sequence_id > last_seen_id_))
 			{
+				if (shm_ptr_->destructive_read_mode && locality_ != -1 && buf->locality != -1 && buf->locality != locality_)
+				{
+					// Belongs to a reader with another locality; only taken if nothing closer is Full
+					if (steal_ptr == nullptr)
+					{
+						steal_ptr = buf;
+						steal_num = buffer;
+					}
+					continue;
+				}
 				if (buf->sequence_id < seqID)
 				{
 					buffer_ptr = buf;
 					seqID = buf->sequence_id;
 					buffer_num = buffer;
-					touchBuffer_(buf);
 					if (shm_ptr_->destructive_read_mode || seqID == last_seen_id_ + 1)
 					{
 						break;
@@ -337,6 +584,15 @@ int artdaq::SharedMemoryManager::GetBufferForReading()
 			}
 		}
 
+		auto stealing = buffer_ptr == nullptr && steal_ptr != nullptr;
+		if (stealing)
+		{
+			TLOG(TLVL_GETBUFFER) << "GetBufferForReading No Full buffers with locality " << locality_ << ", taking buffer " << steal_num << " with locality " << steal_ptr->locality;
+			buffer_ptr = steal_ptr;
+			buffer_num = steal_num;
+			seqID = steal_ptr->sequence_id;
+		}
+
 		if (buffer_ptr != nullptr)
 		{
 			sem = buffer_ptr->sem.load();
@@ -351,12 +607,7 @@ int artdaq::SharedMemoryManager::GetBufferForReading()
 		if (buffer_num >= 0)
 		{
 			TLOG(TLVL_GETBUFFER) << "GetBufferForReading Found buffer " << buffer_num;
-			touchBuffer_(buffer_ptr);
-			if (!buffer_ptr->sem_id.compare_exchange_strong(sem_id, manager_id_))
-			{
-				continue;
-			}
-			if (!buffer_ptr->sem.compare_exchange_strong(sem, BufferSemaphoreFlags::Reading))
+			if (!claim_(buffer_ptr, sem, sem_id, BufferSemaphoreFlags::Reading))
 			{
 				continue;
 			}
@@ -377,9 +628,13 @@ int artdaq::SharedMemoryManager::GetBufferForReading()
 				shm_ptr_->lowest_seq_id_read = seqID;
 			}
 			last_seen_id_ = seqID;
-			if (shm_ptr_->destructive_read_mode)
+			if (stealing)
 			{
-				shm_ptr_->reader_pos = (buffer_num + 1) % shm_ptr_->buffer_count;
+				++stolen_buffer_count_;
+			}
+			else if (shm_ptr_->destructive_read_mode)
+			{
+				shm_ptr_->reader_pos = (buffer_num + 1) % bufferCount_();
 			}
 
 			TLOG(TLVL_GETBUFFER) << "GetBufferForReading returning " << buffer_num;
@@ -392,20 +647,144 @@ int artdaq::SharedMemoryManager::GetBufferForReading()
 	return -1;
 }
 
+int artdaq::SharedMemoryManager::GetBufferForReading(size_t sequence_id)
+{
+	TLOG(TLVL_GETBUFFER) << "GetBufferForReading(" << sequence_id << ") BEGIN";
+	if (isConsumerGroup_())
+	{
+		TLOG(TLVL_WARNING) << "GetBufferForReading: Buffers cannot be requested by sequence ID in a consumer group";
+		return -1;
+	}
+	auto buffer = FindBuffer(sequence_id);
+	if (buffer == -1)
+	{
+		return -1;
+	}
+
+	std::lock_guard<std::mutex> lk(search_mutex_);
+	auto buf = getBufferInfo_(buffer);
+	if (buf == nullptr)
+	{
+		return -1;
+	}
+	auto sem = buf->sem.load();
+	auto sem_id = buf->sem_id.load();
+	if (sem != BufferSemaphoreFlags::Full || (sem_id != -1 && sem_id != manager_id_) || !claim_(buf, sem, sem_id, BufferSemaphoreFlags::Reading))
+	{
+		TLOG(TLVL_GETBUFFER) << "GetBufferForReading: Buffer " << buffer << " holding sequence ID " << sequence_id << " is not available for reading";
+		return -1;
+	}
+	if (buf->sequence_id != sequence_id)
+	{
+		// Recycled for a newer event between the lookup and the claim. Given back with its previous owner, which is
+		// its destination if it was marked Full for one.
+		revertClaim_(buf, sem, sem_id);
+		notifyFull_();
+		return -1;
+	}
+	buf->readPos = 0;
+	touchBuffer_(buf);
+	TLOG(TLVL_GETBUFFER) << "GetBufferForReading returning " << buffer << " for sequence ID " << sequence_id;
+	return buffer;
+}
+
+int artdaq::SharedMemoryManager::FindBuffer(size_t sequence_id)
+{
+	if (!IsValid())
+	{
+		return -1;
+	}
+	refreshSegments_();
+	auto buffer = shm_ptr_->sequence_index[sequence_id % SEQUENCE_INDEX_SIZE].load();
+	if (buffer >= 0 && buffer < bufferCount_() && holdsEvent_(getBufferInfo_(buffer), sequence_id))
+	{
+		return buffer;
+	}
+	auto evictions = shm_ptr_->sequence_index_evictions.load();
+	if (evictions == shm_ptr_->sequence_index_checked)
+	{
+		return -1;
+	}
+
+	TLOG(TLVL_GETBUFFER) << "FindBuffer: Sequence ID " << sequence_id << " not in the index, scanning " << bufferCount_() << " buffers";
+	auto evicted_left = false;
+	for (auto ii = 0; ii < bufferCount_(); ++ii)
+	{
+		auto buf = getBufferInfo_(ii);
+		if (holdsEvent_(buf, sequence_id))
+		{
+			return ii;
+		}
+		auto held_id = buf != nullptr ? buf->sequence_id.load() : 0;
+		if (!evicted_left && holdsEvent_(buf, held_id) && shm_ptr_->sequence_index[held_id % SEQUENCE_INDEX_SIZE] != ii)
+		{
+			evicted_left = true;
+		}
+	}
+	if (!evicted_left)
+	{
+		// An eviction during the scan increments the count past the value read before it, so it is not missed
+		TLOG(TLVL_GETBUFFER) << "FindBuffer: No event missing from the index is left, lookups stop scanning";
+		shm_ptr_->sequence_index_checked = evictions;
+	}
+	return -1;
+}
+
+bool artdaq::SharedMemoryManager::WaitForFullGeneration(uint32_t generation, size_t timeout_us)
+{
+	if (!IsValid())
+	{
+		usleep(timeout_us);
+		return false;
+	}
+	if (shm_ptr_->full_generation.load() != generation || timeout_us == 0)
+	{
+		return shm_ptr_->full_generation.load() != generation;
+	}
+
+#ifdef __linux__
+	static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex word must be a plain 32-bit integer");
+	timespec ts;
+	ts.tv_sec = static_cast<time_t>(timeout_us / 1000000);
+	ts.tv_nsec = static_cast<long>(timeout_us % 1000000 * 1000);  // NOLINT(google-runtime-int)
+	// The counter is re-checked by the kernel after full_waiters is raised, so a concurrent notifyFull_ cannot be missed
+	shm_ptr_->full_waiters.fetch_add(1);
+	syscall(SYS_futex, reinterpret_cast<uint32_t*>(&shm_ptr_->full_generation), FUTEX_WAIT, generation, &ts, nullptr, 0);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-type-vararg)
+	shm_ptr_->full_waiters.fetch_sub(1);
+#else
+	usleep(std::min(timeout_us, static_cast<size_t>(1000)));
+#endif
+	return shm_ptr_->full_generation.load() != generation;
+}
+
+int artdaq::SharedMemoryManager::CurrentNumaNode()
+{
+#ifdef __linux__
+	unsigned cpu = 0;
+	unsigned node = 0;
+	if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0)  // NOLINT(cppcoreguidelines-pro-type-vararg)
+	{
+		return static_cast<int>(node);
+	}
+#endif
+	return 0;
+}
+
 int artdaq::SharedMemoryManager::GetBufferForWriting(bool overwrite)
 {
 	TLOG(TLVL_GETBUFFER + 1) << "GetBufferForWriting BEGIN, overwrite=" << (overwrite ? "true" : "false");
+	refreshSegments_();
 
 	std::lock_guard<std::mutex> lk(search_mutex_);
 	// TraceLock lk(search_mutex_, 12, "GetBufferForWritingSearch");
 	auto wp = shm_ptr_->writer_pos.load();
 
-	TLOG(TLVL_GETBUFFER) << "GetBufferForWriting lock acquired, scanning " << shm_ptr_->buffer_count << " buffers";
+	TLOG(TLVL_GETBUFFER) << "GetBufferForWriting lock acquired, scanning " << bufferCount_() << " buffers";
 
 	// First, only look for "Empty" buffers
-	for (auto ii = 0; ii < shm_ptr_->buffer_count; ++ii)
+	for (auto ii = 0; ii < bufferCount_(); ++ii)
 	{
-		auto buffer = (ii + wp) % shm_ptr_->buffer_count;
+		auto buffer = (ii + wp) % bufferCount_();
 
 		ResetBuffer(buffer);
 
@@ -420,22 +799,20 @@ int artdaq::SharedMemoryManager::GetBufferForWriting(bool overwrite)
 
 		if (sem == BufferSemaphoreFlags::Empty && sem_id == -1)
 		{
-			touchBuffer_(buf);
-			if (!buf->sem_id.compare_exchange_strong(sem_id, manager_id_))
-			{
-				continue;
-			}
-			if (!buf->sem.compare_exchange_strong(sem, BufferSemaphoreFlags::Writing))
+			if (!claim_(buf, sem, sem_id, BufferSemaphoreFlags::Writing))
 			{
 				continue;
 			}
+			buf->generation |= 1;  // Peekers must not use this buffer until it is marked Full
 			if (!checkBuffer_(buf, BufferSemaphoreFlags::Writing, false))
 			{
 				continue;
 			}
-			shm_ptr_->writer_pos = (buffer + 1) % shm_ptr_->buffer_count;
+			shm_ptr_->writer_pos = (buffer + 1) % bufferCount_();
 			buf->sequence_id = ++shm_ptr_->next_sequence_id;
 			buf->writePos = 0;
+			buf->regions_expected = 0;
+			buf->chain_next = -1;
 			if (!checkBuffer_(buf, BufferSemaphoreFlags::Writing, false))
 			{
 				continue;
@@ -449,9 +826,9 @@ int artdaq::SharedMemoryManager::GetBufferForWriting(bool overwrite)
 	if (overwrite)
 	{
 		// Then, look for "Full" buffers
-		for (auto ii = 0; ii < shm_ptr_->buffer_count; ++ii)
+		for (auto ii = 0; ii < bufferCount_(); ++ii)
 		{
-			auto buffer = (ii + wp) % shm_ptr_->buffer_count;
+			auto buffer = (ii + wp) % bufferCount_();
 
 			ResetBuffer(buffer);
 
@@ -464,24 +841,29 @@ int artdaq::SharedMemoryManager::GetBufferForWriting(bool overwrite)
 			auto sem = buf->sem.load();
 			auto sem_id = buf->sem_id.load();
 
-			if (sem == BufferSemaphoreFlags::Full)
+			if (sem == BufferSemaphoreFlags::Full && sem_id != CHAINED_CONTINUATION && buf->group_claims == 0)
 			{
-				touchBuffer_(buf);
-				if (!buf->sem_id.compare_exchange_strong(sem_id, manager_id_))
+				if (!claim_(buf, sem, sem_id, BufferSemaphoreFlags::Writing))
 				{
 					continue;
 				}
-				if (!buf->sem.compare_exchange_strong(sem, BufferSemaphoreFlags::Writing))
+				if (buf->group_claims != 0)
 				{
+					// A consumer group claimed the buffer after the check above, and saw it still Full
+					revertClaim_(buf, sem, sem_id);
 					continue;
 				}
+				buf->generation |= 1;
+				buf->pending_groups = 0;  // Overwritten data is dropped for every consumer group
+				releaseChain_(buf);
 				if (!checkBuffer_(buf, BufferSemaphoreFlags::Writing, false))
 				{
 					continue;
 				}
-				shm_ptr_->writer_pos = (buffer + 1) % shm_ptr_->buffer_count;
+				shm_ptr_->writer_pos = (buffer + 1) % bufferCount_();
 				buf->sequence_id = ++shm_ptr_->next_sequence_id;
 				buf->writePos = 0;
+				buf->regions_expected = 0;
 				if (!checkBuffer_(buf, BufferSemaphoreFlags::Writing, false))
 				{
 					continue;
@@ -493,9 +875,9 @@ int artdaq::SharedMemoryManager::GetBufferForWriting(bool overwrite)
 		}
 
 		// Finally, if we still haven't found a buffer, we have to clobber a reader...
-		for (auto ii = 0; ii < shm_ptr_->buffer_count; ++ii)
+		for (auto ii = 0; ii < bufferCount_(); ++ii)
 		{
-			auto buffer = (ii + wp) % shm_ptr_->buffer_count;
+			auto buffer = (ii + wp) % bufferCount_();
 
 			ResetBuffer(buffer);
 
@@ -508,24 +890,29 @@ int artdaq::SharedMemoryManager::GetBufferForWriting(bool overwrite)
 			auto sem = buf->sem.load();
 			auto sem_id = buf->sem_id.load();
 
-			if (sem == BufferSemaphoreFlags::Reading)
+			if (sem == BufferSemaphoreFlags::Reading && buf->group_claims == 0)
 			{
-				touchBuffer_(buf);
-				if (!buf->sem_id.compare_exchange_strong(sem_id, manager_id_))
+				if (!claim_(buf, sem, sem_id, BufferSemaphoreFlags::Writing))
 				{
 					continue;
 				}
-				if (!buf->sem.compare_exchange_strong(sem, BufferSemaphoreFlags::Writing))
+				if (buf->group_claims != 0)
 				{
+					// A consumer group claimed the buffer after the check above, and saw it still Reading
+					revertClaim_(buf, sem, sem_id);
 					continue;
 				}
+				buf->generation |= 1;
+				buf->pending_groups = 0;  // Overwritten data is dropped for every consumer group
+				releaseChain_(buf);
 				if (!checkBuffer_(buf, BufferSemaphoreFlags::Writing, false))
 				{
 					continue;
 				}
-				shm_ptr_->writer_pos = (buffer + 1) % shm_ptr_->buffer_count;
+				shm_ptr_->writer_pos = (buffer + 1) % bufferCount_();
 				buf->sequence_id = ++shm_ptr_->next_sequence_id;
 				buf->writePos = 0;
+				buf->regions_expected = 0;
 				if (!checkBuffer_(buf, BufferSemaphoreFlags::Writing, false))
 				{
 					continue;
@@ -547,11 +934,19 @@ size_t artdaq::SharedMemoryManager::ReadReadyCount()
 		return 0;
 	}
 	TLOG(TLVL_READREADY) << "0x" << std::hex << shm_key_ << " ReadReadyCount BEGIN" << std::dec;
+	refreshSegments_();
+	if (readCountsApply_())
+	{
+		sweepStale_();
+		auto count = std::max(shm_ptr_->ready_count.load(), 0);
+		TLOG(TLVL_READREADY) << "ReadReadyCount: " << count << " unowned Full buffers";
+		return count;
+	}
 	std::unique_lock<std::mutex> lk(search_mutex_);
-	TLOG(TLVL_READREADY) << "ReadReadyCount lock acquired, scanning " << shm_ptr_->buffer_count << " buffers";
+	TLOG(TLVL_READREADY) << "ReadReadyCount lock acquired, scanning " << bufferCount_() << " buffers";
 	// TraceLock lk(search_mutex_, 14, "ReadReadyCountSearch");
 	size_t count = 0;
-	for (auto ii = 0; ii < shm_ptr_->buffer_count; ++ii)
+	for (auto ii = 0; ii < bufferCount_(); ++ii)
 	{
 #ifndef __OPTIMIZE__
 		TLOG(TLVL_READREADY + 1) << "0x" << std::hex << shm_key_ << std::dec << " ReadReadyCount: Checking if buffer " << ii << " is stale.";
@@ -566,50 +961,34 @@ size_t artdaq::SharedMemoryManager::ReadReadyCount()
 #ifndef __OPTIMIZE__
 		TLOG(TLVL_READREADY + 2) << "0x" << std::hex << shm_key_ << std::dec << " ReadReadyCount: Buffer " << ii << ": sem=" << FlagToString(buf->sem) << " (expected " << FlagToString(BufferSemaphoreFlags::Full) << "), sem_id=" << buf->sem_id << " )";
 #endif
-		if (buf->sem == BufferSemaphoreFlags::Full && (buf->sem_id == -1 || buf->sem_id == manager_id_) && (shm_ptr_->destructive_read_mode || buf->sequence_id > last_seen_id_))
+		if (readable_(buf))
 		{
 #ifndef __OPTIMIZE__
 			TLOG(TLVL_READREADY + 3) << "0x" << std::hex << shm_key_ << std::dec << " ReadReadyCount: Buffer " << ii << " is either unowned or owned by this manager, and is marked full.";
 #endif
-			touchBuffer_(buf);
 			++count;
 		}
 	}
 	return count;
 }
 
+size_t artdaq::SharedMemoryManager::GetTargetedFullCount() const
+{
+	return shm_ptr_ != nullptr ? std::max(shm_ptr_->targeted_full_count.load(), 0) : 0;
+}
+
 size_t artdaq::SharedMemoryManager::WriteReadyCount(bool overwrite)
 {
 	if (!IsValid())
 	{
 		return 0;
 	}
-	TLOG(TLVL_WRITEREADY) << "0x" << std::hex << shm_key_ << " ReadReadyCount BEGIN" << std::dec;
-	std::unique_lock<std::mutex> lk(search_mutex_);
-	// TraceLock lk(search_mutex_, 15, "WriteReadyCountSearch");
-	TLOG(TLVL_WRITEREADY) << "WriteReadyCount(" << overwrite << ") lock acquired, scanning " << shm_ptr_->buffer_count << " buffers";
-	size_t count = 0;
-	for (auto ii = 0; ii < shm_ptr_->buffer_count; ++ii)
-	{
-		// ELF, 3/19/2019: This TRACE call is a major performance hit with many buffers
-#ifndef __OPTIMIZE__
-		TLOG(TLVL_WRITEREADY + 1) << "0x" << std::hex << shm_key_ << std::dec << " WriteReadyCount: Checking if buffer " << ii << " is stale.";
-#endif
-		ResetBuffer(ii);
-		auto buf = getBufferInfo_(ii);
-		if (buf == nullptr)
-		{
-			continue;
-		}
-		if ((buf->sem == BufferSemaphoreFlags::Empty && buf->sem_id == -1) || (overwrite && buf->sem != BufferSemaphoreFlags::Writing))
-		{
-#ifndef __OPTIMIZE__
-			TLOG(TLVL_WRITEREADY + 1) << "0x" << std::hex << shm_key_ << std::dec << " WriteReadyCount: Buffer " << ii << " is either empty or is available for overwrite.";
-#endif
-			++count;
-		}
-	}
-	return count;
+	TLOG(TLVL_WRITEREADY) << "0x" << std::hex << shm_key_ << " WriteReadyCount BEGIN" << std::dec;
+	refreshSegments_();
+	sweepStale_();
+	auto count = overwrite ? bufferCount_() - shm_ptr_->writing_count.load() : shm_ptr_->free_count.load();
+	TLOG(TLVL_WRITEREADY) << "WriteReadyCount(" << overwrite << "): " << count << " buffers";
+	return std::max(count, 0);
 }
 
 bool artdaq::SharedMemoryManager::ReadyForRead()
@@ -619,16 +998,22 @@ bool artdaq::SharedMemoryManager::ReadyForRead()
 		return false;
 	}
 	TLOG(TLVL_READREADY) << "0x" << std::hex << shm_key_ << " ReadyForRead BEGIN" << std::dec;
+	refreshSegments_();
+	if (readCountsApply_())
+	{
+		sweepStale_();
+		return shm_ptr_->ready_count > 0;
+	}
 	std::unique_lock<std::mutex> lk(search_mutex_);
 	// TraceLock lk(search_mutex_, 14, "ReadyForReadSearch");
 
 	auto rp = shm_ptr_->reader_pos.load();
 
-	TLOG(TLVL_READREADY) << "ReadyForRead lock acquired, scanning " << shm_ptr_->buffer_count << " buffers";
+	TLOG(TLVL_READREADY) << "ReadyForRead lock acquired, scanning " << bufferCount_() << " buffers";
 
-	for (auto ii = 0; ii < shm_ptr_->buffer_count; ++ii)
+	for (auto ii = 0; ii < bufferCount_(); ++ii)
 	{
-		auto buffer = (rp + ii) % shm_ptr_->buffer_count;
+		auto buffer = (rp + ii) % bufferCount_();
 
 #ifndef __OPTIMIZE__
 		TLOG(TLVL_READREADY + 1) << "0x" << std::hex << shm_key_ << std::dec << " ReadyForRead: Checking if buffer " << buffer << " is stale.";
@@ -645,10 +1030,9 @@ bool artdaq::SharedMemoryManager::ReadyForRead()
 		                         << " seq_id=" << buf->sequence_id << " >? " << last_seen_id_;
 #endif
 
-		if (buf->sem == BufferSemaphoreFlags::Full && (buf->sem_id == -1 || buf->sem_id == manager_id_) && (shm_ptr_->destructive_read_mode || buf->sequence_id > last_seen_id_))
+		if (readable_(buf))
 		{
 			TLOG(TLVL_READREADY + 3) << "0x" << std::hex << shm_key_ << std::dec << " ReadyForRead: Buffer " << buffer << " is either unowned or owned by this manager, and is marked full.";
-			touchBuffer_(buf);
 			return true;
 		}
 	}
@@ -656,39 +1040,51 @@ bool artdaq::SharedMemoryManager::ReadyForRead()
 }
 
 bool artdaq::SharedMemoryManager::ReadyForWrite(bool overwrite)
+{
+	return WriteReadyCount(overwrite) > 0;
+}
+
+int artdaq::SharedMemoryManager::GetWriteCredits()
 {
 	if (!IsValid())
 	{
-		return false;
+		return 0;
 	}
-	TLOG(TLVL_WRITEREADY) << "0x" << std::hex << shm_key_ << " ReadyForWrite BEGIN" << std::dec;
-
-	std::lock_guard<std::mutex> lk(search_mutex_);
-	// TraceLock lk(search_mutex_, 15, "ReadyForWriteSearch");
+	refreshSegments_();
+	return std::max(shm_ptr_->free_count.load(), 0);
+}
 
-	auto wp = shm_ptr_->writer_pos.load();
+double artdaq::SharedMemoryManager::GetConsumptionRate() const
+{
+	if (!IsValid())
+	{
+		return 0.0;
+	}
+	auto rate = shm_ptr_->consume_rate_mhz.load() / 1000.0;
 
-	TLOG(TLVL_WRITEREADY) << "ReadyForWrite lock acquired, scanning " << shm_ptr_->buffer_count << " buffers";
+	// If the readers stopped releasing buffers, nobody updated the published rate; bound it by what was consumed since
+	auto sample_time = shm_ptr_->consumed_sample_time_us.load();
+	auto sample_count = shm_ptr_->consumed_sample_count.load();
+	auto elapsed = TimeUtils::gettime_monotonic_coarse_us() - sample_time;
+	if (elapsed > 2 * CONSUMPTION_RATE_INTERVAL_US)
+	{
+		rate = std::min(rate, (shm_ptr_->consumed_count.load() - sample_count) * 1000000.0 / elapsed);
+	}
+	return rate;
+}
 
-	for (auto ii = 0; ii < shm_ptr_->buffer_count; ++ii)
+double artdaq::SharedMemoryManager::GetSuggestedWriteRate()
+{
+	auto credits = GetWriteCredits();
+	if (credits == 0)
 	{
-		auto buffer = (wp + ii) % shm_ptr_->buffer_count;
-		TLOG(TLVL_WRITEREADY + 1) << "0x" << std::hex << shm_key_ << std::dec << " ReadyForWrite: Checking if buffer " << buffer << " is stale.";
-		ResetBuffer(buffer);
-		auto buf = getBufferInfo_(buffer);
-		if (buf == nullptr)
-		{
-			continue;
-		}
-		if ((buf->sem == BufferSemaphoreFlags::Empty && buf->sem_id == -1) || (overwrite && buf->sem != BufferSemaphoreFlags::Writing))
-		{
-			TLOG(TLVL_WRITEREADY + 1) << "0x" << std::hex << shm_key_
-			                          << std::dec
-			                          << " WriteReadyCount: Buffer " << ii << " is either empty or available for overwrite.";
-			return true;
-		}
+		return 0.0;
 	}
-	return false;
+	if (shm_ptr_->consumed_count == 0)
+	{
+		return std::numeric_limits<double>::infinity();
+	}
+	return GetConsumptionRate() * 2.0 * credits / bufferCount_();
 }
 
 std::deque<int> artdaq::SharedMemoryManager::GetBuffersOwnedByManager(bool locked)
@@ -700,8 +1096,36 @@ std::deque<int> artdaq::SharedMemoryManager::GetBuffersOwnedByManager(bool locke
 		return output;
 	}
 	TLOG(TLVL_BUFFER) << "GetBuffersOwnedByManager BEGIN. Locked? " << locked;
-	if (locked)
+	auto slot = manager_id_ >= 0 ? &shm_ptr_->managers[manager_id_ % MANAGER_SLOTS] : nullptr;
+	if (slot != nullptr && slot->manager_id != manager_id_)
+	{
+		slot = nullptr;
+	}
+	if (slot != nullptr && !slot->owned_overflow)
+	{
+		for (auto& entry : slot->owned)
+		{
+			auto buffer = entry.load();
+			if (buffer < 0 || static_cast<size_t>(buffer) >= buffer_count)
+			{
+				continue;
+			}
+			auto buf = getBufferInfo_(buffer);
+			if (buf != nullptr && buf->sem_id == manager_id_)
+			{
+				output.push_back(buffer);
+			}
+		}
+		std::sort(output.begin(), output.end());
+	}
+	else if (locked)
 	{
+		// The list is rebuilt from the scan below. Cleared first, so that a buffer claimed during the scan sets it again
+		// if it does not fit (claim_ re-tracks buffers after taking them).
+		if (slot != nullptr)
+		{
+			slot->owned_overflow = false;
+		}
 		TLOG(TLVL_BUFLCK) << "GetBuffersOwnedByManager obtaining search_mutex";
 		std::lock_guard<std::mutex> lk(search_mutex_);
 		TLOG(TLVL_BUFLCK) << "GetBuffersOwnedByManager obtained search_mutex";
@@ -716,6 +1140,10 @@ std::deque<int> artdaq::SharedMemoryManager::GetBuffersOwnedByManager(bool locke
 			if (buf->sem_id == manager_id_)
 			{
 				output.push_back(ii);
+				if (slot != nullptr)
+				{
+					trackOwner_(manager_id_, buf, true);
+				}
 			}
 		}
 	}
@@ -739,52 +1167,356 @@ std::deque<int> artdaq::SharedMemoryManager::GetBuffersOwnedByManager(bool locke
 	return output;
 }
 
-size_t artdaq::SharedMemoryManager::BufferDataSize(int buffer)
+int artdaq::SharedMemoryManager::GetLatestFullBuffer(uint32_t& generation)
 {
-	TLOG(TLVL_BUFFER) << "BufferDataSize(" << buffer << ") called.";
-
-	if (!shm_ptr_ || buffer >= shm_ptr_->buffer_count)
+	if (!IsValid())
 	{
-		Detach(true, "ArgumentOutOfRange", "The specified buffer does not exist!");
+		return -1;
 	}
+	refreshSegments_();
 
-	TLOG(TLVL_BUFLCK) << "BufferDataSize obtaining buffer_mutex for buffer " << buffer;
-	std::lock_guard<std::mutex> lk(buffer_mutexes_[buffer]);
-	TLOG(TLVL_BUFLCK) << "BufferDataSize obtained buffer_mutex for buffer " << buffer;
-	// TraceLock lk(buffer_mutexes_[buffer], 17, "DataSizeBuffer" + std::to_string(buffer));
+	auto buffer = shm_ptr_->last_full_buffer.load();
+	if (buffer < 0 || buffer >= bufferCount_())
+	{
+		return -1;
+	}
+	generation = getBufferInfo_(buffer)->generation.load(std::memory_order_acquire);
+	if ((generation & 1) != 0)
+	{
+		TLOG(TLVL_READ) << "GetLatestFullBuffer: Buffer " << buffer << " is being re-used by a writer";
+		return -1;
+	}
+	return buffer;
+}
 
+bool artdaq::SharedMemoryManager::PeekIsValid(int buffer, uint32_t generation)
+{
 	auto buf = getBufferInfo_(buffer);
 	if (buf == nullptr)
 	{
-		return 0;
+		return false;
 	}
-	touchBuffer_(buf);
-
-	TLOG(TLVL_BUFFER) << "BufferDataSize: buffer " << buffer << ", size=" << buf->writePos;
-	return buf->writePos;
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return buf->generation.load(std::memory_order_relaxed) == generation;
 }
 
-void artdaq::SharedMemoryManager::ResetReadPos(int buffer)
+bool artdaq::SharedMemoryManager::PeekLatest(std::vector<uint8_t>& data, size_t& sequence_id)
 {
-	TLOG(TLVL_POS) << "ResetReadPos(" << buffer << ") called.";
-
-	if (buffer >= shm_ptr_->buffer_count)
+	// A retry only happens when a writer re-used the buffer during the copy, so a newer buffer is available
+	for (int attempt = 0; attempt < 3; ++attempt)
 	{
-		Detach(true, "ArgumentOutOfRange", "The specified buffer does not exist!");
-	}
-
-	TLOG(TLVL_BUFLCK) << "ResetReadPos obtaining buffer_mutex for buffer " << buffer;
-	std::lock_guard<std::mutex> lk(buffer_mutexes_[buffer]);
-	TLOG(TLVL_BUFLCK) << "ResetReadPos obtained buffer_mutex for buffer " << buffer;
+		uint32_t generation;
+		auto buffer = GetLatestFullBuffer(generation);
+		if (buffer == -1)
+		{
+			return false;
+		}
 
-	// TraceLock lk(buffer_mutexes_[buffer], 18, "ResetReadPosBuffer" + std::to_string(buffer));
-	auto buf = getBufferInfo_(buffer);
-	if ((buf == nullptr) || buf->sem_id != manager_id_)
-	{
+		// Every buffer of a chained event is checked against the generation it had before the copy
+		struct Piece
+		{
+			int buffer;
+			uint32_t generation;
+			size_t size;
+		};
+		std::vector<Piece> pieces;
+		size_t size = 0;
+		bool consistent = true;
+		sequence_id = getBufferInfo_(buffer)->sequence_id;
+		for (auto slot = buffer; slot != -1;)
+		{
+			auto buf = getBufferInfo_(slot);
+			auto slot_generation = slot == buffer ? generation : buf->generation.load(std::memory_order_acquire);
+			size_t slot_size = buf->writePos;
+			if ((slot_generation & 1) != 0 || slot_size > shm_ptr_->buffer_size || pieces.size() >= static_cast<size_t>(bufferCount_()))
+			{
+				consistent = false;
+				break;
+			}
+			pieces.push_back(Piece{slot, slot_generation, slot_size});
+			size += slot_size;
+			slot = buf->chain_next;
+			if (slot >= bufferCount_())
+			{
+				consistent = false;
+				break;
+			}
+		}
+		if (!consistent)
+		{
+			continue;
+		}
+
+		data.resize(size);
+		size_t copied = 0;
+		for (auto const& piece : pieces)
+		{
+			memcpy(data.data() + copied, bufferStart_(piece.buffer), piece.size);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+			copied += piece.size;
+		}
+
+		if (std::all_of(pieces.begin(), pieces.end(), [this](Piece const& piece) { return PeekIsValid(piece.buffer, piece.generation); }))
+		{
+			TLOG(TLVL_READ) << "PeekLatest: Copied " << size << " bytes from " << pieces.size() << " buffer(s) starting at buffer " << buffer << " (sequence ID " << sequence_id << ")";
+			return true;
+		}
+	}
+	TLOG(TLVL_READ) << "PeekLatest: Buffer was re-used during every attempt to copy it";
+	return false;
+}
+
+int artdaq::SharedMemoryManager::AddConsumerGroup(size_t prescale)
+{
+	if (!IsValid() || !shm_ptr_->destructive_read_mode)
+	{
+		TLOG(TLVL_WARNING) << "AddConsumerGroup: Consumer groups are only available on valid shared memory in destructive read mode";
+		return -1;
+	}
+
+	auto slots = shm_ptr_->consumer_group_slots.load();
+	for (int group = 1; group < MAX_CONSUMER_GROUPS; ++group)
+	{
+		auto bit = 1u << group;
+		if ((slots & bit) != 0)
+		{
+			continue;
+		}
+		if (!shm_ptr_->consumer_group_slots.compare_exchange_strong(slots, slots | bit))
+		{
+			group = 0;  // Another manager registered a group, start over
+			continue;
+		}
+		shm_ptr_->consumer_group_prescales[group] = static_cast<uint32_t>(prescale);
+		shm_ptr_->consumer_groups.fetch_or(bit);
+		TLOG(TLVL_INFO) << "AddConsumerGroup: Registered consumer group " << group << " with prescale " << prescale;
+		return group;
+	}
+
+	TLOG(TLVL_WARNING) << "AddConsumerGroup: All " << MAX_CONSUMER_GROUPS - 1 << " consumer groups are in use";
+	return -1;
+}
+
+void artdaq::SharedMemoryManager::RemoveConsumerGroup(int group)
+{
+	if (!IsValid() || group <= 0 || group >= MAX_CONSUMER_GROUPS)
+	{
 		return;
 	}
-	touchBuffer_(buf);
-	buf->readPos = 0;
+	auto bit = 1u << group;
+	if ((shm_ptr_->consumer_groups.fetch_and(~bit) & bit) == 0)
+	{
+		return;
+	}
+
+	refreshSegments_();
+	{
+		std::lock_guard<std::mutex> lk(search_mutex_);
+		for (auto ii = 0; ii < bufferCount_(); ++ii)
+		{
+			auto buf = getBufferInfo_(ii);
+			if (buf != nullptr && (buf->pending_groups & bit) != 0)
+			{
+				buf->group_claims.fetch_and(~bit);
+				releaseGroups_(buf, bit);
+			}
+		}
+	}
+	shm_ptr_->consumer_group_prescales[group] = 0;
+	shm_ptr_->consumer_group_slots.fetch_and(~bit);
+	TLOG(TLVL_INFO) << "RemoveConsumerGroup: Removed consumer group " << group;
+}
+
+bool artdaq::SharedMemoryManager::SetConsumerGroup(int group)
+{
+	if (group != 0 && (!IsValid() || group < 0 || group >= MAX_CONSUMER_GROUPS || (shm_ptr_->consumer_groups & (1u << group)) == 0))
+	{
+		TLOG(TLVL_WARNING) << "SetConsumerGroup: Consumer group " << group << " is not registered";
+		return false;
+	}
+	consumer_group_ = group;
+	return true;
+}
+
+bool artdaq::SharedMemoryManager::readable_(ShmBuffer* buffer) const
+{
+	if (isConsumerGroup_())
+	{
+		auto sem = buffer->sem.load();
+		return (sem == BufferSemaphoreFlags::Full || sem == BufferSemaphoreFlags::Reading) &&
+		       (buffer->pending_groups & groupBit_()) != 0 && (buffer->group_claims & groupBit_()) == 0;
+	}
+	return buffer->sem == BufferSemaphoreFlags::Full && (buffer->sem_id == -1 || buffer->sem_id == manager_id_) && (shm_ptr_->destructive_read_mode || buffer->sequence_id > last_seen_id_);
+}
+
+int artdaq::SharedMemoryManager::getBufferForGroup_()
+{
+	std::lock_guard<std::mutex> lk(search_mutex_);
+
+	for (int retry = 0; retry < 5; retry++)
+	{
+		int buffer_num = -1;
+		ShmBuffer* buffer_ptr = nullptr;
+		size_t seqID = -1;
+		for (auto ii = 0; ii < bufferCount_(); ++ii)
+		{
+			ResetBuffer(ii);
+			auto buf = getBufferInfo_(ii);
+			if (buf != nullptr && readable_(buf) && buf->sequence_id < seqID)
+			{
+				buffer_ptr = buf;
+				seqID = buf->sequence_id;
+				buffer_num = ii;
+			}
+		}
+		if (buffer_ptr == nullptr)
+		{
+			break;
+		}
+
+		// The group's reference keeps the buffer from being re-used, so once the claim is made, the state only needs checking once.
+		// An overwriting writer checks group_claims again after taking the buffer, and gives it back if this claim got in first.
+		if ((buffer_ptr->group_claims.fetch_or(groupBit_()) & groupBit_()) != 0)
+		{
+			continue;
+		}
+		auto sem = buffer_ptr->sem.load();
+		if ((sem != BufferSemaphoreFlags::Full && sem != BufferSemaphoreFlags::Reading) || (buffer_ptr->pending_groups & groupBit_()) == 0)
+		{
+			buffer_ptr->group_claims.fetch_and(~groupBit_());
+			continue;
+		}
+
+		groupOwned_(buffer_num) = true;
+		readPos_(buffer_num, buffer_ptr) = 0;
+		keepAlive_(buffer_ptr);
+		last_seen_id_ = seqID;
+		TLOG(TLVL_GETBUFFER) << "GetBufferForReading returning buffer " << buffer_num << " for consumer group " << consumer_group_;
+		return buffer_num;
+	}
+
+	TLOG(TLVL_GETBUFFER) << "GetBufferForReading returning -1 because no buffers are ready for consumer group " << consumer_group_;
+	return -1;
+}
+
+uint32_t artdaq::SharedMemoryManager::selectGroups_(size_t sequence_id) const
+{
+	uint32_t groups = shm_ptr_->consumer_groups;
+	uint32_t selected = 0;
+	for (int group = 1; groups != 0 && group < MAX_CONSUMER_GROUPS; ++group)
+	{
+		auto bit = 1u << group;
+		if ((groups & bit) == 0)
+		{
+			continue;
+		}
+		auto prescale = shm_ptr_->consumer_group_prescales[group].load();
+		if (prescale <= 1 || sequence_id % prescale == 0)
+		{
+			selected |= bit;
+		}
+	}
+	return selected;
+}
+
+void artdaq::SharedMemoryManager::releaseGroups_(ShmBuffer* buffer, uint32_t groups)
+{
+	auto previous = buffer->pending_groups.fetch_and(~groups);
+	if ((previous & groups) == 0 || (previous & ~groups) != 0)
+	{
+		return;
+	}
+
+	// Last reference released. The regular readers released theirs first, leaving the buffer held for the consumer groups.
+	TLOG(TLVL_POS + 3) << "Last consumer group reference to buffer with sequence ID " << buffer->sequence_id << " released, marking it Empty";
+	buffer->readPos = 0;
+	buffer->writePos = 0;
+	releaseChain_(buffer);
+	setSem_(buffer, BufferSemaphoreFlags::Empty);
+	disown_(buffer);
+	recordConsumed_();
+}
+
+size_t artdaq::SharedMemoryManager::BufferDataSize(int buffer)
+{
+	TLOG(TLVL_BUFFER) << "BufferDataSize(" << buffer << ") called.";
+
+	if (!shm_ptr_ || buffer >= bufferCount_())
+	{
+		Detach(true, "ArgumentOutOfRange", "The specified buffer does not exist!");
+	}
+
+	TLOG(TLVL_BUFLCK) << "BufferDataSize obtaining buffer_mutex for buffer " << buffer;
+	std::lock_guard<std::mutex> lk(bufferMutex_(buffer));
+	TLOG(TLVL_BUFLCK) << "BufferDataSize obtained buffer_mutex for buffer " << buffer;
+	// TraceLock lk(buffer_mutexes_[buffer], 17, "DataSizeBuffer" + std::to_string(buffer));
+
+	auto buf = getBufferInfo_(buffer);
+	if (buf == nullptr)
+	{
+		return 0;
+	}
+	keepAlive_(buf);
+
+	auto size = chainDataSize_(buf);
+	TLOG(TLVL_BUFFER) << "BufferDataSize: buffer " << buffer << ", size=" << size;
+	return size;
+}
+
+size_t artdaq::SharedMemoryManager::GetChainLength(int buffer)
+{
+	if (buffer >= bufferCount_())
+	{
+		Detach(true, "ArgumentOutOfRange", "The specified buffer does not exist!");
+	}
+	size_t length = 0;
+	for (auto buf = getBufferInfo_(buffer); buf != nullptr; buf = buf->chain_next == -1 ? nullptr : getBufferInfo_(buf->chain_next))
+	{
+		++length;
+	}
+	return length;
+}
+
+std::vector<std::pair<uint8_t const*, size_t>> artdaq::SharedMemoryManager::GetGatherView(int buffer)
+{
+	if (buffer >= bufferCount_())
+	{
+		Detach(true, "ArgumentOutOfRange", "The specified buffer does not exist!");
+	}
+	std::vector<std::pair<uint8_t const*, size_t>> view;
+	while (buffer != -1)
+	{
+		auto buf = getBufferInfo_(buffer);
+		if (buf == nullptr)
+		{
+			break;
+		}
+		view.emplace_back(bufferStart_(buffer), buf->writePos);
+		buffer = buf->chain_next;
+	}
+	return view;
+}
+
+void artdaq::SharedMemoryManager::ResetReadPos(int buffer)
+{
+	TLOG(TLVL_POS) << "ResetReadPos(" << buffer << ") called.";
+
+	if (buffer >= bufferCount_())
+	{
+		Detach(true, "ArgumentOutOfRange", "The specified buffer does not exist!");
+	}
+
+	TLOG(TLVL_BUFLCK) << "ResetReadPos obtaining buffer_mutex for buffer " << buffer;
+	std::lock_guard<std::mutex> lk(bufferMutex_(buffer));
+	TLOG(TLVL_BUFLCK) << "ResetReadPos obtained buffer_mutex for buffer " << buffer;
+
+	// TraceLock lk(buffer_mutexes_[buffer], 18, "ResetReadPosBuffer" + std::to_string(buffer));
+	auto buf = getBufferInfo_(buffer);
+	if ((buf == nullptr) || !ownsForRead_(buf))
+	{
+		return;
+	}
+	keepAlive_(buf);
+	readPos_(buffer, buf) = 0;
 
 	TLOG(TLVL_POS) << "ResetReadPos(" << buffer << ") ended.";
 }
@@ -793,13 +1525,13 @@ void artdaq::SharedMemoryManager::ResetWritePos(int buffer)
 {
 	TLOG(TLVL_POS + 1) << "ResetWritePos(" << buffer << ") called.";
 
-	if (buffer >= shm_ptr_->buffer_count)
+	if (buffer >= bufferCount_())
 	{
 		Detach(true, "ArgumentOutOfRange", "The specified buffer does not exist!");
 	}
 
 	TLOG(TLVL_BUFLCK) << "ResetWritePos obtaining buffer_mutex for buffer " << buffer;
-	std::lock_guard<std::mutex> lk(buffer_mutexes_[buffer]);
+	std::lock_guard<std::mutex> lk(bufferMutex_(buffer));
 	TLOG(TLVL_BUFLCK) << "ResetWritePos obtained buffer_mutex for buffer " << buffer;
 
 	// TraceLock lk(buffer_mutexes_[buffer], 18, "ResetWritePosBuffer" + std::to_string(buffer));
@@ -809,7 +1541,7 @@ void artdaq::SharedMemoryManager::ResetWritePos(int buffer)
 		return;
 	}
 	checkBuffer_(buf, BufferSemaphoreFlags::Writing);
-	touchBuffer_(buf);
+	keepAlive_(buf);
 	buf->writePos = 0;
 
 	TLOG(TLVL_POS + 1) << "ResetWritePos(" << buffer << ") ended.";
@@ -819,27 +1551,28 @@ void artdaq::SharedMemoryManager::IncrementReadPos(int buffer, size_t read)
 {
 	TLOG(TLVL_POS) << "IncrementReadPos called: buffer= " << buffer << ", bytes to read=" << read;
 
-	if (buffer >= shm_ptr_->buffer_count)
+	if (buffer >= bufferCount_())
 	{
 		Detach(true, "ArgumentOutOfRange", "The specified buffer does not exist!");
 	}
 
 	TLOG(TLVL_BUFLCK) << "IncrementReadPos obtaining buffer_mutex for buffer " << buffer;
-	std::lock_guard<std::mutex> lk(buffer_mutexes_[buffer]);
+	std::lock_guard<std::mutex> lk(bufferMutex_(buffer));
 	TLOG(TLVL_BUFLCK) << "IncrementReadPos obtained buffer_mutex for buffer " << buffer;
 	// TraceLock lk(buffer_mutexes_[buffer], 19, "IncReadPosBuffer" + std::to_string(buffer));
 	auto buf = getBufferInfo_(buffer);
-	if ((buf == nullptr) || buf->sem_id != manager_id_)
+	if ((buf == nullptr) || !ownsForRead_(buf))
 	{
 		return;
 	}
-	touchBuffer_(buf);
-	TLOG(TLVL_POS) << "IncrementReadPos: buffer= " << buffer << ", readPos=" << buf->readPos << ", bytes read=" << read;
-	buf->readPos = buf->readPos + read;
-	TLOG(TLVL_POS) << "IncrementReadPos: buffer= " << buffer << ", New readPos is " << buf->readPos;
+	keepAlive_(buf);
+	auto& readPos = readPos_(buffer, buf);
+	TLOG(TLVL_POS) << "IncrementReadPos: buffer= " << buffer << ", readPos=" << readPos << ", bytes read=" << read;
+	readPos = readPos + read;
+	TLOG(TLVL_POS) << "IncrementReadPos: buffer= " << buffer << ", New readPos is " << readPos;
 	if (read == 0)
 	{
-		Detach(true, "LogicError", "Cannot increment Read pos by 0! (buffer=" + std::to_string(buffer) + ", readPos=" + std::to_string(buf->readPos) + ", writePos=" + std::to_string(buf->writePos) + ")");
+		Detach(true, "LogicError", "Cannot increment Read pos by 0! (buffer=" + std::to_string(buffer) + ", readPos=" + std::to_string(readPos) + ", writePos=" + std::to_string(buf->writePos) + ")");
 	}
 }
 
@@ -847,13 +1580,13 @@ bool artdaq::SharedMemoryManager::IncrementWritePos(int buffer, size_t written)
 {
 	TLOG(TLVL_POS + 1) << "IncrementWritePos called: buffer= " << buffer << ", bytes written=" << written;
 
-	if (buffer >= shm_ptr_->buffer_count)
+	if (buffer >= bufferCount_())
 	{
 		Detach(true, "ArgumentOutOfRange", "The specified buffer does not exist!");
 	}
 
 	TLOG(TLVL_BUFLCK) << "IncrementWritePos obtaining buffer_mutex for buffer " << buffer;
-	std::lock_guard<std::mutex> lk(buffer_mutexes_[buffer]);
+	std::lock_guard<std::mutex> lk(bufferMutex_(buffer));
 	TLOG(TLVL_BUFLCK) << "IncrementWritePos obtained buffer_mutex for buffer " << buffer;
 	// TraceLock lk(buffer_mutexes_[buffer], 20, "IncWritePosBuffer" + std::to_string(buffer));
 	auto buf = getBufferInfo_(buffer);
@@ -862,7 +1595,7 @@ bool artdaq::SharedMemoryManager::IncrementWritePos(int buffer, size_t written)
 		return false;
 	}
 	checkBuffer_(buf, BufferSemaphoreFlags::Writing);
-	touchBuffer_(buf);
+	keepAlive_(buf);
 	if (buf->writePos + written > shm_ptr_->buffer_size)
 	{
 		TLOG(TLVL_ERROR) << "Requested write size is larger than the buffer size! (sz=" << std::hex << shm_ptr_->buffer_size << ", cur + req=" << std::dec << buf->writePos + written << ")";
@@ -883,13 +1616,13 @@ bool artdaq::SharedMemoryManager::MoreDataInBuffer(int buffer)
 {
 	TLOG(TLVL_POS + 2) << "MoreDataInBuffer(" << buffer << ") called.";
 
-	if (buffer >= shm_ptr_->buffer_count)
+	if (buffer >= bufferCount_())
 	{
 		Detach(true, "ArgumentOutOfRange", "The specified buffer does not exist!");
 	}
 
 	TLOG(TLVL_BUFLCK) << "MoreDataInBuffer obtaining buffer_mutex for buffer " << buffer;
-	std::lock_guard<std::mutex> lk(buffer_mutexes_[buffer]);
+	std::lock_guard<std::mutex> lk(bufferMutex_(buffer));
 	TLOG(TLVL_BUFLCK) << "MoreDataInBuffer obtained buffer_mutex for buffer " << buffer;
 	// TraceLock lk(buffer_mutexes_[buffer], 21, "MoreDataInBuffer" + std::to_string(buffer));
 	auto buf = getBufferInfo_(buffer);
@@ -897,19 +1630,20 @@ bool artdaq::SharedMemoryManager::MoreDataInBuffer(int buffer)
 	{
 		return false;
 	}
-	TLOG(TLVL_POS + 2) << "MoreDataInBuffer: buffer= " << buffer << ", readPos=" << std::to_string(buf->readPos) << ", writePos=" << buf->writePos;
-	return buf->readPos < buf->writePos;
+	auto readPos = readPos_(buffer, buf);
+	TLOG(TLVL_POS + 2) << "MoreDataInBuffer: buffer= " << buffer << ", readPos=" << std::to_string(readPos) << ", writePos=" << buf->writePos;
+	return readPos < chainDataSize_(buf);
 }
 
 bool artdaq::SharedMemoryManager::CheckBuffer(int buffer, BufferSemaphoreFlags flags)
 {
-	if (buffer >= shm_ptr_->buffer_count)
+	if (buffer >= bufferCount_())
 	{
 		Detach(true, "ArgumentOutOfRange", "The specified buffer does not exist!");
 	}
 
 	TLOG(TLVL_BUFLCK) << "CheckBuffer obtaining buffer_mutex for buffer " << buffer;
-	std::lock_guard<std::mutex> lk(buffer_mutexes_[buffer]);
+	std::lock_guard<std::mutex> lk(bufferMutex_(buffer));
 	TLOG(TLVL_BUFLCK) << "CheckBuffer obtained buffer_mutex for buffer " << buffer;
 	// TraceLock lk(buffer_mutexes_[buffer], 22, "CheckBuffer" + std::to_string(buffer));
 	return checkBuffer_(getBufferInfo_(buffer), flags, false);
@@ -917,13 +1651,13 @@ bool artdaq::SharedMemoryManager::CheckBuffer(int buffer, BufferSemaphoreFlags f
 
 void artdaq::SharedMemoryManager::MarkBufferFull(int buffer, int destination)
 {
-	if (buffer >= shm_ptr_->buffer_count)
+	if (buffer >= bufferCount_())
 	{
 		Detach(true, "ArgumentOutOfRange", "The specified buffer does not exist!");
 	}
 
 	TLOG(TLVL_BUFLCK) << "MarkBufferFull obtaining buffer_mutex for buffer " << buffer;
-	std::lock_guard<std::mutex> lk(buffer_mutexes_[buffer]);
+	std::lock_guard<std::mutex> lk(bufferMutex_(buffer));
 	TLOG(TLVL_BUFLCK) << "MarkBufferFull obtained buffer_mutex for buffer " << buffer;
 
 	// TraceLock lk(buffer_mutexes_[buffer], 23, "FillBuffer" + std::to_string(buffer));
@@ -935,23 +1669,64 @@ void artdaq::SharedMemoryManager::MarkBufferFull(int buffer, int destination)
 	touchBuffer_(shmBuf);
 	if (shmBuf->sem_id == manager_id_)
 	{
-		if (shmBuf->sem != BufferSemaphoreFlags::Full)
+		markFull_(buffer, shmBuf, destination);
+	}
+}
+
+void artdaq::SharedMemoryManager::markFull_(int buffer, ShmBuffer* shmBuf, int destination)
+{
+	shmBuf->regions_expected = 0;
+	if (shmBuf->sem == BufferSemaphoreFlags::Writing)
+	{
+		shmBuf->generation.store((shmBuf->generation.load() | 1) + 1);
+		shmBuf->pending_groups = 1u | selectGroups_(shmBuf->sequence_id);
+		shmBuf->locality = locality_;
+		commitChain_(shmBuf);
+		indexSequence_(buffer, shmBuf);
+		shm_ptr_->last_full_buffer = buffer;
+	}
+	auto notify = shmBuf->sem != BufferSemaphoreFlags::Full;
+	if (notify)
+	{
+		setSem_(shmBuf, BufferSemaphoreFlags::Full);
+	}
+
+	if (destination == -1)
+	{
+		disown_(shmBuf);
+	}
+	else
+	{
+		// Counted before the destination is set, so that readers scan as soon as the buffer is readable only by it
+		if (!shmBuf->targeted.exchange(true) && shm_ptr_->targeted_full_count++ == 0)
 		{
-			shmBuf->sem = BufferSemaphoreFlags::Full;
+			TLOG(TLVL_BUFFER) << "Buffer " << buffer << " marked Full for manager " << destination << ", readiness queries scan the buffers until it is read";
+		}
+		auto previous = shmBuf->sem_id.exchange(destination);
+		if (previous == -1)
+		{
+			countUnowned_(shmBuf->sem, -1);
+		}
+		if (previous != destination)
+		{
+			trackOwner_(previous, shmBuf, false);
+			trackOwner_(destination, shmBuf, true);
 		}
-
-		shmBuf->sem_id = destination;
+	}
+	if (notify)
+	{
+		notifyFull_();
 	}
 }
 
 void artdaq::SharedMemoryManager::MarkBufferEmpty(int buffer, bool force, bool detachOnException)
 {
 	TLOG(TLVL_POS + 3) << "MarkBufferEmpty BEGIN, buffer=" << buffer << ", force=" << force << ", manager_id_=" << manager_id_;
-	if (buffer >= shm_ptr_->buffer_count)
+	if (buffer >= bufferCount_())
 	{
 		Detach(true, "ArgumentOutOfRange", "The specified buffer does not exist!");
 	}
-	std::lock_guard<std::mutex> lk(buffer_mutexes_[buffer]);
+	std::lock_guard<std::mutex> lk(bufferMutex_(buffer));
 	// TraceLock lk(buffer_mutexes_[buffer], 24, "EmptyBuffer" + std::to_string(buffer));
 	auto shmBuf = getBufferInfo_(buffer);
 	if (shmBuf == nullptr)
@@ -963,36 +1738,78 @@ void artdaq::SharedMemoryManager::MarkBufferEmpty(int buffer, bool force, bool d
 		auto ret = checkBuffer_(shmBuf, BufferSemaphoreFlags::Reading, detachOnException);
 		if (!ret) return;
 	}
+
+	if (isConsumerGroup_())
+	{
+		if (claimedByGroup_(shmBuf))
+		{
+			TLOG(TLVL_POS + 3) << "MarkBufferEmpty Releasing buffer " << buffer << " for consumer group " << consumer_group_;
+			keepAlive_(shmBuf);
+			// Cleared before the claim, so that Detach cannot release a claim made by another reader in the group
+			groupOwned_(buffer) = false;
+			shmBuf->group_claims.fetch_and(~groupBit_());
+			releaseGroups_(shmBuf, groupBit_());
+		}
+		return;
+	}
+
+	auto owner = shmBuf->sem_id.load();
+	if (force && owner == -1 && shmBuf->sem_id.compare_exchange_strong(owner, manager_id_))
+	{
+		// Taken first, so that the buffer counters see it leave its unowned state
+		countUnowned_(shmBuf->sem, -1);
+		trackOwner_(manager_id_, shmBuf, true);
+	}
 	touchBuffer_(shmBuf);
 
 	shmBuf->readPos = 0;
-	shmBuf->sem = BufferSemaphoreFlags::Full;
+	setSem_(shmBuf, BufferSemaphoreFlags::Full);
+
+	if (!force && shm_ptr_->destructive_read_mode && (shmBuf->pending_groups & ~1u) != 0)
+	{
+		// Consumer groups still reference the buffer. Whoever releases it last marks it Empty.
+		TLOG(TLVL_POS + 3) << "MarkBufferEmpty Buffer " << buffer << " is still referenced by consumer groups 0x" << std::hex << (shmBuf->pending_groups & ~1u);
+		trackOwner_(shmBuf->sem_id.exchange(HELD_BY_CONSUMER_GROUPS), shmBuf, false);
+		releaseGroups_(shmBuf, 1u);
+		return;
+	}
 
-	if ((force && (manager_id_ == 0 || manager_id_ == shmBuf->sem_id)) || (!force && shm_ptr_->destructive_read_mode))
+	if ((force && (manager_id_ == 0 || manager_id_ == owner)) || (!force && shm_ptr_->destructive_read_mode))
 	{
 		TLOG(TLVL_POS + 3) << "MarkBufferEmpty Resetting buffer " << buffer << " to Empty state";
+		shmBuf->pending_groups = 0;
 		shmBuf->writePos = 0;
-		shmBuf->sem = BufferSemaphoreFlags::Empty;
+		releaseChain_(shmBuf);
+		setSem_(shmBuf, BufferSemaphoreFlags::Empty);
+		if (!force)
+		{
+			recordConsumed_();
+		}
 		if (shm_ptr_->reader_pos == static_cast<unsigned>(buffer) && !shm_ptr_->destructive_read_mode)
 		{
-			TLOG(TLVL_POS + 3) << "MarkBufferEmpty Broadcast mode; incrementing reader_pos from " << shm_ptr_->reader_pos << " to " << (buffer + 1) % shm_ptr_->buffer_count;
-			shm_ptr_->reader_pos = (buffer + 1) % shm_ptr_->buffer_count;
+			TLOG(TLVL_POS + 3) << "MarkBufferEmpty Broadcast mode; incrementing reader_pos from " << shm_ptr_->reader_pos << " to " << (buffer + 1) % bufferCount_();
+			shm_ptr_->reader_pos = (buffer + 1) % bufferCount_();
 		}
 	}
-	shmBuf->sem_id = -1;
+	disown_(shmBuf);
+	if (!shm_ptr_->destructive_read_mode && shmBuf->sem == BufferSemaphoreFlags::Full)
+	{
+		// Other broadcast readers may have skipped the buffer while this one was reading it
+		notifyFull_();
+	}
 	TLOG(TLVL_POS + 3) << "MarkBufferEmpty END, buffer=" << buffer << ", force=" << force;
 }
 
 bool artdaq::SharedMemoryManager::ResetBuffer(int buffer)
 {
-	if (buffer >= shm_ptr_->buffer_count)
+	if (buffer >= bufferCount_())
 	{
 		Detach(true, "ArgumentOutOfRange", "The specified buffer does not exist!");
 	}
 
 	// ELF, 3/19/2019: These TRACE calls are a major performance hit with many buffers.
 	// TLOG(TLVL_BUFLCK) << "ResetBuffer: obtaining buffer_mutex lock for buffer " << buffer;
-	std::lock_guard<std::mutex> lk(buffer_mutexes_[buffer]);
+	std::lock_guard<std::mutex> lk(bufferMutex_(buffer));
 	// TLOG(TLVL_BUFLCK) << "ResetBuffer: obtained buffer_mutex lock for buffer " << buffer;
 
 	// TraceLock lk(buffer_mutexes_[buffer], 25, "ResetBuffer" + std::to_string(buffer));
@@ -1011,33 +1828,70 @@ bool artdaq::SharedMemoryManager::ResetBuffer(int buffer)
 	        return true;
 	    }*/
 
-	size_t delta = TimeUtils::gettimeofday_us() - shmBuf->last_touch_time;
+	auto now = TimeUtils::gettime_monotonic_coarse_us();
+	size_t delta = now - shmBuf->last_touch_time;
 	if (delta > 0xFFFFFFFF)
 	{
 		TLOG(TLVL_RESET) << "Buffer has touch time in the future, setting it to current time and ignoring...";
-		shmBuf->last_touch_time = TimeUtils::gettimeofday_us();
+		shmBuf->last_touch_time = now;
 		return false;
 	}
-	if (shm_ptr_->buffer_timeout_us == 0 || delta <= shm_ptr_->buffer_timeout_us || shmBuf->sem == BufferSemaphoreFlags::Empty)
+	if (shm_ptr_->buffer_timeout_us == 0 || delta <= shm_ptr_->buffer_timeout_us || (shmBuf->sem == BufferSemaphoreFlags::Empty && shmBuf->sem_id == -1))
 	{
 		return false;
 	}
-	TLOG(TLVL_RESET) << "Buffer " << buffer << " at " << static_cast<void*>(shmBuf) << " is stale, time=" << TimeUtils::gettimeofday_us() << ", last touch=" << shmBuf->last_touch_time << ", d=" << delta << ", timeout=" << shm_ptr_->buffer_timeout_us;
+	TLOG(TLVL_RESET) << "Buffer " << buffer << " at " << static_cast<void*>(shmBuf) << " is stale, time=" << now << ", last touch=" << shmBuf->last_touch_time << ", d=" << delta << ", timeout=" << shm_ptr_->buffer_timeout_us;
 
 	if (shmBuf->sem_id == manager_id_ && shmBuf->sem == BufferSemaphoreFlags::Writing)
 	{
 		return true;
 	}
 
-	if (!shm_ptr_->destructive_read_mode && shmBuf->sem == BufferSemaphoreFlags::Full && manager_id_ == 0)
+	// A manager killed in the middle of a state transition leaves its ID on the buffer. Live managers may keep
+	// buffers for longer than the timeout, so this is only undone once the process is gone.
+	auto sem_id = shmBuf->sem_id.load();
+	if (sem_id >= 0 && sem_id != manager_id_ && shmBuf->sem != BufferSemaphoreFlags::Reading && managerIsGone_(sem_id))
+	{
+		size_t since_touch = TimeUtils::gettime_monotonic_coarse_us() - shmBuf->last_touch_time;
+		if (since_touch <= shm_ptr_->buffer_timeout_us)
+		{
+			return false;
+		}
+		auto sem = shmBuf->sem.load();
+		TLOG(TLVL_WARNING) << "Buffer " << buffer << " at " << static_cast<void*>(shmBuf) << " (seqid=" << shmBuf->sequence_id << ", state "
+		                   << FlagToString(sem) << ") belongs to manager " << sem_id << ", whose process no longer exists! Releasing it...";
+		if (sem == BufferSemaphoreFlags::Writing)
+		{
+			shmBuf->writePos = 0;
+			shmBuf->regions_expected = 0;
+			setSem_(shmBuf, BufferSemaphoreFlags::Empty);
+		}
+		disown_(shmBuf);
+		// The manager may have died between changing the buffer and updating the buffer counters
+		recount_needed_ = true;
+		if (sem == BufferSemaphoreFlags::Full)
+		{
+			notifyFull_();
+		}
+		return true;
+	}
+
+	if (!shm_ptr_->destructive_read_mode && shmBuf->sem == BufferSemaphoreFlags::Full && shmBuf->sem_id != CHAINED_CONTINUATION && manager_id_ == 0)
 	{
+		int16_t unowned = -1;
+		if (!shmBuf->sem_id.compare_exchange_strong(unowned, manager_id_))
+		{
+			return false;
+		}
+		countUnowned_(BufferSemaphoreFlags::Full, -1);
 		TLOG(TLVL_RESET) << "Resetting old broadcast mode buffer " << buffer << " (seqid=" << shmBuf->sequence_id << "). State: Full-->Empty";
 		shmBuf->writePos = 0;
-		shmBuf->sem = BufferSemaphoreFlags::Empty;
-		shmBuf->sem_id = -1;
+		releaseChain_(shmBuf);
+		setSem_(shmBuf, BufferSemaphoreFlags::Empty);
+		disown_(shmBuf);
 		if (shm_ptr_->reader_pos == static_cast<unsigned>(buffer))
 		{
-			shm_ptr_->reader_pos = (buffer + 1) % shm_ptr_->buffer_count;
+			shm_ptr_->reader_pos = (buffer + 1) % bufferCount_();
 		}
 		return true;
 	}
@@ -1045,17 +1899,27 @@ bool artdaq::SharedMemoryManager::ResetBuffer(int buffer)
 	if (shmBuf->sem_id != manager_id_ && shmBuf->sem == BufferSemaphoreFlags::Reading)
 	{
 		// Ron wants to re-check for potential interleave of buffer state updates
-		size_t delta = TimeUtils::gettimeofday_us() - shmBuf->last_touch_time;
-		if (delta <= shm_ptr_->buffer_timeout_us)
+		size_t since_touch = TimeUtils::gettime_monotonic_coarse_us() - shmBuf->last_touch_time;
+		if (since_touch <= shm_ptr_->buffer_timeout_us)
 		{
 			return false;
 		}
 		TLOG(TLVL_WARNING) << "Stale Read buffer " << buffer << " at " << static_cast<void*>(shmBuf)
-		                   << " ( " << delta << " / " << shm_ptr_->buffer_timeout_us << " us ) detected! (seqid="
+		                   << " ( " << since_touch << " / " << shm_ptr_->buffer_timeout_us << " us ) detected! (seqid="
 		                   << shmBuf->sequence_id << ") Resetting... Reading-->Full";
 		shmBuf->readPos = 0;
-		shmBuf->sem = BufferSemaphoreFlags::Full;
-		shmBuf->sem_id = -1;
+		setSem_(shmBuf, BufferSemaphoreFlags::Full);
+		disown_(shmBuf);
+		notifyFull_();
+		return true;
+	}
+
+	if (shmBuf->sem == BufferSemaphoreFlags::Full && shmBuf->sem_id == HELD_BY_CONSUMER_GROUPS)
+	{
+		TLOG(TLVL_WARNING) << "Stale consumer group references to buffer " << buffer << " (groups 0x" << std::hex << shmBuf->pending_groups
+		                   << std::dec << ", seqid=" << shmBuf->sequence_id << ") detected! Releasing... Full-->Empty";
+		shmBuf->group_claims = 0;
+		releaseGroups_(shmBuf, shmBuf->pending_groups.load());
 		return true;
 	}
 	return false;
@@ -1106,11 +1970,11 @@ uint16_t artdaq::SharedMemoryManager::GetAttachedCount() const
 size_t artdaq::SharedMemoryManager::Write(int buffer, void* data, size_t size)
 {
 	TLOG(TLVL_WRITE) << "Write BEGIN";
-	if (buffer >= shm_ptr_->buffer_count)
+	if (buffer >= bufferCount_())
 	{
 		Detach(true, "ArgumentOutOfRange", "The specified buffer does not exist!");
 	}
-	std::lock_guard<std::mutex> lk(buffer_mutexes_[buffer]);
+	std::unique_lock<std::mutex> lk(bufferMutex_(buffer));
 	// TraceLock lk(buffer_mutexes_[buffer], 26, "WriteBuffer" + std::to_string(buffer));
 	auto shmBuf = getBufferInfo_(buffer);
 	if (shmBuf == nullptr)
@@ -1118,20 +1982,27 @@ size_t artdaq::SharedMemoryManager::Write(int buffer, void* data, size_t size)
 		return -1;
 	}
 	checkBuffer_(shmBuf, BufferSemaphoreFlags::Writing);
-	touchBuffer_(shmBuf);
+	keepAlive_(shmBuf);
 	TLOG(TLVL_WRITE) << "Buffer Write Pos is " << std::hex << std::showbase << shmBuf->writePos << ", write size is " << size;
-	if (shmBuf->writePos + size > shm_ptr_->buffer_size)
+	if (shmBuf->writePos + size > shm_ptr_->buffer_size || shmBuf->chain_next != -1)
+	{
+		if (max_chain_length_ <= 1)
+		{
+			TLOG(TLVL_ERROR) << "Attempted to write more data than fits into Shared Memory, bufferSize=" << std::hex << std::showbase << shm_ptr_->buffer_size
+			                 << ",writePos=" << shmBuf->writePos << ",writeSize=" << size;
+			Detach(true, "SharedMemoryWrite", "Attempted to write more data than fits into Shared Memory! \nRe-run with a larger buffer size!");
+		}
+		// Claiming continuation buffers takes the search mutex, which must not be taken while holding a buffer mutex
+		lk.unlock();
+		writeChained_(buffer, static_cast<uint8_t const*>(data), size);
+	}
+	else
 	{
-		TLOG(TLVL_ERROR) << "Attempted to write more data than fits into Shared Memory, bufferSize=" << std::hex << std::showbase << shm_ptr_->buffer_size
-		                 << ",writePos=" << shmBuf->writePos << ",writeSize=" << size;
-		Detach(true, "SharedMemoryWrite", "Attempted to write more data than fits into Shared Memory! \nRe-run with a larger buffer size!");
+		auto pos = GetWritePos(buffer);
+		memcpy(pos, data, size);
+		shmBuf->writePos = shmBuf->writePos + size;
 	}
 
-	auto pos = GetWritePos(buffer);
-	memcpy(pos, data, size);
-	touchBuffer_(shmBuf);
-	shmBuf->writePos = shmBuf->writePos + size;
-
 	auto last_seen = last_seen_id_.load();
 	while (last_seen < shmBuf->sequence_id && !last_seen_id_.compare_exchange_weak(last_seen, shmBuf->sequence_id)) {}
 
@@ -1139,40 +2010,136 @@ size_t artdaq::SharedMemoryManager::Write(int buffer, void* data, size_t size)
 	return size;
 }
 
-bool artdaq::SharedMemoryManager::Read(int buffer, void* data, size_t size)
+bool artdaq::SharedMemoryManager::BeginSharedWrite(int buffer, uint32_t expected_regions, int destination)
 {
-	if (buffer >= shm_ptr_->buffer_count)
+	if (buffer >= bufferCount_())
 	{
 		Detach(true, "ArgumentOutOfRange", "The specified buffer does not exist!");
 	}
-	std::lock_guard<std::mutex> lk(buffer_mutexes_[buffer]);
-	// TraceLock lk(buffer_mutexes_[buffer], 27, "ReadBuffer" + std::to_string(buffer));
+	std::lock_guard<std::mutex> lk(bufferMutex_(buffer));
 	auto shmBuf = getBufferInfo_(buffer);
-	if (shmBuf == nullptr)
+	if (shmBuf == nullptr || expected_regions == 0 || !checkBuffer_(shmBuf, BufferSemaphoreFlags::Writing, false))
 	{
 		return false;
 	}
-	checkBuffer_(shmBuf, BufferSemaphoreFlags::Reading);
-	touchBuffer_(shmBuf);
-	if (shmBuf->readPos + size > shm_ptr_->buffer_size)
-	{
-		TLOG(TLVL_ERROR) << "Attempted to read more data than fits into Shared Memory, bufferSize=" << shm_ptr_->buffer_size
-		                 << ",readPos=" << shmBuf->readPos << ",readSize=" << size;
-		Detach(true, "SharedMemoryRead", "Attempted to read more data than exists in Shared Memory!");
-	}
+	TLOG(TLVL_WRITE) << "BeginSharedWrite: Buffer " << buffer << " expects " << expected_regions << " regions after " << shmBuf->writePos << " bytes";
+	keepAlive_(shmBuf);
+	shmBuf->shared_write_destination = static_cast<int16_t>(destination);
+	shmBuf->regions_committed = 0;
+	shmBuf->regions_expected = expected_regions;
+	return true;
+}
 
-	auto pos = GetReadPos(buffer);
-	TLOG(TLVL_READ) << "Before memcpy in Read(), size is " << size;
-	memcpy(data, pos, size);
-	TLOG(TLVL_READ) << "After memcpy in Read()";
-	auto sts = checkBuffer_(shmBuf, BufferSemaphoreFlags::Reading, false);
-	if (sts)
+void* artdaq::SharedMemoryManager::ReserveRegion(int buffer, size_t size)
+{
+	if (buffer >= bufferCount_())
 	{
-		shmBuf->readPos += size;
-		touchBuffer_(shmBuf);
-		return true;
+		Detach(true, "ArgumentOutOfRange", "The specified buffer does not exist!");
 	}
-	return false;
+	auto shmBuf = getBufferInfo_(buffer);
+	if (shmBuf == nullptr || shmBuf->regions_expected == 0 || shmBuf->sem != BufferSemaphoreFlags::Writing)
+	{
+		TLOG(TLVL_WARNING) << "ReserveRegion: Buffer " << buffer << " is not open for shared writes";
+		return nullptr;
+	}
+
+	// Compare-and-swap rather than fetch_add, so that a region which does not fit does not move the cursor past the end
+	auto pos = shmBuf->writePos.load();
+	do
+	{
+		if (pos + size > shm_ptr_->buffer_size)
+		{
+			TLOG(TLVL_WARNING) << "ReserveRegion: Region of " << size << " bytes does not fit into buffer " << buffer << " at position " << pos;
+			return nullptr;
+		}
+	} while (!shmBuf->writePos.compare_exchange_weak(pos, pos + size));
+
+	shmBuf->last_touch_time = TimeUtils::gettime_monotonic_coarse_us();
+	TLOG(TLVL_WRITE) << "ReserveRegion: Reserved " << size << " bytes at position " << pos << " of buffer " << buffer;
+	return bufferStart_(buffer) + pos;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+}
+
+bool artdaq::SharedMemoryManager::CommitRegion(int buffer)
+{
+	if (buffer >= bufferCount_())
+	{
+		Detach(true, "ArgumentOutOfRange", "The specified buffer does not exist!");
+	}
+	auto shmBuf = getBufferInfo_(buffer);
+	auto expected = shmBuf != nullptr ? shmBuf->regions_expected.load() : 0;
+	if (expected == 0)
+	{
+		TLOG(TLVL_WARNING) << "CommitRegion: Buffer " << buffer << " is not open for shared writes";
+		return false;
+	}
+	if (shmBuf->regions_committed.fetch_add(1) + 1 != expected)
+	{
+		return false;
+	}
+
+	// Last region: the committer marks the buffer Full on behalf of the manager which opened the shared write
+	TLOG(TLVL_WRITE) << "CommitRegion: All " << expected << " regions of buffer " << buffer << " committed, marking it Full";
+	std::lock_guard<std::mutex> lk(bufferMutex_(buffer));
+	shmBuf->last_touch_time = TimeUtils::gettime_monotonic_coarse_us();
+	markFull_(buffer, shmBuf, shmBuf->shared_write_destination);
+	return true;
+}
+
+bool artdaq::SharedMemoryManager::Read(int buffer, void* data, size_t size)
+{
+	if (buffer >= bufferCount_())
+	{
+		Detach(true, "ArgumentOutOfRange", "The specified buffer does not exist!");
+	}
+	std::lock_guard<std::mutex> lk(bufferMutex_(buffer));
+	// TraceLock lk(buffer_mutexes_[buffer], 27, "ReadBuffer" + std::to_string(buffer));
+	auto shmBuf = getBufferInfo_(buffer);
+	if (shmBuf == nullptr)
+	{
+		return false;
+	}
+	checkBuffer_(shmBuf, BufferSemaphoreFlags::Reading);
+	keepAlive_(shmBuf);
+	auto& readPos = readPos_(buffer, shmBuf);
+	auto chained = shmBuf->chain_next != -1;
+	if (chained ? readPos + size > chainDataSize_(shmBuf) : readPos + size > shm_ptr_->buffer_size)
+	{
+		TLOG(TLVL_ERROR) << "Attempted to read more data than fits into Shared Memory, bufferSize=" << shm_ptr_->buffer_size
+		                 << ",readPos=" << readPos << ",readSize=" << size << ",chained=" << chained;
+		Detach(true, "SharedMemoryRead", "Attempted to read more data than exists in Shared Memory!");
+	}
+
+	TLOG(TLVL_READ) << "Before memcpy in Read(), size is " << size;
+	if (chained)
+	{
+		// Gather the data from each buffer of the chain in turn
+		auto dest = static_cast<uint8_t*>(data);
+		size_t offset = readPos;
+		auto slot = chainSlot_(buffer, offset);
+		size_t copied = 0;
+		while (copied < size)
+		{
+			auto slotBuf = getBufferInfo_(slot);
+			auto count = std::min(size - copied, slotBuf->writePos - offset);
+			memcpy(dest + copied, bufferStart_(slot) + offset, count);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+			copied += count;
+			slot = slotBuf->chain_next;
+			offset = 0;
+		}
+	}
+	else
+	{
+		auto pos = GetReadPos(buffer);
+		memcpy(data, pos, size);
+	}
+	TLOG(TLVL_READ) << "After memcpy in Read()";
+	auto sts = checkBuffer_(shmBuf, BufferSemaphoreFlags::Reading, false);
+	if (sts)
+	{
+		readPos += size;
+		return true;
+	}
+	return false;
 }
 
 std::string artdaq::SharedMemoryManager::toString()
@@ -1186,14 +2153,18 @@ std::string artdaq::SharedMemoryManager::toString()
 	     << "Reader Position: " << shm_ptr_->reader_pos << std::endl
 	     << "Writer Position: " << shm_ptr_->writer_pos << std::endl
 	     << "Next ID Number: " << shm_ptr_->next_id << std::endl
-	     << "Buffer Count: " << shm_ptr_->buffer_count << std::endl
+	     << "Buffer Count: " << bufferCount_() << " (" << shm_ptr_->extension_count << " extension segments)" << std::endl
 	     << "Buffer Size: " << std::to_string(shm_ptr_->buffer_size) << " bytes" << std::endl
 	     << "Buffers Written: " << std::to_string(shm_ptr_->next_sequence_id) << std::endl
 	     << "Rank of Writer: " << shm_ptr_->rank << std::endl
 	     << "Ready Magic Bytes: 0x" << std::hex << shm_ptr_->ready_magic << std::dec << std::endl
+	     << "Layout Signature: 0x" << std::hex << shm_ptr_->layout_signature << std::dec << std::endl
+	     << "Consumer Groups: 0x" << std::hex << shm_ptr_->consumer_groups << std::dec << std::endl
+	     << "Unowned Empty/Full Buffers: " << shm_ptr_->free_count << "/" << shm_ptr_->ready_count << ", Writing: " << shm_ptr_->writing_count
+	     << ", Targeted Full: " << shm_ptr_->targeted_full_count << std::endl
 	     << std::endl;
 
-	for (auto ii = 0; ii < shm_ptr_->buffer_count; ++ii)
+	for (auto ii = 0; ii < bufferCount_(); ++ii)
 	{
 		auto buf = getBufferInfo_(ii);
 		if (buf == nullptr)
@@ -1207,6 +2178,8 @@ std::string artdaq::SharedMemoryManager::toString()
 		     << "readPos: " << std::to_string(buf->readPos) << std::endl
 		     << "sem: " << FlagToString(buf->sem) << std::endl
 		     << "Owner: " << std::to_string(buf->sem_id.load()) << std::endl
+		     << "Pending Consumer Groups: 0x" << std::hex << buf->pending_groups << std::dec << std::endl
+		     << "Locality: " << buf->locality << std::endl
 		     << "Last Touch Time: " << std::to_string(buf->last_touch_time / 1000000.0) << std::endl
 		     << std::endl;
 	}
@@ -1221,8 +2194,16 @@ void* artdaq::SharedMemoryManager::GetReadPos(int buffer)
 	{
 		return nullptr;
 	}
-	return bufferStart_(buffer) + buf->readPos;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	size_t offset = readPos_(buffer, buf);
+	auto slot = chainSlot_(buffer, offset);
+	return bufferStart_(slot) + offset;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+}
+size_t artdaq::SharedMemoryManager::GetReadOffset(int buffer)
+{
+	auto buf = getBufferInfo_(buffer);
+	return buf != nullptr ? readPos_(buffer, buf) : 0;
 }
+
 void* artdaq::SharedMemoryManager::GetWritePos(int buffer)
 {
 	auto buf = getBufferInfo_(buffer);
@@ -1259,6 +2240,19 @@ bool artdaq::SharedMemoryManager::checkBuffer_(ShmBuffer* buffer, BufferSemaphor
 		}
 		return false;
 	}
+	if (isConsumerGroup_() && flags == BufferSemaphoreFlags::Reading)
+	{
+		bool ret = claimedByGroup_(buffer) && (buffer->pending_groups & groupBit_()) != 0;
+		if (!ret)
+		{
+			if (exceptions)
+			{
+				Detach(true, "OwnerAccessViolation", "Shared Memory buffer is not claimed by this manager's consumer group (" + std::to_string(consumer_group_) + ")!");
+			}
+			TLOG(TLVL_WARNING) << "CheckBuffer detected issue with buffer " << buffer->sequence_id << "! It is not claimed by consumer group " << consumer_group_;
+		}
+		return ret;
+	}
 	TLOG(TLVL_CHKBUFFER) << "checkBuffer_: Checking that buffer " << buffer->sequence_id << " has sem_id " << manager_id_ << " (Current: " << buffer->sem_id << ") and is in state " << FlagToString(flags) << " (current: " << FlagToString(buffer->sem) << ")";
 	if (exceptions)
 	{
@@ -1290,7 +2284,571 @@ void artdaq::SharedMemoryManager::touchBuffer_(ShmBuffer* buffer)
 		return;
 	}
 	TLOG(TLVL_CHKBUFFER + 1) << "touchBuffer_: Touching buffer at " << static_cast<void*>(buffer) << " with sequence_id " << buffer->sequence_id;
-	buffer->last_touch_time = TimeUtils::gettimeofday_us();
+	buffer->last_touch_time = TimeUtils::gettime_monotonic_coarse_us();
+}
+
+void artdaq::SharedMemoryManager::notifyFull_()
+{
+	// Called without locks from the signal handler (through Detach), so only atomics and the futex system call are used
+	shm_ptr_->full_generation.fetch_add(1);
+#ifdef __linux__
+	if (shm_ptr_->full_waiters.load() > 0)
+	{
+		syscall(SYS_futex, reinterpret_cast<uint32_t*>(&shm_ptr_->full_generation), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-type-vararg)
+	}
+#endif
+}
+
+void artdaq::SharedMemoryManager::abandonClaim_(ShmBuffer* buffer, int16_t previous_id)
+{
+	// The buffer changed state since it was examined (e.g. another manager read or wrote it in the meantime),
+	// so the owner ID just set must be given back, or the buffer would be stuck with it
+	int16_t mine = manager_id_;
+	buffer->sem_id.compare_exchange_strong(mine, previous_id);
+}
+
+bool artdaq::SharedMemoryManager::claim_(ShmBuffer* buffer, BufferSemaphoreFlags sem, int16_t sem_id, BufferSemaphoreFlags target)
+{
+	// Tracked first, so that a Detach from the signal handler in the middle of the claim still finds the buffer
+	auto tracked = trackOwner_(manager_id_, buffer, true);
+	auto claimed = buffer->sem_id.compare_exchange_strong(sem_id, manager_id_);
+	if (claimed && !buffer->sem.compare_exchange_strong(sem, target))
+	{
+		abandonClaim_(buffer, sem_id);
+		claimed = false;
+	}
+	if (!claimed)
+	{
+		if (buffer->sem_id != manager_id_)
+		{
+			trackOwner_(manager_id_, buffer, false);
+		}
+		return false;
+	}
+	if (!tracked)
+	{
+		// GetBuffersOwnedByManager may have rebuilt the list since, without seeing this buffer as ours yet
+		trackOwner_(manager_id_, buffer, true);
+	}
+	untarget_(buffer);
+	if (sem_id >= 0 && sem_id != manager_id_)
+	{
+		trackOwner_(sem_id, buffer, false);
+	}
+	// Only counted once both exchanges succeeded, when the state the buffer left is known for certain
+	if (sem_id == -1)
+	{
+		countUnowned_(sem, -1);
+	}
+	if (target == BufferSemaphoreFlags::Writing)
+	{
+		++shm_ptr_->writing_count;
+	}
+	return true;
+}
+
+void artdaq::SharedMemoryManager::revertClaim_(ShmBuffer* buffer, BufferSemaphoreFlags sem, int16_t sem_id)
+{
+	// Undoes a successful claim_, restoring the state and owner the buffer had before it
+	setSem_(buffer, sem);
+	if (sem_id == -1)
+	{
+		countUnowned_(sem, 1);
+	}
+	int16_t mine = manager_id_;
+	buffer->sem_id.compare_exchange_strong(mine, sem_id);
+	trackOwner_(manager_id_, buffer, false);
+	trackOwner_(sem_id, buffer, true);
+	if (sem == BufferSemaphoreFlags::Full && sem_id >= 0 && !buffer->targeted.exchange(true))
+	{
+		++shm_ptr_->targeted_full_count;
+	}
+}
+
+void artdaq::SharedMemoryManager::untarget_(ShmBuffer* buffer)
+{
+	if (buffer->targeted.exchange(false))
+	{
+		--shm_ptr_->targeted_full_count;
+	}
+}
+
+void artdaq::SharedMemoryManager::setSem_(ShmBuffer* buffer, BufferSemaphoreFlags sem)
+{
+	auto previous = buffer->sem.exchange(sem);
+	if (previous == BufferSemaphoreFlags::Writing && sem != BufferSemaphoreFlags::Writing)
+	{
+		--shm_ptr_->writing_count;
+	}
+	else if (previous != BufferSemaphoreFlags::Writing && sem == BufferSemaphoreFlags::Writing)
+	{
+		++shm_ptr_->writing_count;
+	}
+}
+
+void artdaq::SharedMemoryManager::disown_(ShmBuffer* buffer)
+{
+	// Counted before the buffer can be claimed again. A manager killed in between leaves its ID on the buffer,
+	// and releasing it from a dead manager triggers a recount.
+	auto sem = buffer->sem.load();
+	countUnowned_(sem, 1);
+	auto previous = buffer->sem_id.exchange(-1);
+	if (previous == -1)
+	{
+		countUnowned_(sem, -1);
+	}
+	untarget_(buffer);
+	trackOwner_(previous, buffer, false);
+}
+
+void artdaq::SharedMemoryManager::indexSequence_(int buffer, ShmBuffer* shmBuf)
+{
+	// Entries of recycled buffers are not removed; lookups check the sequence ID of the buffer they find
+	auto sequence_id = shmBuf->sequence_id.load();
+	auto previous = shm_ptr_->sequence_index[sequence_id % SEQUENCE_INDEX_SIZE].exchange(buffer);
+	if (previous < 0 || previous == buffer || previous >= bufferCount_())
+	{
+		return;
+	}
+	auto old = getBufferInfo_(previous);
+	auto old_id = old != nullptr ? old->sequence_id.load() : sequence_id;
+	if (old_id != sequence_id && old_id % SEQUENCE_INDEX_SIZE == sequence_id % SEQUENCE_INDEX_SIZE && holdsEvent_(old, old_id))
+	{
+		if (shm_ptr_->sequence_index_evictions++ == shm_ptr_->sequence_index_checked)
+		{
+			TLOG(TLVL_WARNING) << "Sequence ID " << old_id << " in buffer " << previous << " lost its index entry to sequence ID " << sequence_id
+			                   << ", FindBuffer will scan for events missing from the index";
+		}
+	}
+}
+
+bool artdaq::SharedMemoryManager::holdsEvent_(ShmBuffer* buffer, size_t sequence_id) const
+{
+	if (buffer == nullptr || buffer->sequence_id != sequence_id || buffer->sem_id == CHAINED_CONTINUATION)
+	{
+		return false;
+	}
+	auto sem = buffer->sem.load();
+	return sem == BufferSemaphoreFlags::Full || sem == BufferSemaphoreFlags::Reading;
+}
+
+bool artdaq::SharedMemoryManager::trackOwner_(int manager_id, ShmBuffer* buffer, bool owned)
+{
+	if (manager_id < 0)
+	{
+		return true;
+	}
+	auto& slot = shm_ptr_->managers[manager_id % MANAGER_SLOTS];
+	if (slot.manager_id != manager_id)
+	{
+		// The slot belongs to a newer manager; the buffers of this one can only be found by scanning
+		return true;
+	}
+	auto index = bufferIndex_(buffer);
+	if (owned)
+	{
+		for (auto& entry : slot.owned)
+		{
+			if (entry == index)
+			{
+				return true;
+			}
+		}
+		for (auto& entry : slot.owned)
+		{
+			int32_t unused = -1;
+			if (entry.compare_exchange_strong(unused, index))
+			{
+				return true;
+			}
+		}
+		TLOG(TLVL_BUFFER) << "Manager " << manager_id << " owns more than " << OWNED_BUFFER_SLOTS << " buffers, its buffers will be found by scanning";
+		slot.owned_overflow = true;
+		return false;
+	}
+
+	for (auto& entry : slot.owned)
+	{
+		int32_t tracked = index;
+		entry.compare_exchange_strong(tracked, -1);
+	}
+	return true;
+}
+
+int artdaq::SharedMemoryManager::bufferIndex_(ShmBuffer* buffer)
+{
+	for (auto ii = segment_count_.load(std::memory_order_acquire) - 1; ii >= 0; --ii)
+	{
+		auto& segment = segments_[ii];
+		if (buffer >= segment.buffers && buffer < segment.buffers + segment.buffer_count)  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		{
+			return segment.first_buffer + static_cast<int>(buffer - segment.buffers);
+		}
+	}
+	return -1;
+}
+
+void artdaq::SharedMemoryManager::countUnowned_(BufferSemaphoreFlags sem, int delta)
+{
+	if (sem == BufferSemaphoreFlags::Empty)
+	{
+		shm_ptr_->free_count += delta;
+	}
+	else if (sem == BufferSemaphoreFlags::Full)
+	{
+		shm_ptr_->ready_count += delta;
+	}
+}
+
+bool artdaq::SharedMemoryManager::readCountsApply_() const
+{
+	// Otherwise, what is readable depends on the reader (sequence IDs seen, consumer group, or destination)
+	return shm_ptr_->destructive_read_mode && !isConsumerGroup_() && shm_ptr_->targeted_full_count <= 0;
+}
+
+void artdaq::SharedMemoryManager::sweepStale_()
+{
+	// The counters do not look at the buffers, so stale buffers are reset here instead of on every query
+	auto now = TimeUtils::gettime_monotonic_coarse_us();
+	auto last = last_sweep_us_.load();
+	if (shm_ptr_->buffer_timeout_us > 0 && now - last >= shm_ptr_->buffer_timeout_us / 4 && last_sweep_us_.compare_exchange_strong(last, now))
+	{
+		std::lock_guard<std::mutex> lk(search_mutex_);
+		for (auto ii = 0; ii < bufferCount_(); ++ii)
+		{
+			ResetBuffer(ii);
+		}
+	}
+	if (recount_needed_.exchange(false))
+	{
+		recount_();
+	}
+}
+
+void artdaq::SharedMemoryManager::recount_()
+{
+	std::lock_guard<std::mutex> lk(search_mutex_);
+	int free = 0;
+	int ready = 0;
+	int writing = 0;
+	for (auto ii = 0; ii < bufferCount_(); ++ii)
+	{
+		auto buf = getBufferInfo_(ii);
+		if (buf == nullptr)
+		{
+			continue;
+		}
+		auto sem = buf->sem.load();
+		auto unowned = buf->sem_id == -1;
+		free += sem == BufferSemaphoreFlags::Empty && unowned ? 1 : 0;
+		ready += sem == BufferSemaphoreFlags::Full && unowned ? 1 : 0;
+		writing += sem == BufferSemaphoreFlags::Writing ? 1 : 0;
+	}
+	TLOG(TLVL_RESET) << "Recounted buffers: Empty " << shm_ptr_->free_count << "->" << free << ", Full " << shm_ptr_->ready_count << "->" << ready
+	                 << ", Writing " << shm_ptr_->writing_count << "->" << writing;
+	shm_ptr_->free_count = free;
+	shm_ptr_->ready_count = ready;
+	shm_ptr_->writing_count = writing;
+}
+
+int artdaq::SharedMemoryManager::claimContinuation_(ShmBuffer* head)
+{
+	std::lock_guard<std::mutex> lk(search_mutex_);
+	auto wp = shm_ptr_->writer_pos.load();
+	for (auto ii = 0; ii < bufferCount_(); ++ii)
+	{
+		auto buffer = (ii + wp) % bufferCount_();
+		auto buf = getBufferInfo_(buffer);
+		if (buf == nullptr)
+		{
+			continue;
+		}
+
+		auto sem = buf->sem.load();
+		auto sem_id = buf->sem_id.load();
+		if (sem != BufferSemaphoreFlags::Empty || sem_id != -1)
+		{
+			continue;
+		}
+		if (!claim_(buf, sem, sem_id, BufferSemaphoreFlags::Writing))
+		{
+			continue;
+		}
+		buf->generation |= 1;
+		shm_ptr_->writer_pos = (buffer + 1) % bufferCount_();
+		buf->sequence_id = head->sequence_id.load();
+		buf->writePos = 0;
+		buf->regions_expected = 0;
+		buf->chain_next = -1;
+		buf->pending_groups = 0;
+		touchBuffer_(buf);
+		return buffer;
+	}
+	return -1;
+}
+
+void artdaq::SharedMemoryManager::writeChained_(int buffer, uint8_t const* data, size_t size)
+{
+	auto head = getBufferInfo_(buffer);
+	auto tail = buffer;
+	size_t length = 1;
+	for (auto next = head->chain_next.load(); next != -1; next = getBufferInfo_(next)->chain_next)
+	{
+		tail = next;
+		++length;
+	}
+
+	size_t written = 0;
+	while (written < size)
+	{
+		auto tailBuf = getBufferInfo_(tail);
+		auto space = shm_ptr_->buffer_size - tailBuf->writePos;
+		if (space > 0)
+		{
+			auto count = std::min(space, size - written);
+			memcpy(bufferStart_(tail) + tailBuf->writePos, data + written, count);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+			tailBuf->writePos = tailBuf->writePos + count;
+			written += count;
+			continue;
+		}
+
+		if (length >= max_chain_length_)
+		{
+			TLOG(TLVL_ERROR) << "Attempted to write more data than fits into " << max_chain_length_ << " chained Shared Memory buffers, bufferSize="
+			                 << shm_ptr_->buffer_size << ", remaining writeSize=" << size - written;
+			Detach(true, "SharedMemoryWrite", "Attempted to write more data than fits into the maximum chain of Shared Memory buffers! \nRe-run with a larger buffer size or maximum chain length!");
+		}
+
+		// Wait for an Empty buffer, for at most one buffer timeout. The head is kept alive meanwhile.
+		auto timeout_us = shm_ptr_->buffer_timeout_us > 0 ? shm_ptr_->buffer_timeout_us : 1000000;
+		auto start = std::chrono::steady_clock::now();
+		auto waiter = wait_policy_.MakeWaiter();
+		auto next = claimContinuation_(head);
+		while (next == -1)
+		{
+			if (TimeUtils::GetElapsedTimeMicroseconds(start) > timeout_us)
+			{
+				TLOG(TLVL_ERROR) << "No Empty buffer became available within " << timeout_us << " us to continue the chained event in buffer " << buffer;
+				Detach(true, "SharedMemoryWrite", "No Empty buffer became available to continue a chained event!");
+			}
+			keepAlive_(head);
+			waiter.Wait();
+			next = claimContinuation_(head);
+		}
+		TLOG(TLVL_WRITE) << "Chaining buffer " << next << " after buffer " << tail << " for the event in buffer " << buffer;
+		tailBuf->chain_next = next;
+		tail = next;
+		++length;
+	}
+	keepAlive_(head);
+}
+
+int artdaq::SharedMemoryManager::chainSlot_(int buffer, size_t& offset)
+{
+	auto buf = getBufferInfo_(buffer);
+	while (buf != nullptr && offset >= buf->writePos && buf->chain_next != -1)
+	{
+		offset -= buf->writePos;
+		buffer = buf->chain_next;
+		buf = getBufferInfo_(buffer);
+	}
+	return buffer;
+}
+
+size_t artdaq::SharedMemoryManager::chainDataSize_(ShmBuffer* head)
+{
+	size_t size = head->writePos;
+	for (auto next = head->chain_next.load(); next != -1;)
+	{
+		auto buf = getBufferInfo_(next);
+		if (buf == nullptr)
+		{
+			break;
+		}
+		size += buf->writePos;
+		next = buf->chain_next;
+	}
+	return size;
+}
+
+void artdaq::SharedMemoryManager::commitChain_(ShmBuffer* head)
+{
+	// The continuations are claimed for the chain before they become Full, so that no reader can take them
+	for (auto next = head->chain_next.load(); next != -1;)
+	{
+		auto buf = getBufferInfo_(next);
+		if (buf == nullptr)
+		{
+			break;
+		}
+		trackOwner_(buf->sem_id.exchange(CHAINED_CONTINUATION), buf, false);
+		// Peekers compare the generation of each buffer of the chain, so a continuation is published like a head
+		buf->generation.store((buf->generation.load() | 1) + 1);
+		setSem_(buf, BufferSemaphoreFlags::Full);
+		next = buf->chain_next;
+	}
+}
+
+void artdaq::SharedMemoryManager::releaseChain_(ShmBuffer* head)
+{
+	auto next = head->chain_next.exchange(-1);
+	while (next != -1)
+	{
+		auto buf = getBufferInfo_(next);
+		// Stop at a link which no longer belongs to this event, e.g. after a reset of its writer
+		if (buf == nullptr || buf->sem_id != CHAINED_CONTINUATION || buf->sequence_id != head->sequence_id)
+		{
+			break;
+		}
+		TLOG(TLVL_POS + 3) << "Releasing chained buffer " << next << " (seqid=" << buf->sequence_id << ")";
+		next = buf->chain_next.exchange(-1);
+		buf->readPos = 0;
+		buf->writePos = 0;
+		setSem_(buf, BufferSemaphoreFlags::Empty);
+		disown_(buf);
+	}
+}
+
+void artdaq::SharedMemoryManager::registerManager_()
+{
+	auto& slot = shm_ptr_->managers[manager_id_ % MANAGER_SLOTS];
+	slot.manager_id = -1;
+	slot.pid = getpid();
+	slot.pid_namespace = pidNamespace();
+	for (auto& owned : slot.owned)
+	{
+		owned = -1;
+	}
+	slot.owned_overflow = false;
+	slot.manager_id = manager_id_;
+}
+
+bool artdaq::SharedMemoryManager::managerIsGone_(int manager_id) const
+{
+	// If the slot has been taken over by a newer manager (checked again after reading the pid, in case that happened
+	// meanwhile), the process of this one is unknown
+	auto& slot = shm_ptr_->managers[manager_id % MANAGER_SLOTS];
+	if (slot.manager_id != manager_id)
+	{
+		return false;
+	}
+	auto pid = slot.pid.load();
+	auto pid_namespace = slot.pid_namespace.load();
+	if (slot.manager_id != manager_id)
+	{
+		return false;
+	}
+	// A manager in another PID namespace (e.g. a container sharing the IPC namespace) cannot be looked up by its pid
+	if (pid_namespace == 0 || pid_namespace != pidNamespace())
+	{
+		return false;
+	}
+	return processIsGone(pid);
+}
+
+uint64_t artdaq::SharedMemoryManager::layoutSignature_()
+{
+	return (static_cast<uint64_t>(sizeof(ShmStruct)) << 32) | (sizeof(ShmBuffer) << 16) | MANAGER_SLOTS;
+}
+
+bool artdaq::SharedMemoryManager::layoutMatches_() const
+{
+	if (shm_ptr_->layout_signature != layoutSignature_() || shm_ptr_->buffer_count != requested_shm_parameters_.buffer_count ||
+	    shm_ptr_->buffer_size != requested_shm_parameters_.buffer_size || shm_ptr_->destructive_read_mode != requested_shm_parameters_.destructive_read_mode)
+	{
+		TLOG(TLVL_WARNING) << "Existing Shared Memory with key 0x" << std::hex << shm_key_ << std::dec << " has a different layout ("
+		                   << shm_ptr_->buffer_count << " buffers of " << shm_ptr_->buffer_size << " bytes, signature 0x" << std::hex << shm_ptr_->layout_signature
+		                   << std::dec << ") than requested, it cannot be warm-restarted";
+		return false;
+	}
+	return true;
+}
+
+bool artdaq::SharedMemoryManager::warmAttach_()
+{
+	TLOG(TLVL_ATTACH) << "Owner warm-restarting existing Shared Memory";
+	shm_ptr_->buffer_timeout_us = requested_shm_parameters_.buffer_timeout_us;
+	addSegment_(shm_segment_id_, reinterpret_cast<uint8_t*>(shm_ptr_), sizeof(ShmStruct), shm_ptr_->buffer_count);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	if (!refreshSegments_())
+	{
+		TLOG(TLVL_ERROR) << "Failed to attach to the extension segments of shared memory with key 0x" << std::hex << shm_key_;
+		return false;
+	}
+
+	// The previous owner also had ID 0, so it is checked before this manager registers
+	size_t full = 0;
+	size_t reset = 0;
+	for (auto ii = 0; ii < bufferCount_(); ++ii)
+	{
+		auto buf = getBufferInfo_(ii);
+		auto sem_id = buf->sem_id.load();
+		if (sem_id == 0 || (sem_id > 0 && managerIsGone_(sem_id)))
+		{
+			if (buf->sem == BufferSemaphoreFlags::Writing)
+			{
+				buf->writePos = 0;
+				buf->regions_expected = 0;
+				setSem_(buf, BufferSemaphoreFlags::Empty);
+				++reset;
+			}
+			else if (buf->sem == BufferSemaphoreFlags::Reading)
+			{
+				buf->readPos = 0;
+				setSem_(buf, BufferSemaphoreFlags::Full);
+			}
+			disown_(buf);
+			recount_needed_ = true;
+		}
+		if (buf->sem == BufferSemaphoreFlags::Full)
+		{
+			// Kept buffers get a full timeout, rather than being expired right away in broadcast mode
+			touchBuffer_(buf);
+			++full;
+		}
+	}
+	registerManager_();
+	warm_restarted_ = true;
+	if (full > 0)
+	{
+		notifyFull_();
+	}
+	TLOG(TLVL_INFO) << "Warm restart of Shared Memory with key 0x" << std::hex << shm_key_ << std::dec << ": kept " << full
+	                << " Full buffers (up to sequence ID " << shm_ptr_->next_sequence_id << "), reset " << reset << " Writing buffers";
+	return true;
+}
+
+void artdaq::SharedMemoryManager::recordConsumed_()
+{
+	auto count = shm_ptr_->consumed_count.fetch_add(1) + 1;
+	auto now = TimeUtils::gettime_monotonic_coarse_us();
+	auto last = shm_ptr_->consumed_sample_time_us.load();
+	if (now < last + CONSUMPTION_RATE_INTERVAL_US || !shm_ptr_->consumed_sample_time_us.compare_exchange_strong(last, now))
+	{
+		return;
+	}
+
+	// Only the reader which moved the sample time forward updates the rate
+	auto consumed = count - shm_ptr_->consumed_sample_count.exchange(count);
+	auto rate_mhz = consumed * 1000000000 / (now - last);
+	auto previous = shm_ptr_->consume_rate_mhz.load();
+	shm_ptr_->consume_rate_mhz = previous == 0 ? rate_mhz : (previous + rate_mhz) / 2;
+	TLOG(TLVL_POS + 3) << "Consumption rate updated: " << consumed << " buffers in " << (now - last) << " us, rate is now " << shm_ptr_->consume_rate_mhz / 1000.0 << " Hz";
+}
+
+void artdaq::SharedMemoryManager::keepAlive_(ShmBuffer* buffer)
+{
+	if ((buffer == nullptr) || (buffer->sem_id != -1 && buffer->sem_id != manager_id_ && !claimedByGroup_(buffer)))
+	{
+		return;
+	}
+	// Only refresh the touch time once a quarter of the timeout has elapsed, to avoid writing to
+	// the shared cache line on every access
+	auto now = TimeUtils::gettime_monotonic_coarse_us();
+	if (now - buffer->last_touch_time > shm_ptr_->buffer_timeout_us / 4)
+	{
+		TLOG(TLVL_CHKBUFFER + 1) << "keepAlive_: Touching buffer at " << static_cast<void*>(buffer) << " with sequence_id " << buffer->sequence_id;
+		buffer->last_touch_time = now;
+	}
 }
 
 void artdaq::SharedMemoryManager::Detach(bool throwException, const std::string& category, const std::string& message, bool force)
@@ -1299,7 +2857,16 @@ void artdaq::SharedMemoryManager::Detach(bool throwException, const std::string&
 	if (IsValid())
 	{
 		TLOG(TLVL_DETACH) << "Detach: Resetting owned buffers";
+		for (int ii = 0; ii < bufferCount_(); ++ii)
+		{
+			// Another reader in the consumer group may still read these buffers
+			if (groupOwned_(ii).exchange(false))
+			{
+				getBufferInfo_(ii)->group_claims.fetch_and(~groupBit_());
+			}
+		}
 		auto bufs = GetBuffersOwnedByManager(false);
+		auto returned = false;
 		for (auto buf : bufs)
 		{
 			auto shmBuf = getBufferInfo_(buf);
@@ -1309,13 +2876,34 @@ void artdaq::SharedMemoryManager::Detach(bool throwException, const std::string&
 			}
 			if (shmBuf->sem == BufferSemaphoreFlags::Writing)
 			{
-				shmBuf->sem = BufferSemaphoreFlags::Empty;
+				setSem_(shmBuf, BufferSemaphoreFlags::Empty);
 			}
 			else if (shmBuf->sem == BufferSemaphoreFlags::Reading)
 			{
-				shmBuf->sem = BufferSemaphoreFlags::Full;
+				setSem_(shmBuf, BufferSemaphoreFlags::Full);
+				returned = true;
+			}
+			disown_(shmBuf);
+		}
+		if (returned)
+		{
+			notifyFull_();
+		}
+	}
+
+	{
+		// segment_mutex_ is not taken here, since Detach may be called from the signal handler. The segment
+		// descriptors (and their buffer mutexes, which the caller may be holding) stay alive until the next Attach.
+		auto segments = segment_count_.exchange(0);
+		attached_buffer_count_ = 0;
+		for (auto ii = 1; ii < segments; ++ii)
+		{
+			TLOG(TLVL_DETACH) << "Detach: Detaching extension segment " << ii - 1;
+			shmdt(segments_[ii].base);
+			if (force || (manager_id_ == 0 && !warm_restart_))
+			{
+				shmctl(segments_[ii].segment_id, IPC_RMID, nullptr);
 			}
-			shmBuf->sem_id = -1;
 		}
 	}
 
@@ -1326,7 +2914,7 @@ void artdaq::SharedMemoryManager::Detach(bool throwException, const std::string&
 		shm_ptr_ = nullptr;
 	}
 
-	if ((force || manager_id_ == 0) && shm_segment_id_ > -1)
+	if ((force || (manager_id_ == 0 && !warm_restart_)) && shm_segment_id_ > -1)
 	{
 		TLOG(TLVL_DETACH) << "Detach: Marking Shared memory for removal";
 		shmctl(shm_segment_id_, IPC_RMID, nullptr);
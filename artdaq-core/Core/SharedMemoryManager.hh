@@ -1,12 +1,17 @@
 #ifndef artdaq_core_Core_SharedMemoryManager_hh
 #define artdaq_core_Core_SharedMemoryManager_hh 1
 
+#include <array>
 #include <atomic>
 #include <deque>
 #include <list>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <utility>
 #include <vector>
+
+#include "artdaq-core/Core/WaitPolicy.hh"
 #include "artdaq-core/Utilities/TimeUtils.hh"
 
 namespace artdaq {
@@ -28,6 +33,8 @@ public:
 		Reading   ///< The buffer is currently being read from
 	};
 
+	static constexpr size_t SEQUENCE_INDEX_SIZE = 4096;  ///< Number of entries in the sequence ID index (see FindBuffer)
+
 	/**
 	 * \brief Convert a BufferSemaphoreFlags variable to its string represenatation
 	 * \param flag BufferSemaphoreFlags variable to convert
@@ -57,8 +64,10 @@ public:
 	 * \param buffer_timeout_us The maximum amount of time a buffer can be left untouched by its owner (if 0, buffers do not expire)
 	 * before being returned to its previous state.
 	 * \param destructive_read_mode Whether a read operation empties the buffer (default: true, false for broadcast mode)
+	 * \param warm_restart Whether the owner keeps the contents of an existing segment with the same layout instead of
+	 * re-initializing it (see Attach). The segment is then also kept when the owner detaches, unless the detach is forced.
 	 */
-	SharedMemoryManager(uint32_t shm_key, size_t buffer_count = 0, size_t buffer_size = 0, uint64_t buffer_timeout_us = 100 * 1000000, bool destructive_read_mode = true);
+	SharedMemoryManager(uint32_t shm_key, size_t buffer_count = 0, size_t buffer_size = 0, uint64_t buffer_timeout_us = 100 * 1000000, bool destructive_read_mode = true, bool warm_restart = false);
 
 	/**
 	 * \brief SharedMemoryManager Destructor
@@ -67,15 +76,57 @@ public:
 
 	/**
 	 * \brief Reconnect to the shared memory segment
+	 *
+	 * An owner created with warm_restart finding an initialized segment with the same layout (e.g. left behind by a
+	 * previous owner which crashed or was restarted) keeps its Full buffers and sequence IDs, so that no event is lost
+	 * and readers can continue right away. Only the buffers held by the previous owner or by managers whose process has
+	 * exited are reset (Writing-->Empty, Reading-->Full). Otherwise, every buffer is re-initialized to Empty.
 	 */
 	bool Attach(size_t timeout_usec = 0);
 
+	/**
+	 * \brief Whether the last Attach by the owner kept the contents of an existing segment (see Attach)
+	 * \return True if the owner warm-restarted
+	 */
+	bool WasWarmRestarted() const { return warm_restarted_; }
+
+	/**
+	 * \brief Add buffers to the shared memory by creating an extension segment (owner only)
+	 * \param count Number of buffers to add. Each has the same size as the existing buffers.
+	 * \return Whether the buffers were added
+	 *
+	 * Attached managers map the new buffers the next time they search for a buffer, so no
+	 * detach is necessary and buffers already in use are unaffected.
+	 */
+	bool AddBuffers(size_t count);
+
 	/**
 	 * \brief Finds a buffer that is ready to be read, and reserves it for the calling manager.
 	 * \return The id number of the buffer. -1 indicates no buffers available for read.
 	 */
 	int GetBufferForReading();
 
+	/**
+	 * \brief Reserves the buffer holding the event with the given sequence ID for reading
+	 * \param sequence_id Sequence ID of the event (see GetSequenceID)
+	 * \return The id number of the buffer. -1 if the event is not Full (not written yet, being read, or already consumed).
+	 *
+	 * The buffer is found with FindBuffer. Which buffers GetBufferForReading() returns next is unaffected.
+	 * Not available to members of a consumer group.
+	 */
+	int GetBufferForReading(size_t sequence_id);
+
+	/**
+	 * \brief Find the buffer holding the event with the given sequence ID
+	 * \param sequence_id Sequence ID of the event
+	 * \return Buffer ID, or -1 if no Full or Reading buffer holds that event
+	 *
+	 * Looked up in an index in the shared memory header, which is updated whenever a buffer is marked Full.
+	 * The buffers are only scanned once the index has lost track of an event still in the shared memory,
+	 * which takes more than SEQUENCE_INDEX_SIZE newer events passing it, and until a scan finds that all such events are gone.
+	 */
+	int FindBuffer(size_t sequence_id);
+
 	/**
 	 * \brief Finds a buffer that is ready to be written to, and reserves it for the calling manager.
 	 * \param overwrite Whether to consider buffers that are in the Full and Reading state as ready for write (non-reliable mode)
@@ -86,26 +137,88 @@ public:
 	/**
 	 * \brief Whether any buffer is ready for read
 	 * \return True if there is a buffer available
+	 *
+	 * Constant-time in most configurations, see ReadReadyCount.
 	 */
 	bool ReadyForRead();
 
+	/**
+	 * \brief Get the counter of buffers made available for reading in this shared memory
+	 * \return A value which changes whenever a buffer is marked Full (or returned to the Full state)
+	 *
+	 * Reading the counter does not lock or scan the buffers, so a reader which found nothing to read can skip
+	 * ReadyForRead until the counter changes.
+	 */
+	uint32_t GetFullGeneration() const { return IsValid() ? shm_ptr_->full_generation.load() : 0; }
+
+	/**
+	 * \brief Block until the value returned by GetFullGeneration differs from generation
+	 * \param generation Value previously returned by GetFullGeneration
+	 * \param timeout_us Maximum time to wait, in microseconds
+	 * \return Whether the counter has changed
+	 *
+	 * Writers only issue a wake-up system call when a reader is blocked here.
+	 */
+	bool WaitForFullGeneration(uint32_t generation, size_t timeout_us);
+
 	/**
 	 * \brief Whether any buffer is available for write
 	 * \param overwrite Whether to allow overwriting full buffers
 	 * \return True if there is a buffer available
+	 *
+	 * Constant-time, see WriteReadyCount.
 	 */
 	virtual bool ReadyForWrite(bool overwrite);
 
+	/**
+	 * \brief Get the number of buffers a writer can currently fill without waiting for the readers
+	 * \return Number of Empty buffers
+	 *
+	 * Counted without taking locks or resetting stale buffers, so it is cheap enough to check before every write.
+	 */
+	int GetWriteCredits();
+
+	/**
+	 * \brief Get the rate at which readers return buffers to Empty, as published by the readers in the shared memory
+	 * \return Smoothed consumption rate, in buffers per second (0 if nothing has been consumed yet)
+	 *
+	 * Only tracked in destructive read mode; in broadcast mode, buffers are freed by their timeout.
+	 */
+	double GetConsumptionRate() const;
+
+	/**
+	 * \brief Get a write rate which keeps the shared memory about half full at the readers' consumption rate
+	 * \return Suggested rate, in buffers per second. 0 if there are no write credits; infinity if credits are
+	 * available but no buffer has been consumed yet.
+	 *
+	 * The suggestion scales the consumption rate from twice its value with every buffer Empty down to 0 with none,
+	 * so that writers can throttle smoothly instead of alternating between full speed and GetBufferForWriting failures.
+	 */
+	double GetSuggestedWriteRate();
+
 	/**
 	 * \brief Count the number of buffers that are ready for reading
 	 * \return The number of buffers ready for reading
+	 *
+	 * In destructive read mode, this reads a counter kept in the shared memory instead of scanning the buffers.
+	 * Broadcast readers, consumer groups, and segments holding buffers marked Full for a specific destination
+	 * (see GetTargetedFullCount) still scan, since what is readable then depends on the reader.
 	 */
 	size_t ReadReadyCount();
 
+	/**
+	 * \brief Get the number of Full buffers which were marked Full for a specific destination and have not been read yet
+	 * \return Number of targeted Full buffers. While it is non-zero, ReadReadyCount and ReadyForRead scan the buffers.
+	 */
+	size_t GetTargetedFullCount() const;
+
 	/**
 	 * \brief Count the number of buffers that are ready for writing
 	 * \param overwrite Whether to consider buffers that are in the Full and Reading state as ready for write (non-reliable mode)
 	 * \return The number of buffers ready for writing
+	 *
+	 * Reads counters kept in the shared memory instead of scanning the buffers. Stale buffers are reset
+	 * by a scan at most every quarter of the buffer timeout.
 	 */
 	size_t WriteReadyCount(bool overwrite);
 
@@ -113,13 +226,134 @@ public:
 	 * \brief Get the list of all buffers currently owned by this manager instance.
 	 * \param locked Default = true, Whether to lock search_mutex_ before checking buffer ownership (skipped in Detach)
 	 * \return A std::deque<int> of buffer IDs currently owned by this manager instance.
+	 *
+	 * The buffers are looked up in the list each manager keeps in its slot of the shared memory header, which is
+	 * updated whenever a buffer changes owner. The buffers are only scanned if that list overflowed, or if the
+	 * slot was taken over by another manager.
 	 */
 	std::deque<int> GetBuffersOwnedByManager(bool locked = true);
 
 	/**
-	 * \brief Get the current size of the buffer's data
+	 * \brief Copy the most recently filled buffer without taking ownership of it
+	 * \param[out] data Receives a copy of the buffer's data (the whole chain, for chained events)
+	 * \param[out] sequence_id Sequence ID of the copied buffer
+	 * \return Whether a consistent copy was made. False if no buffer has been filled yet, or if writers kept re-using the buffer during the copy.
+	 *
+	 * The buffer state is never changed, so monitoring consumers can sample events without competing with readers.
+	 * A per-buffer generation counter (seqlock) detects a writer re-using the buffer while it is being copied.
+	 */
+	bool PeekLatest(std::vector<uint8_t>& data, size_t& sequence_id);
+
+	/**
+	 * \brief Find the most recently filled buffer, for zero-copy peeking with GetBufferStart and BufferDataSize
+	 * \param[out] generation Generation of the buffer, to be passed to PeekIsValid once the data has been used
+	 * \return Buffer ID of the most recently filled buffer, or -1 if none is available
+	 */
+	int GetLatestFullBuffer(uint32_t& generation);
+
+	/**
+	 * \brief Check that a buffer returned by GetLatestFullBuffer has not been re-used by a writer since
+	 * \param buffer Buffer ID returned by GetLatestFullBuffer
+	 * \param generation Generation returned by GetLatestFullBuffer
+	 * \return Whether any data read from the buffer since GetLatestFullBuffer is consistent
+	 */
+	bool PeekIsValid(int buffer, uint32_t generation);
+
+	static constexpr int MAX_CONSUMER_GROUPS = 8;  ///< Maximum number of consumer groups, including the regular readers (group 0)
+
+	/**
+	 * \brief Register a consumer group which is handed each Full buffer in addition to the regular readers (tee mode)
+	 * \param prescale The group receives buffers whose sequence ID is a multiple of prescale (0 or 1: every buffer)
+	 * \return ID of the new group, or -1 if the group could not be registered
+	 *
+	 * A buffer marked Full after the group is registered is referenced by the regular readers and by every group
+	 * selecting it. It returns to Empty only once all of them have released it, so no copy is made per group.
+	 * Within a group, each buffer is read once, as with the regular readers. Only available in destructive read mode.
+	 */
+	int AddConsumerGroup(size_t prescale = 1);
+
+	/**
+	 * \brief Unregister a consumer group, dropping its references to all buffers. Its readers must have stopped.
+	 * \param group ID of the group, from AddConsumerGroup
+	 */
+	void RemoveConsumerGroup(int group);
+
+	/**
+	 * \brief Read on behalf of a consumer group. Must be called while this manager holds no buffers for reading.
+	 * \param group ID of the group, from AddConsumerGroup, or 0 for the regular readers
+	 * \return Whether the group is registered
+	 */
+	bool SetConsumerGroup(int group);
+
+	/**
+	 * \brief Get the consumer group this manager reads on behalf of
+	 * \return Consumer group ID (0 for the regular readers)
+	 */
+	int GetConsumerGroup() const { return consumer_group_; }
+
+	/**
+	 * \brief Set the locality hint of this manager, e.g. the NUMA node its thread is pinned to
+	 * \param locality Locality hint (0 to 32767), or -1 (the default) to disable locality affinity
+	 *
+	 * Buffers marked Full by this manager are tagged with its locality. In destructive read mode, GetBufferForReading
+	 * prefers Full buffers tagged with the reader's locality (or untagged ones), and only takes buffers tagged with
+	 * another locality when none of those is available.
+	 */
+	void SetLocality(int locality) { locality_ = static_cast<int16_t>(locality); }
+
+	/**
+	 * \brief Get the locality hint of this manager
+	 * \return Locality hint, or -1 if locality affinity is disabled
+	 */
+	int GetLocality() const { return locality_; }
+
+	/**
+	 * \brief Get the number of buffers this manager has read from another locality because none of its own were Full
+	 * \return Number of buffers taken from another locality
+	 */
+	uint64_t GetStolenBufferCount() const { return stolen_buffer_count_; }
+
+	/**
+	 * \brief Get the NUMA node of the CPU the calling thread is currently running on, for use with SetLocality
+	 * \return NUMA node, or 0 if it cannot be determined
+	 */
+	static int CurrentNumaNode();
+
+	/**
+	 * \brief Allow this manager to write events larger than the buffer size across several chained buffers
+	 * \param length Maximum number of buffers one event may span (1, the default, disables chaining)
+	 *
+	 * When Write reaches the end of a buffer, it claims an Empty buffer and links it to the event. The continuation
+	 * buffers are published when the first (head) buffer is marked Full, which commits the whole event, and are
+	 * released together with it. They are never handed out by GetBufferForReading. Readers see the chain as one
+	 * logical buffer: BufferDataSize, Read and MoreDataInBuffer span the chain, and GetGatherView returns its pieces.
+	 */
+	void SetMaxChainLength(size_t length) { max_chain_length_ = length > 0 ? length : 1; }
+
+	/**
+	 * \brief Get the maximum number of buffers one event written by this manager may span
+	 * \return Maximum chain length (1: chaining disabled)
+	 */
+	size_t GetMaxChainLength() const { return max_chain_length_; }
+
+	/**
+	 * \brief Get the number of buffers holding the event that starts in the given buffer
+	 * \param buffer Buffer ID of the head buffer
+	 * \return Number of chained buffers, including the head (1 for an event which fits in one buffer)
+	 */
+	size_t GetChainLength(int buffer);
+
+	/**
+	 * \brief Get the pieces of the event that starts in the given buffer, for zero-copy reading of chained events
+	 * \param buffer Buffer ID of the head buffer
+	 * \return Start and size of the data in each buffer of the chain, in order
+	 */
+	std::vector<std::pair<uint8_t const*, size_t>> GetGatherView(int buffer);
+
+	/**
+	 * \brief Get the current size of the buffer's data (the whole chain, for chained events)
 	 * \param buffer Buffer ID of buffer
-	 * \return Current size of data in the buffer, in bytes
+	 * \return Current size of data in the buffer (or in its whole chain, see SetMaxChainLength), in bytes
 	 */
 	size_t BufferDataSize(int buffer);
 
@@ -129,6 +363,12 @@ public:
 	 */
 	size_t BufferSize() { return (shm_ptr_ != nullptr ? shm_ptr_->buffer_size : 0); }
 
+	/**
+	 * \brief Whether reading a buffer empties it (see the destructive_read_mode constructor parameter)
+	 * \return True in destructive read mode, false in broadcast mode
+	 */
+	bool IsDestructiveReadMode() const { return shm_ptr_ != nullptr && shm_ptr_->destructive_read_mode; }
+
 	/**
 	 * \brief Set the read position of the given buffer to the beginning of the buffer
 	 * \param buffer Buffer ID of buffer
@@ -188,6 +428,7 @@ public:
 	/**
 	 * \brief Resets the buffer from Reading to Full. This operation will only have an
 	 * effect if performed by the owning manager or if the buffer has timed out.
+	 * A timed-out buffer still owned by a manager whose process has exited (e.g. it was killed while writing) is released.
 	 * \param buffer Buffer ID of buffer
 	 * \return Whether the buffer has exceeded the maximum age
 	 */
@@ -198,7 +439,11 @@ public:
 	 */
 	void GetNewId()
 	{
-		if (manager_id_ < 0 && IsValid()) manager_id_ = shm_ptr_->next_id.fetch_add(1);
+		if (manager_id_ < 0 && IsValid())
+		{
+			manager_id_ = shm_ptr_->next_id.fetch_add(1);
+			registerManager_();
+		}
 	}
 
 	/**
@@ -248,10 +493,10 @@ public:
 	bool IsEndOfData() const;
 
 	/**
-	 * \brief Get the number of buffers in the shared memory segment
+	 * \brief Get the number of buffers in the shared memory segment (including any extension segments mapped by this manager)
 	 * \return The number of buffers in the shared memory segment
 	 */
-	size_t size() const { return IsValid() ? shm_ptr_->buffer_count : 0; }
+	size_t size() const { return IsValid() ? bufferCount_() : 0; }
 
 	/**
 	 * \brief Write size bytes of data from the given pointer to a buffer
@@ -262,6 +507,34 @@ public:
 	 */
 	size_t Write(int buffer, void* data, size_t size);
 
+	/**
+	 * \brief Open a buffer for concurrent appends by several writers (threads, or other processes attached to the shared memory)
+	 * \param buffer Buffer ID of a buffer this manager is writing (from GetBufferForWriting). Data already written, e.g. an event header, is kept.
+	 * \param expected_regions Number of CommitRegion calls after which the buffer is marked Full
+	 * \param destination Destination passed to MarkBufferFull once all regions are committed
+	 * \return Whether the buffer was opened
+	 *
+	 * The buffer ID has to be passed to the other writers by the caller.
+	 */
+	bool BeginSharedWrite(int buffer, uint32_t expected_regions, int destination = -1);
+
+	/**
+	 * \brief Reserve a region of a buffer opened with BeginSharedWrite, without taking any lock
+	 * \param buffer Buffer ID
+	 * \param size Size of the region, in bytes
+	 * \return Pointer to the region, which the caller fills and then commits with CommitRegion. nullptr if the region does not fit or the buffer is not open.
+	 *
+	 * CommitRegion must be called for every expected region, even when the reservation failed, so that the buffer is still marked Full.
+	 */
+	void* ReserveRegion(int buffer, size_t size);
+
+	/**
+	 * \brief Signal that a region reserved with ReserveRegion has been filled
+	 * \param buffer Buffer ID
+	 * \return Whether this was the last expected region, and the buffer was marked Full
+	 */
+	bool CommitRegion(int buffer);
+
 	/**
 	 * \brief Read size bytes of data from buffer into the given pointer
 	 * \param buffer Buffer ID of buffer
@@ -286,10 +559,17 @@ public:
 	/**
 	 * \brief Get a pointer to the current read position of the buffer
 	 * \param buffer Buffer ID of buffer
-	 * \return void* pointer to the buffer's current read position
+	 * \return void* pointer to the buffer's current read position. For a chained event, data is only contiguous up to the end of the chained buffer it points into (see GetGatherView).
 	 */
 	void* GetReadPos(int buffer);
 
+	/**
+	 * \brief Get the current read position of the buffer, as an offset from the start of its data
+	 * \param buffer Buffer ID of buffer
+	 * \return Number of bytes already read from the buffer (or from its whole chain, see SetMaxChainLength)
+	 */
+	size_t GetReadOffset(int buffer);
+
 	/**
 	 * \brief Get a pointer to the current write position of the buffer
 	 * \param buffer Buffer ID of buffer
@@ -309,7 +589,7 @@ public:
 	 * \param throwException Whether to throw an exception after detaching
 	 * \param category Category for the cet::exception
 	 * \param message Message for the cet::exception
-	 * \param force Whether to mark shared memory for destruction even if not owner (i.e. from signal handler)
+	 * \param force Whether to mark shared memory for destruction even if not owner (i.e. from signal handler), or if the owner uses warm_restart
 	 */
 	void Detach(bool throwException = false, const std::string& category = "", const std::string& message = "", bool force = false);
 
@@ -325,12 +605,35 @@ public:
 	 */
 	size_t GetBufferCount() const { return IsValid() ? shm_ptr_->next_sequence_id : 0; }
 
+	/**
+	 * \brief Gets the sequence ID of the event in a buffer
+	 * \param buffer Buffer ID of buffer
+	 * \return Sequence ID assigned when the buffer was last reserved for writing
+	 */
+	size_t GetSequenceID(int buffer)
+	{
+		auto buf = getBufferInfo_(buffer);
+		return buf != nullptr ? buf->sequence_id.load() : 0;
+	}
+
 	/**
 	 * \brief Gets the highest buffer number either written or read by this SharedMemoryManager
 	 * \return The highest buffer id written or read by this SharedMemoryManager
 	 */
 	size_t GetLastSeenBufferID() const { return last_seen_id_; }
 
+	/**
+	 * \brief Set the policy used by this manager (and its users) when waiting for the shared memory
+	 * \param policy WaitPolicy to use for subsequent waits
+	 */
+	void SetWaitPolicy(WaitPolicy const& policy) { wait_policy_ = policy; }
+
+	/**
+	 * \brief Get the policy used by this manager when waiting for the shared memory
+	 * \return The current WaitPolicy (WaitPolicy::Default() unless SetWaitPolicy has been called)
+	 */
+	WaitPolicy const& GetWaitPolicy() const { return wait_policy_; }
+
 	/**
 	 * \brief Gets the lowest sequence ID that has been read by any reader, as reported by the readers.
 	 */
@@ -361,12 +664,36 @@ private:
 
 	struct ShmBuffer
 	{
-		size_t writePos;
+		std::atomic<size_t> writePos;  ///< Advanced atomically by ReserveRegion during shared writes
 		size_t readPos;
 		std::atomic<BufferSemaphoreFlags> sem;
 		std::atomic<int16_t> sem_id;
 		std::atomic<size_t> sequence_id;
-		std::atomic<uint64_t> last_touch_time;
+		std::atomic<uint64_t> last_touch_time;  ///< From TimeUtils::gettime_monotonic_coarse_us. Set on state transitions, and refreshed lazily while the buffer is in use.
+		std::atomic<uint32_t> generation;  ///< Odd while a writer owns the buffer, incremented when it is marked Full (see PeekLatest)
+		std::atomic<uint32_t> pending_groups;           ///< Consumer groups (bit 0: regular readers) which have not yet released the buffer
+		std::atomic<uint32_t> group_claims;             ///< Consumer groups currently reading the buffer
+		std::atomic<int16_t> locality;                  ///< Locality hint of the manager which marked the buffer Full (-1: none)
+		std::atomic<uint32_t> regions_expected;         ///< Regions to commit before a shared write completes (0: no shared write open)
+		std::atomic<uint32_t> regions_committed;        ///< Regions committed so far in the current shared write
+		std::atomic<int16_t> shared_write_destination;  ///< Destination to mark the buffer Full for when the shared write completes
+		std::atomic<int> chain_next;                    ///< Next buffer of a chained event (-1: none)
+		std::atomic<bool> targeted;                     ///< Marked Full for a specific destination, and counted in targeted_full_count
+	};
+
+	static constexpr int MAX_SEGMENT_EXTENSIONS = 15;  ///< Maximum number of times AddBuffers may be called on one shared memory
+	static constexpr int16_t HELD_BY_CONSUMER_GROUPS = -2;  ///< sem_id of a Full buffer released by the regular readers but still referenced by consumer groups
+	static constexpr int16_t CHAINED_CONTINUATION = -3;     ///< sem_id of a Full buffer holding the continuation of a chained event
+	static constexpr int MANAGER_SLOTS = 256;               ///< Size of the manager ID to process table (see ShmStruct::managers)
+	static constexpr int OWNED_BUFFER_SLOTS = 16;           ///< Number of buffers tracked per manager (see ManagerSlot::owned)
+
+	struct ManagerSlot
+	{
+		std::atomic<int> manager_id;                       ///< Manager which last registered in this slot (-1: none)
+		std::atomic<int32_t> pid;                          ///< Process of that manager
+		std::atomic<uint64_t> pid_namespace;               ///< Inode of the PID namespace pid belongs to (0: unknown)
+		std::atomic<int32_t> owned[OWNED_BUFFER_SLOTS];  ///< Buffers owned by that manager (-1: unused). Entries are checked against sem_id before use.
+		std::atomic<bool> owned_overflow;                  ///< The manager owned more buffers than fit in owned, which then cannot be relied on until GetBuffersOwnedByManager rebuilds it
 	};
 
 	struct ShmStruct
@@ -383,31 +710,142 @@ private:
 		std::atomic<int> next_id;
 		int rank;
 		unsigned ready_magic;
+		uint64_t layout_signature;  ///< Identifies the layout of these structures, so that a warm restart does not reuse an incompatible segment
+
+		std::atomic<int> last_full_buffer;      ///< Buffer most recently marked Full, for PeekLatest
+		std::atomic<uint32_t> full_generation;  ///< Incremented whenever a buffer becomes Full (futex word)
+		std::atomic<uint32_t> full_waiters;     ///< Number of readers blocked in WaitForFullGeneration
+
+		std::atomic<uint64_t> consumed_count;           ///< Buffers returned to Empty by the readers
+		std::atomic<uint64_t> consumed_sample_count;    ///< consumed_count when consume_rate_mhz was last updated
+		std::atomic<uint64_t> consumed_sample_time_us;  ///< When consume_rate_mhz was last updated (TimeUtils::gettime_monotonic_coarse_us)
+		std::atomic<uint64_t> consume_rate_mhz;         ///< Smoothed consumption rate published by the readers, in mHz
+
+		std::atomic<int> free_count;       ///< Number of Empty buffers not owned by any manager
+		std::atomic<int> ready_count;      ///< Number of Full buffers not owned by any manager
+		std::atomic<int> writing_count;    ///< Number of buffers in the Writing state
+		std::atomic<int> targeted_full_count;  ///< Number of buffers marked Full for a specific destination and not yet claimed (ReadReadyCount scans while non-zero)
+
+		std::atomic<int32_t> sequence_index[SEQUENCE_INDEX_SIZE];  ///< Buffer last marked Full with each sequence ID, modulo SEQUENCE_INDEX_SIZE
+		std::atomic<uint32_t> sequence_index_evictions;             ///< Number of times an event still in the shared memory lost its index entry
+		std::atomic<uint32_t> sequence_index_checked;               ///< Value of sequence_index_evictions when a FindBuffer scan last found no such event left (FindBuffer scans while they differ)
+
+		std::atomic<int> extension_count;                       ///< Number of extension segments created by AddBuffers
+		int extension_segment_ids[MAX_SEGMENT_EXTENSIONS];      ///< shmids of the extension segments
+		int extension_buffer_counts[MAX_SEGMENT_EXTENSIONS];    ///< Number of buffers in each extension segment
+
+		std::atomic<uint32_t> consumer_group_slots;                           ///< Consumer group IDs in use (being registered or registered)
+		std::atomic<uint32_t> consumer_groups;                                ///< Registered consumer groups, which are handed new Full buffers
+		std::atomic<uint32_t> consumer_group_prescales[MAX_CONSUMER_GROUPS];  ///< Prescale of each consumer group
+
+		ManagerSlot managers[MANAGER_SLOTS];  ///< Process of each manager, indexed by manager ID modulo MANAGER_SLOTS
 	};
 
-	inline uint8_t* dataStart_() const
+	/**
+	 * \brief Process-local description of one attached segment (the primary segment, or an extension created by AddBuffers)
+	 */
+	struct ShmSegment
 	{
-		if (shm_ptr_ == nullptr) return nullptr;
-		return reinterpret_cast<uint8_t*>(shm_ptr_ + 1) + shm_ptr_->buffer_count * sizeof(ShmBuffer);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		int segment_id{-1};
+		uint8_t* base{nullptr};
+		ShmBuffer* buffers{nullptr};
+		uint8_t* data{nullptr};
+		int first_buffer{0};
+		int buffer_count{0};
+		std::unique_ptr<std::mutex[]> mutexes;
+		std::unique_ptr<std::atomic<bool>[]> group_owned;  ///< Buffers this manager has claimed for its consumer group
+		std::unique_ptr<size_t[]> group_read_pos;          ///< Read positions of buffers claimed for a consumer group (not shared)
+	};
+
+	inline int bufferCount_() const { return attached_buffer_count_.load(std::memory_order_acquire); }
+
+	inline ShmSegment* segmentFor_(int buffer)
+	{
+		for (auto ii = segment_count_.load(std::memory_order_acquire) - 1; ii > 0; --ii)
+		{
+			if (buffer >= segments_[ii].first_buffer) return &segments_[ii];
+		}
+		return &segments_[0];
 	}
 
 	inline uint8_t* bufferStart_(int buffer)
 	{
 		if (shm_ptr_ == nullptr) return nullptr;
-		if (buffer >= requested_shm_parameters_.buffer_count && buffer >= shm_ptr_->buffer_count) Detach(true, "ArgumentOutOfRange", "The specified buffer does not exist!");
-		return dataStart_() + buffer * shm_ptr_->buffer_size;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		if (buffer >= bufferCount_()) Detach(true, "ArgumentOutOfRange", "The specified buffer does not exist!");
+		auto seg = segmentFor_(buffer);
+		return seg->data + (buffer - seg->first_buffer) * shm_ptr_->buffer_size;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
 	}
 
 	inline ShmBuffer* getBufferInfo_(int buffer)
 	{
 		if (shm_ptr_ == nullptr) return nullptr;
-		// Check local variable first, but re-check shared memory
-		if (buffer >= requested_shm_parameters_.buffer_count && buffer >= shm_ptr_->buffer_count)
-			Detach(true, "ArgumentOutOfRange", "The specified buffer does not exist!");
-		return buffer_ptrs_[buffer];
+		if (buffer >= bufferCount_()) Detach(true, "ArgumentOutOfRange", "The specified buffer does not exist!");
+		auto seg = segmentFor_(buffer);
+		return seg->buffers + (buffer - seg->first_buffer);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	}
+
+	inline std::mutex& bufferMutex_(int buffer)
+	{
+		auto seg = segmentFor_(buffer);
+		return seg->mutexes[buffer - seg->first_buffer];
+	}
+
+	inline std::atomic<bool>& groupOwned_(int buffer)
+	{
+		auto seg = segmentFor_(buffer);
+		return seg->group_owned[buffer - seg->first_buffer];
+	}
+
+	inline bool isConsumerGroup_() const { return consumer_group_ != 0; }
+	inline uint32_t groupBit_() const { return 1u << consumer_group_; }
+	inline bool claimedByGroup_(ShmBuffer* buffer) const { return isConsumerGroup_() && (buffer->group_claims & groupBit_()) != 0; }
+	inline bool ownsForRead_(ShmBuffer* buffer) const { return isConsumerGroup_() ? claimedByGroup_(buffer) : buffer->sem_id == manager_id_; }
+
+	inline size_t& readPos_(int buffer, ShmBuffer* buf)
+	{
+		if (!isConsumerGroup_()) return buf->readPos;
+		auto seg = segmentFor_(buffer);
+		return seg->group_read_pos[buffer - seg->first_buffer];
 	}
+
+	bool readable_(ShmBuffer* buffer) const;
+	int getBufferForGroup_();
+	uint32_t selectGroups_(size_t sequence_id) const;
+	void releaseGroups_(ShmBuffer* buffer, uint32_t groups);
+
+	void addSegment_(int segment_id, uint8_t* base, size_t header_size, int buffer_count);
+	bool refreshSegments_();
 	bool checkBuffer_(ShmBuffer* buffer, BufferSemaphoreFlags flags, bool exceptions = true);
 	void touchBuffer_(ShmBuffer* buffer);
+	void notifyFull_();
+	void markFull_(int buffer, ShmBuffer* shmBuf, int destination);
+	void recordConsumed_();
+	void keepAlive_(ShmBuffer* buffer);
+	void abandonClaim_(ShmBuffer* buffer, int16_t previous_id);
+	bool claim_(ShmBuffer* buffer, BufferSemaphoreFlags sem, int16_t sem_id, BufferSemaphoreFlags target);
+	void revertClaim_(ShmBuffer* buffer, BufferSemaphoreFlags sem, int16_t sem_id);
+	void untarget_(ShmBuffer* buffer);
+	bool trackOwner_(int manager_id, ShmBuffer* buffer, bool owned);
+	int bufferIndex_(ShmBuffer* buffer);
+	void indexSequence_(int buffer, ShmBuffer* shmBuf);
+	bool holdsEvent_(ShmBuffer* buffer, size_t sequence_id) const;
+	void setSem_(ShmBuffer* buffer, BufferSemaphoreFlags sem);
+	void disown_(ShmBuffer* buffer);
+	void countUnowned_(BufferSemaphoreFlags sem, int delta);
+	bool readCountsApply_() const;
+	void sweepStale_();
+	void recount_();
+	int claimContinuation_(ShmBuffer* head);
+	void writeChained_(int buffer, uint8_t const* data, size_t size);
+	int chainSlot_(int buffer, size_t& offset);
+	size_t chainDataSize_(ShmBuffer* head);
+	void commitChain_(ShmBuffer* head);
+	void releaseChain_(ShmBuffer* head);
+	void registerManager_();
+	bool managerIsGone_(int manager_id) const;
+	static uint64_t layoutSignature_();
+	bool layoutMatches_() const;
+	bool warmAttach_();
 
 	ShmStruct requested_shm_parameters_;
 
@@ -415,12 +853,27 @@ private:
 	ShmStruct* shm_ptr_;
 	uint32_t shm_key_;
 	int manager_id_;
-	std::vector<ShmBuffer*> buffer_ptrs_;
-	mutable std::vector<std::mutex> buffer_mutexes_;
+	std::array<ShmSegment, MAX_SEGMENT_EXTENSIONS + 1> segments_;
+	std::atomic<int> segment_count_;
+	std::atomic<int> attached_buffer_count_;
+	mutable std::mutex segment_mutex_;
 	mutable std::mutex search_mutex_;
 
 	std::atomic<size_t> last_seen_id_;
+	WaitPolicy wait_policy_;
 	size_t min_write_size_;
+
+	int consumer_group_;
+
+	int16_t locality_;
+	std::atomic<uint64_t> stolen_buffer_count_;
+
+	bool warm_restart_;
+	bool warm_restarted_;
+	size_t max_chain_length_;
+
+	std::atomic<uint64_t> last_sweep_us_;  ///< When sweepStale_ last scanned the buffers
+	std::atomic<bool> recount_needed_;     ///< Set when a dead manager's buffer was released; its counter updates may be missing
 };
 
 }  // namespace artdaq
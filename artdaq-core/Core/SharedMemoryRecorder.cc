@@ -0,0 +1,332 @@
+#define TRACE_NAME "SharedMemoryRecorder"
+#include "artdaq-core/Core/SharedMemoryRecorder.hh"
+
+#include <aio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "TRACE/tracemf.h"
+#include "artdaq-core/Utilities/TimeUtils.hh"
+
+#define TLVL_RECORD 32
+#define TLVL_FILE 33
+#define TLVL_AIO 34
+
+artdaq::SharedMemoryRecorder::SharedMemoryRecorder(SharedMemoryManager& shm, Config const& config)
+    : shm_(shm)
+    , config_(config)
+    , wait_policy_(WaitPolicy::Default())
+    , current_block_(0)
+    , fd_(-1)
+    , direct_io_(false)
+    , file_offset_(0)
+    , file_bytes_(0)
+    , file_records_(0)
+    , running_(false)
+    , error_(false)
+    , record_count_(0)
+    , bytes_written_(0)
+    , elapsed_us_(0)
+{
+	auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	config_.block_size = std::max((config_.block_size + page_size - 1) / page_size * page_size, page_size);
+	blocks_.resize(std::max(config_.outstanding_writes, static_cast<size_t>(1)));
+	for (auto& block : blocks_)
+	{
+		void* ptr = nullptr;
+		if (posix_memalign(&ptr, page_size, config_.block_size) != 0)
+		{
+			TLOG(TLVL_ERROR) << "SharedMemoryRecorder: Unable to allocate " << config_.block_size << " bytes of staging memory";
+			error_ = true;
+			break;
+		}
+		block.data = static_cast<uint8_t*>(ptr);
+		block.cb = std::make_unique<aiocb>();
+	}
+}
+
+artdaq::SharedMemoryRecorder::~SharedMemoryRecorder()
+{
+	Stop();
+	for (auto& block : blocks_)
+	{
+		free(block.data);  // NOLINT(cppcoreguidelines-no-malloc)
+	}
+}
+
+bool artdaq::SharedMemoryRecorder::Start()
+{
+	if (running_ || error_ || !shm_.IsValid())
+	{
+		return false;
+	}
+	if (record_thread_.joinable())
+	{
+		record_thread_.join();
+	}
+	if (!openFile_())
+	{
+		return false;
+	}
+	running_ = true;
+	record_thread_ = std::thread(&SharedMemoryRecorder::recordLoop_, this);
+	return true;
+}
+
+void artdaq::SharedMemoryRecorder::Stop()
+{
+	running_ = false;
+	if (record_thread_.joinable())
+	{
+		record_thread_.join();
+	}
+}
+
+std::vector<std::string> artdaq::SharedMemoryRecorder::GetFileNames()
+{
+	std::lock_guard<std::mutex> lk(file_names_mutex_);
+	return file_names_;
+}
+
+double artdaq::SharedMemoryRecorder::GetThroughputGBps() const
+{
+	auto elapsed = elapsed_us_.load();
+	return elapsed > 0 ? static_cast<double>(bytes_written_) / elapsed / 1000.0 : 0.0;
+}
+
+void artdaq::SharedMemoryRecorder::recordLoop_()
+{
+	TLOG(TLVL_DEBUG) << "Recording thread started";
+	while (running_)
+	{
+		auto waiter = wait_policy_.MakeWaiter();
+		while (running_ && !shm_.ReadyForRead())
+		{
+			waiter.Wait();
+		}
+		if (!running_)
+		{
+			break;
+		}
+
+		auto buf = shm_.GetBufferForReading();
+		if (buf != -1 && !recordBuffer_(buf))
+		{
+			break;
+		}
+	}
+
+	// Record whatever was already Full when Stop was called, but do not chase a writer which is still running
+	for (size_t ii = 0; !error_ && ii < shm_.size() && shm_.ReadyForRead(); ++ii)
+	{
+		auto buf = shm_.GetBufferForReading();
+		if (buf == -1 || !recordBuffer_(buf))
+		{
+			break;
+		}
+	}
+
+	closeFile_();
+	TLOG(TLVL_INFO) << "Recording stopped: " << record_count_ << " records, " << bytes_written_ << " bytes in " << file_names_.size()
+	                << " files, " << GetThroughputGBps() << " GB/s";
+}
+
+bool artdaq::SharedMemoryRecorder::recordBuffer_(int buffer)
+{
+	detail::RecordHeader header;
+	header.sequence_id = record_count_;
+	header.data_size = shm_.BufferDataSize(buffer);
+	header.timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	auto record_size = header.RecordSize();
+
+	if (file_records_ > 0 && ((config_.max_file_records > 0 && file_records_ >= config_.max_file_records) ||
+	                          (config_.max_file_bytes > 0 && file_bytes_ + record_size > config_.max_file_bytes)))
+	{
+		if (!closeFile_() || !openFile_())
+		{
+			shm_.MarkBufferEmpty(buffer, false, false);
+			return false;
+		}
+	}
+
+	if (record_count_ == 0)
+	{
+		start_time_ = std::chrono::steady_clock::now();
+	}
+
+	TLOG(TLVL_RECORD) << "Recording buffer " << buffer << " as record " << header.sequence_id << " (" << header.data_size << " bytes)";
+	static const uint8_t padding[detail::RecordHeader::ALIGNMENT] = {0};
+	auto ok = append_(&header, sizeof(header));
+	// Events larger than one buffer are chained across several buffers (see SharedMemoryManager::SetMaxChainLength)
+	for (auto const& piece : shm_.GetGatherView(buffer))
+	{
+		ok = ok && append_(piece.first, piece.second);
+	}
+	ok = ok && append_(&padding[0], record_size - sizeof(header) - header.data_size);
+	shm_.MarkBufferEmpty(buffer, false, false);
+	if (!ok)
+	{
+		return false;
+	}
+
+	++record_count_;
+	++file_records_;
+	file_bytes_ += record_size;
+	return true;
+}
+
+bool artdaq::SharedMemoryRecorder::append_(void const* data, size_t size)
+{
+	auto src = static_cast<uint8_t const*>(data);
+	while (size > 0)
+	{
+		auto& block = blocks_[current_block_];
+		auto count = std::min(size, config_.block_size - block.used);
+		memcpy(block.data + block.used, src, count);
+		block.used += count;
+		src += count;
+		size -= count;
+		if (block.used == config_.block_size && !submitBlock_())
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool artdaq::SharedMemoryRecorder::openFile_()
+{
+	char index[16];
+	snprintf(index, sizeof(index), "%04zu", file_names_.size());
+	auto name = config_.directory + "/" + config_.file_prefix + "_" + index + ".dat";
+
+	int flags = O_WRONLY | O_CREAT | O_TRUNC;
+	direct_io_ = false;
+#ifdef O_DIRECT
+	if (config_.use_direct_io)
+	{
+		fd_ = open(name.c_str(), flags | O_DIRECT, 0644);  // NOLINT(cppcoreguidelines-pro-type-vararg)
+		if (fd_ >= 0)
+		{
+			direct_io_ = true;
+		}
+		else if (errno == EINVAL)
+		{
+			TLOG(TLVL_WARNING) << "Filesystem does not support O_DIRECT for " << name << ", using buffered I/O";
+		}
+	}
+#endif
+	if (!direct_io_)
+	{
+		fd_ = open(name.c_str(), flags, 0644);  // NOLINT(cppcoreguidelines-pro-type-vararg)
+	}
+	if (fd_ < 0)
+	{
+		return ioError_("opening " + name, errno);
+	}
+
+	TLOG(TLVL_FILE) << "Opened " << name << (direct_io_ ? " with O_DIRECT" : "");
+	file_offset_ = 0;
+	file_bytes_ = 0;
+	file_records_ = 0;
+	std::lock_guard<std::mutex> lk(file_names_mutex_);
+	file_names_.push_back(name);
+	return true;
+}
+
+bool artdaq::SharedMemoryRecorder::closeFile_()
+{
+	if (fd_ < 0)
+	{
+		return true;
+	}
+
+	// With O_DIRECT, the final partial block is written padded to the page size, and the padding truncated afterwards.
+	// After an error, only wait for the writes in flight, so that the staging blocks are no longer in use.
+	auto ok = !error_ && submitBlock_();
+	for (auto& block : blocks_)
+	{
+		ok = waitForBlock_(block) && ok;
+	}
+	if (ok && direct_io_ && ftruncate(fd_, static_cast<off_t>(file_offset_)) != 0)
+	{
+		ok = ioError_("truncating " + file_names_.back(), errno);
+	}
+	close(fd_);
+	fd_ = -1;
+
+	TLOG(TLVL_FILE) << "Closed " << file_names_.back() << ": " << file_records_ << " records, " << file_offset_ << " bytes";
+	return ok;
+}
+
+bool artdaq::SharedMemoryRecorder::submitBlock_()
+{
+	auto& block = blocks_[current_block_];
+	if (block.used == 0)
+	{
+		return true;
+	}
+
+	auto write_size = block.used;
+	if (direct_io_ && write_size % config_.block_size != 0)
+	{
+		auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+		write_size = (write_size + page_size - 1) / page_size * page_size;
+		memset(block.data + block.used, 0, write_size - block.used);
+	}
+
+	*block.cb = aiocb();
+	block.cb->aio_fildes = fd_;
+	block.cb->aio_buf = block.data;
+	block.cb->aio_nbytes = write_size;
+	block.cb->aio_offset = static_cast<off_t>(file_offset_);
+	TLOG(TLVL_AIO) << "Submitting write of " << write_size << " bytes at offset " << file_offset_ << " from block " << current_block_;
+	if (aio_write(block.cb.get()) != 0)
+	{
+		return ioError_("submitting write to " + file_names_.back(), errno);
+	}
+	block.in_flight = true;
+	file_offset_ += block.used;
+
+	current_block_ = (current_block_ + 1) % blocks_.size();
+	return waitForBlock_(blocks_[current_block_]);
+}
+
+bool artdaq::SharedMemoryRecorder::waitForBlock_(StagingBlock& block)
+{
+	if (!block.in_flight)
+	{
+		return true;
+	}
+
+	aiocb const* list[1] = {block.cb.get()};
+	int err;
+	while ((err = aio_error(block.cb.get())) == EINPROGRESS)
+	{
+		aio_suspend(&list[0], 1, nullptr);
+	}
+	block.in_flight = false;
+	auto written = aio_return(block.cb.get());
+	if (err != 0 || written != static_cast<ssize_t>(block.cb->aio_nbytes))
+	{
+		return ioError_("writing " + file_names_.back(), err != 0 ? err : EIO);
+	}
+
+	bytes_written_ += block.used;
+	block.used = 0;
+	elapsed_us_ = TimeUtils::GetElapsedTimeMicroseconds(start_time_);
+	return true;
+}
+
+bool artdaq::SharedMemoryRecorder::ioError_(std::string const& what, int err)
+{
+	TLOG(TLVL_ERROR) << "SharedMemoryRecorder: Error " << what << ", errno=" << err << " (" << strerror(err) << "). Recording stopped.";
+	error_ = true;
+	running_ = false;
+	return false;
+}
@@ -0,0 +1,180 @@
+#ifndef artdaq_core_Core_SharedMemoryRecorder_hh
+#define artdaq_core_Core_SharedMemoryRecorder_hh 1
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "artdaq-core/Core/SharedMemoryManager.hh"
+#include "artdaq-core/Core/WaitPolicy.hh"
+
+struct aiocb;
+
+namespace artdaq {
+namespace detail {
+/**
+ * \brief Header preceding each buffer's data in a SharedMemoryRecorder file
+ *
+ * Records are packed back-to-back; each one is padded to a multiple of RecordHeader::ALIGNMENT bytes.
+ */
+struct RecordHeader
+{
+	static constexpr uint32_t MAGIC = 0x52454344;  ///< "RECD"
+	static constexpr size_t ALIGNMENT = 8;         ///< Records start on multiples of this many bytes
+
+	uint32_t magic{MAGIC};                    ///< Record marker, to detect a corrupted file
+	uint32_t header_size{sizeof(RecordHeader)};  ///< Size of this header, in bytes
+	uint64_t sequence_id{0};                  ///< Number of the record since the recorder was started
+	uint64_t data_size{0};                    ///< Number of data bytes following the header
+	uint64_t timestamp_ns{0};                 ///< Wall-clock time at which the buffer was recorded, in ns since the epoch
+
+	/**
+	 * \brief Get the number of bytes the record occupies in the file, including the header and padding
+	 * \return Padded record size, in bytes
+	 */
+	uint64_t RecordSize() const { return (header_size + data_size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT; }
+};
+}  // namespace detail
+
+/**
+ * \brief Drains Full buffers from a SharedMemoryManager straight to raw data files
+ *
+ * Data is staged into page-aligned blocks, which are written with O_DIRECT (where the filesystem supports it)
+ * using POSIX asynchronous I/O, with several writes outstanding per file. Files are rolled over when they
+ * reach a configured size or record count.
+ */
+class SharedMemoryRecorder
+{
+public:
+	/**
+	 * \brief Configuration of a SharedMemoryRecorder
+	 */
+	struct Config
+	{
+		std::string directory{"."};             ///< Directory to write files into
+		std::string file_prefix{"artdaq_shm"};  ///< Files are named <prefix>_<index>.dat
+		uint64_t max_file_bytes{0};             ///< Start a new file once this many bytes are written (0: no limit)
+		uint64_t max_file_records{0};           ///< Start a new file once this many records are written (0: no limit)
+		size_t block_size{4 * 1024 * 1024};     ///< Size of each write. Rounded up to a multiple of the page size.
+		size_t outstanding_writes{4};           ///< Number of writes which may be in flight at once
+		bool use_direct_io{true};               ///< Open files with O_DIRECT, bypassing the page cache
+	};
+
+	/**
+	 * \brief SharedMemoryRecorder Constructor
+	 * \param shm SharedMemoryManager to read buffers from. Must outlive the recorder.
+	 * \param config Recorder configuration
+	 */
+	SharedMemoryRecorder(SharedMemoryManager& shm, Config const& config);
+
+	/**
+	 * \brief SharedMemoryRecorder Destructor. Stops recording, if necessary.
+	 */
+	virtual ~SharedMemoryRecorder();
+
+	SharedMemoryRecorder(SharedMemoryRecorder const&) = delete;             ///< Copy Constructor is deleted
+	SharedMemoryRecorder(SharedMemoryRecorder&&) = delete;                  ///< Move Constructor is deleted
+	SharedMemoryRecorder& operator=(SharedMemoryRecorder const&) = delete;  ///< Copy Assignment Operator is deleted
+	SharedMemoryRecorder& operator=(SharedMemoryRecorder&&) = delete;       ///< Move Assignment Operator is deleted
+
+	/**
+	 * \brief Start the recording thread
+	 * \return Whether recording was started
+	 */
+	bool Start();
+
+	/**
+	 * \brief Stop recording. Buffers which are already Full are recorded, then all writes are completed and the file closed.
+	 */
+	void Stop();
+
+	/**
+	 * \brief Whether the recording thread is running
+	 * \return True between Start and Stop, unless an I/O error stopped the recording
+	 */
+	bool IsRunning() const { return running_; }
+
+	/**
+	 * \brief Whether recording was stopped by an I/O error
+	 * \return True if an error occurred
+	 */
+	bool HasError() const { return error_; }
+
+	/**
+	 * \brief Set the WaitPolicy used while waiting for Full buffers
+	 * \param policy WaitPolicy to use
+	 */
+	void SetWaitPolicy(WaitPolicy const& policy) { wait_policy_ = policy; }
+
+	/**
+	 * \brief Get the number of records written
+	 * \return Number of buffers recorded
+	 */
+	uint64_t GetRecordCount() const { return record_count_; }
+
+	/**
+	 * \brief Get the number of bytes written, including record headers
+	 * \return Number of bytes written to disk
+	 */
+	uint64_t GetBytesWritten() const { return bytes_written_; }
+
+	/**
+	 * \brief Get the names of the files written so far (including the one currently open)
+	 * \return List of file paths
+	 */
+	std::vector<std::string> GetFileNames();
+
+	/**
+	 * \brief Get the sustained write rate, from the first record to the last completed write
+	 * \return Write rate, in GB/s (10^9 bytes per second)
+	 */
+	double GetThroughputGBps() const;
+
+private:
+	struct StagingBlock
+	{
+		uint8_t* data{nullptr};
+		size_t used{0};
+		bool in_flight{false};
+		std::unique_ptr<aiocb> cb;
+	};
+
+	void recordLoop_();
+	bool recordBuffer_(int buffer);
+	bool append_(void const* data, size_t size);
+	bool openFile_();
+	bool closeFile_();
+	bool submitBlock_();
+	bool waitForBlock_(StagingBlock& block);
+	bool ioError_(std::string const& what, int err);
+
+	SharedMemoryManager& shm_;
+	Config config_;
+	WaitPolicy wait_policy_;
+	std::vector<StagingBlock> blocks_;
+	size_t current_block_;
+
+	int fd_;
+	bool direct_io_;
+	uint64_t file_offset_;
+	uint64_t file_bytes_;
+	uint64_t file_records_;
+	std::mutex file_names_mutex_;
+	std::vector<std::string> file_names_;
+
+	std::atomic<bool> running_;
+	std::atomic<bool> error_;
+	std::thread record_thread_;
+	std::atomic<uint64_t> record_count_;
+	std::atomic<uint64_t> bytes_written_;
+	std::chrono::steady_clock::time_point start_time_;
+	std::atomic<int64_t> elapsed_us_;
+};
+}  // namespace artdaq
+
+#endif  // artdaq_core_Core_SharedMemoryRecorder_hh
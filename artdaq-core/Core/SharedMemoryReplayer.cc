@@ -0,0 +1,294 @@
+#define TRACE_NAME "SharedMemoryReplayer"
+#include "artdaq-core/Core/SharedMemoryReplayer.hh"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "TRACE/tracemf.h"
+#include "artdaq-core/Utilities/TimeUtils.hh"
+
+#define TLVL_INJECT 32
+#define TLVL_FILE 33
+
+namespace {
+/// Longest single sleep while pacing, so that Stop is noticed promptly
+constexpr auto MAX_SLEEP = std::chrono::milliseconds(100);
+
+bool readHeader(uint8_t const* pos, uint8_t const* end, artdaq::detail::RecordHeader& header)
+{
+	if (pos + sizeof(header) > end)
+	{
+		return false;
+	}
+	memcpy(&header, pos, sizeof(header));
+	return header.magic == artdaq::detail::RecordHeader::MAGIC && header.header_size >= sizeof(header) &&
+	       header.RecordSize() <= static_cast<uint64_t>(end - pos);
+}
+}  // namespace
+
+artdaq::SharedMemoryReplayer::SharedMemoryReplayer(SharedMemoryManager& shm, Config const& config)
+    : shm_(shm)
+    , config_(config)
+    , wait_policy_(WaitPolicy::Default())
+    , file_record_count_(0)
+    , file_data_bytes_(0)
+    , running_(false)
+    , event_count_(0)
+    , bytes_written_(0)
+    , skipped_count_(0)
+    , elapsed_us_(0)
+    , target_rate_hz_(0.0)
+{
+	if (config_.multiplier <= 0.0)
+	{
+		TLOG(TLVL_WARNING) << "SharedMemoryReplayer: Invalid multiplier " << config_.multiplier << ", using 1.0";
+		config_.multiplier = 1.0;
+	}
+	config_.burst_size = std::max(config_.burst_size, static_cast<size_t>(1));
+}
+
+artdaq::SharedMemoryReplayer::~SharedMemoryReplayer()
+{
+	Stop();
+	unmapFiles_();
+}
+
+bool artdaq::SharedMemoryReplayer::Start()
+{
+	if (running_ || !shm_.IsValid())
+	{
+		return false;
+	}
+	if (replay_thread_.joinable())
+	{
+		replay_thread_.join();
+	}
+	if (files_.empty() && !mapFiles_())
+	{
+		unmapFiles_();
+		return false;
+	}
+
+	event_count_ = 0;
+	bytes_written_ = 0;
+	skipped_count_ = 0;
+	elapsed_us_ = 0;
+	running_ = true;
+	replay_thread_ = std::thread(&SharedMemoryReplayer::replayLoop_, this);
+	return true;
+}
+
+void artdaq::SharedMemoryReplayer::Stop()
+{
+	running_ = false;
+	if (replay_thread_.joinable())
+	{
+		replay_thread_.join();
+	}
+}
+
+double artdaq::SharedMemoryReplayer::GetAchievedRateHz() const
+{
+	auto elapsed = elapsed_us_.load();
+	auto events = event_count_.load();
+	return elapsed > 0 && events > 1 ? (events - 1) * 1000000.0 / elapsed : 0.0;
+}
+
+double artdaq::SharedMemoryReplayer::GetTargetThroughputGBps() const
+{
+	return file_record_count_ > 0 ? target_rate_hz_ * file_data_bytes_ / file_record_count_ / 1e9 : 0.0;
+}
+
+double artdaq::SharedMemoryReplayer::GetAchievedThroughputGBps() const
+{
+	auto events = event_count_.load();
+	return events > 0 ? GetAchievedRateHz() * bytes_written_ / events / 1e9 : 0.0;
+}
+
+bool artdaq::SharedMemoryReplayer::mapFiles_()
+{
+	uint64_t first_timestamp = 0;
+	uint64_t last_timestamp = 0;
+	for (auto& name : config_.files)
+	{
+		int fd = open(name.c_str(), O_RDONLY);  // NOLINT(cppcoreguidelines-pro-type-vararg)
+		struct stat st = {};
+		if (fd < 0 || fstat(fd, &st) != 0)
+		{
+			TLOG(TLVL_ERROR) << "SharedMemoryReplayer: Unable to open " << name << ", errno=" << errno << " (" << strerror(errno) << ")";
+			if (fd >= 0)
+			{
+				close(fd);
+			}
+			return false;
+		}
+		if (st.st_size == 0)
+		{
+			close(fd);
+			continue;
+		}
+
+		auto ptr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (ptr == MAP_FAILED)  // NOLINT(cppcoreguidelines-pro-type-cstyle-cast)
+		{
+			TLOG(TLVL_ERROR) << "SharedMemoryReplayer: Unable to map " << name << ", errno=" << errno << " (" << strerror(errno) << ")";
+			return false;
+		}
+		madvise(ptr, st.st_size, MADV_SEQUENTIAL);
+
+		MappedFile file;
+		file.data = static_cast<uint8_t const*>(ptr);
+		file.size = st.st_size;
+		files_.push_back(file);
+
+		detail::RecordHeader header;
+		size_t records = 0;
+		for (auto pos = file.data; readHeader(pos, file.data + file.size, header); pos += header.RecordSize())
+		{
+			if (file_record_count_ == 0)
+			{
+				first_timestamp = header.timestamp_ns;
+			}
+			last_timestamp = header.timestamp_ns;
+			++file_record_count_;
+			file_data_bytes_ += header.data_size;
+			++records;
+		}
+		TLOG(TLVL_FILE) << "Mapped " << name << ": " << records << " records, " << file.size << " bytes";
+	}
+	if (file_record_count_ == 0)
+	{
+		TLOG(TLVL_ERROR) << "SharedMemoryReplayer: The " << config_.files.size() << " input file(s) contain no valid records, nothing to replay";
+		return false;
+	}
+
+	switch (config_.mode)
+	{
+		case ReplayMode::Fixed:
+		case ReplayMode::Bursty:
+			target_rate_hz_ = config_.rate_hz * config_.multiplier;
+			break;
+		case ReplayMode::AsRecorded:
+			target_rate_hz_ = last_timestamp > first_timestamp
+			                      ? (file_record_count_ - 1) * 1e9 / (last_timestamp - first_timestamp) * config_.multiplier
+			                      : 0.0;
+			break;
+	}
+	return true;
+}
+
+void artdaq::SharedMemoryReplayer::unmapFiles_()
+{
+	for (auto& file : files_)
+	{
+		munmap(const_cast<uint8_t*>(file.data), file.size);  // NOLINT(cppcoreguidelines-pro-type-const-cast)
+	}
+	files_.clear();
+	file_record_count_ = 0;
+	file_data_bytes_ = 0;
+}
+
+void artdaq::SharedMemoryReplayer::replayLoop_()
+{
+	TLOG(TLVL_DEBUG) << "Replay thread started, target rate " << target_rate_hz_ << " Hz";
+	auto period = std::chrono::duration<double>(config_.mode != ReplayMode::AsRecorded && config_.rate_hz > 0 ? 1.0 / (config_.rate_hz * config_.multiplier) : 0.0);
+	auto start_time = std::chrono::steady_clock::now();
+	auto next_time = start_time;
+	uint64_t index = 0;
+	uint64_t previous_timestamp = 0;
+
+	for (size_t loop = 0; running_ && (config_.loops == 0 || loop < config_.loops); ++loop)
+	{
+		for (auto& file : files_)
+		{
+			detail::RecordHeader header;
+			auto end = file.data + file.size;
+			auto pos = file.data;
+			for (; running_ && readHeader(pos, end, header); pos += header.RecordSize(), ++index)
+			{
+				switch (config_.mode)
+				{
+					case ReplayMode::Fixed:
+						next_time = start_time + std::chrono::duration_cast<std::chrono::steady_clock::duration>(period * index);
+						break;
+					case ReplayMode::Bursty:
+						next_time = start_time + std::chrono::duration_cast<std::chrono::steady_clock::duration>(period * (index / config_.burst_size * config_.burst_size));
+						break;
+					case ReplayMode::AsRecorded:
+						// Time going backwards (e.g. at the start of a new loop) is replayed without a gap
+						if (index > 0 && header.timestamp_ns > previous_timestamp)
+						{
+							next_time += std::chrono::nanoseconds(static_cast<int64_t>((header.timestamp_ns - previous_timestamp) / config_.multiplier));
+						}
+						previous_timestamp = header.timestamp_ns;
+						break;
+				}
+
+				if (!sleepUntil_(next_time) || !inject_(pos + header.header_size, header.data_size))
+				{
+					break;
+				}
+				if (index == 0)
+				{
+					start_time = std::chrono::steady_clock::now();
+					next_time = start_time;
+				}
+				elapsed_us_ = TimeUtils::GetElapsedTimeMicroseconds(start_time);
+			}
+			if (running_ && pos != end)
+			{
+				TLOG(TLVL_WARNING) << "SharedMemoryReplayer: Invalid record at offset " << (pos - file.data) << ", skipping the rest of the file";
+			}
+		}
+	}
+
+	TLOG(TLVL_INFO) << "Replay finished: " << event_count_ << " records, " << bytes_written_ << " bytes. Achieved " << GetAchievedRateHz()
+	                << " Hz (" << GetAchievedThroughputGBps() << " GB/s), target " << target_rate_hz_ << " Hz (" << GetTargetThroughputGBps() << " GB/s)";
+	running_ = false;
+}
+
+bool artdaq::SharedMemoryReplayer::inject_(uint8_t const* data, size_t size)
+{
+	// Larger records are written across chained buffers, if the manager allows it (see SharedMemoryManager::SetMaxChainLength)
+	if (size > shm_.BufferSize() * shm_.GetMaxChainLength())
+	{
+		TLOG(TLVL_WARNING) << "SharedMemoryReplayer: Record of " << size << " bytes does not fit in " << shm_.GetMaxChainLength() << " buffer(s) of " << shm_.BufferSize() << " bytes, skipping";
+		++skipped_count_;
+		return true;
+	}
+
+	auto waiter = wait_policy_.MakeWaiter();
+	int buffer = -1;
+	while (running_ && (buffer = shm_.GetBufferForWriting(config_.overwrite)) == -1)
+	{
+		waiter.Wait();
+	}
+	if (buffer == -1)
+	{
+		return false;
+	}
+
+	TLOG(TLVL_INJECT) << "Injecting " << size << " bytes into buffer " << buffer;
+	shm_.Write(buffer, const_cast<uint8_t*>(data), size);  // NOLINT(cppcoreguidelines-pro-type-const-cast)
+	shm_.MarkBufferFull(buffer);
+	++event_count_;
+	bytes_written_ += size;
+	return true;
+}
+
+bool artdaq::SharedMemoryReplayer::sleepUntil_(std::chrono::steady_clock::time_point when)
+{
+	auto now = std::chrono::steady_clock::now();
+	while (running_ && now < when)
+	{
+		std::this_thread::sleep_until(std::min(when, now + MAX_SLEEP));
+		now = std::chrono::steady_clock::now();
+	}
+	return running_;
+}
@@ -0,0 +1,162 @@
+#ifndef artdaq_core_Core_SharedMemoryReplayer_hh
+#define artdaq_core_Core_SharedMemoryReplayer_hh 1
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "artdaq-core/Core/SharedMemoryManager.hh"
+#include "artdaq-core/Core/SharedMemoryRecorder.hh"
+#include "artdaq-core/Core/WaitPolicy.hh"
+
+namespace artdaq {
+/**
+ * \brief Injects records from SharedMemoryRecorder files into a shared memory segment at a controlled rate
+ *
+ * Files are memory-mapped, and each record's data is written into its own buffer, which is then marked Full.
+ * The target may be any SharedMemoryManager, including a SharedMemoryFragmentManager or an event segment,
+ * so recorded data can be pushed back through downstream consumers for load testing.
+ */
+class SharedMemoryReplayer
+{
+public:
+	/**
+	 * \brief How records are paced
+	 */
+	enum class ReplayMode
+	{
+		Fixed,       ///< Evenly-spaced records at rate_hz
+		Bursty,      ///< burst_size records back-to-back, with bursts spaced to average rate_hz
+		AsRecorded,  ///< Records spaced as in the RecordHeader timestamps
+	};
+
+	/**
+	 * \brief Configuration of a SharedMemoryReplayer
+	 */
+	struct Config
+	{
+		std::vector<std::string> files;      ///< Files to replay, in order
+		ReplayMode mode{ReplayMode::Fixed};  ///< How records are paced
+		double rate_hz{0.0};                 ///< Records per second for Fixed and Bursty modes (0: as fast as possible)
+		size_t burst_size{1};                ///< Records per burst in Bursty mode
+		double multiplier{1.0};              ///< Speed-up factor applied to the rate (or to the recorded time in AsRecorded mode)
+		size_t loops{1};                     ///< Number of passes over the files (0: loop until Stop)
+		bool overwrite{false};               ///< Overwrite Full buffers instead of waiting for Empty ones
+	};
+
+	/**
+	 * \brief SharedMemoryReplayer Constructor
+	 * \param shm SharedMemoryManager to inject records into. Must outlive the replayer.
+	 * \param config Replayer configuration
+	 */
+	SharedMemoryReplayer(SharedMemoryManager& shm, Config const& config);
+
+	/**
+	 * \brief SharedMemoryReplayer Destructor. Stops the replay and unmaps the files.
+	 */
+	virtual ~SharedMemoryReplayer();
+
+	SharedMemoryReplayer(SharedMemoryReplayer const&) = delete;             ///< Copy Constructor is deleted
+	SharedMemoryReplayer(SharedMemoryReplayer&&) = delete;                  ///< Move Constructor is deleted
+	SharedMemoryReplayer& operator=(SharedMemoryReplayer const&) = delete;  ///< Copy Assignment Operator is deleted
+	SharedMemoryReplayer& operator=(SharedMemoryReplayer&&) = delete;       ///< Move Assignment Operator is deleted
+
+	/**
+	 * \brief Map the files and start the replay thread
+	 * \return Whether the replay was started (false if a file cannot be mapped, or the files contain no valid records)
+	 */
+	bool Start();
+
+	/**
+	 * \brief Stop the replay. Returns once the replay thread has exited.
+	 */
+	void Stop();
+
+	/**
+	 * \brief Whether the replay thread is running
+	 * \return True from Start until all loops are done or Stop is called
+	 */
+	bool IsRunning() const { return running_; }
+
+	/**
+	 * \brief Set the WaitPolicy used while waiting for a buffer to write into
+	 * \param policy WaitPolicy to use
+	 */
+	void SetWaitPolicy(WaitPolicy const& policy) { wait_policy_ = policy; }
+
+	/**
+	 * \brief Get the number of records injected
+	 * \return Number of buffers written
+	 */
+	uint64_t GetEventCount() const { return event_count_; }
+
+	/**
+	 * \brief Get the number of data bytes injected
+	 * \return Number of bytes written to shared memory
+	 */
+	uint64_t GetBytesWritten() const { return bytes_written_; }
+
+	/**
+	 * \brief Get the number of records skipped because they did not fit in a buffer
+	 * \return Number of records skipped
+	 */
+	uint64_t GetSkippedCount() const { return skipped_count_; }
+
+	/**
+	 * \brief Get the configured record rate (in AsRecorded mode, derived from the file timestamps)
+	 * \return Target rate, in Hz (0 if unlimited)
+	 */
+	double GetTargetRateHz() const { return target_rate_hz_; }
+
+	/**
+	 * \brief Get the record rate achieved between the first and the latest injected record
+	 * \return Achieved rate, in Hz
+	 */
+	double GetAchievedRateHz() const;
+
+	/**
+	 * \brief Get the configured throughput, from the target rate and the average record size
+	 * \return Target throughput, in GB/s (10^9 bytes per second; 0 if unlimited)
+	 */
+	double GetTargetThroughputGBps() const;
+
+	/**
+	 * \brief Get the throughput achieved between the first and the latest injected record
+	 * \return Achieved throughput, in GB/s (10^9 bytes per second)
+	 */
+	double GetAchievedThroughputGBps() const;
+
+private:
+	struct MappedFile
+	{
+		uint8_t const* data{nullptr};
+		size_t size{0};
+	};
+
+	bool mapFiles_();
+	void unmapFiles_();
+	void replayLoop_();
+	bool inject_(uint8_t const* data, size_t size);
+	bool sleepUntil_(std::chrono::steady_clock::time_point when);
+
+	SharedMemoryManager& shm_;
+	Config config_;
+	WaitPolicy wait_policy_;
+	std::vector<MappedFile> files_;
+	uint64_t file_record_count_;
+	uint64_t file_data_bytes_;
+
+	std::atomic<bool> running_;
+	std::thread replay_thread_;
+	std::atomic<uint64_t> event_count_;
+	std::atomic<uint64_t> bytes_written_;
+	std::atomic<uint64_t> skipped_count_;
+	std::atomic<int64_t> elapsed_us_;
+	double target_rate_hz_;
+};
+}  // namespace artdaq
+
+#endif  // artdaq_core_Core_SharedMemoryReplayer_hh
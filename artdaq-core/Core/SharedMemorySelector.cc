@@ -0,0 +1,76 @@
+#define TRACE_NAME "SharedMemorySelector"
+#include "artdaq-core/Core/SharedMemorySelector.hh"
+
+#include <algorithm>
+
+#include "TRACE/tracemf.h"
+#include "artdaq-core/Utilities/TimeUtils.hh"
+
+#define TLVL_SELECT 32
+
+artdaq::SharedMemorySelector::SharedMemorySelector(uint64_t lane_check_us, uint64_t rescan_us)
+    : lane_check_us_(std::max(lane_check_us, static_cast<uint64_t>(1)))
+    , rescan_us_(std::max(rescan_us, static_cast<uint64_t>(1)))
+    , last_rescan_(std::chrono::steady_clock::now())
+{
+}
+
+size_t artdaq::SharedMemorySelector::AddLane(SharedMemoryManager& shm)
+{
+	Lane lane;
+	lane.shm = &shm;
+	lanes_.push_back(lane);
+	return lanes_.size() - 1;
+}
+
+int artdaq::SharedMemorySelector::Select(uint64_t timeout_us, size_t lane_count)
+{
+	lane_count = std::min(lane_count, lanes_.size());
+	if (lane_count == 0)
+	{
+		return -1;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	while (true)
+	{
+		auto rescan = static_cast<uint64_t>(TimeUtils::GetElapsedTimeMicroseconds(last_rescan_)) >= rescan_us_;
+		for (size_t ii = 0; ii < lane_count; ++ii)
+		{
+			auto& lane = lanes_[ii];
+			// Read the counter before scanning, so that a buffer marked Full during the scan is not missed
+			auto generation = lane.shm->GetFullGeneration();
+			if (lane.idle && generation == lane.generation && !rescan)
+			{
+				continue;
+			}
+			lane.generation = generation;
+			++lane.scans;
+			lane.idle = !lane.shm->ReadyForRead();
+			if (!lane.idle)
+			{
+				TLOG(TLVL_SELECT) << "Select: lane " << ii << " has a buffer ready for reading";
+				return static_cast<int>(ii);
+			}
+		}
+		if (rescan)
+		{
+			last_rescan_ = std::chrono::steady_clock::now();
+		}
+
+		auto elapsed = static_cast<uint64_t>(TimeUtils::GetElapsedTimeMicroseconds(start));
+		if (elapsed >= timeout_us)
+		{
+			return -1;
+		}
+
+		// Block on the lowest-priority lane, waking up to check the others' counters and for the periodic re-scan
+		auto wait_us = std::min(timeout_us - elapsed, rescan_us_);
+		if (lane_count > 1)
+		{
+			wait_us = std::min(wait_us, lane_check_us_);
+		}
+		auto& lane = lanes_[lane_count - 1];
+		lane.shm->WaitForFullGeneration(lane.generation, wait_us);
+	}
+}
@@ -0,0 +1,77 @@
+#ifndef artdaq_core_Core_SharedMemorySelector_hh
+#define artdaq_core_Core_SharedMemorySelector_hh 1
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "artdaq-core/Core/SharedMemoryManager.hh"
+
+namespace artdaq {
+/**
+ * \brief Waits for a readable buffer on several SharedMemoryManager "lanes", with strict priority between them
+ *
+ * A lane whose last scan found nothing is only scanned again once its full-generation counter
+ * (SharedMemoryManager::GetFullGeneration) changes, so an idle poll costs one atomic load per lane instead
+ * of a locked scan per segment. While nothing is readable, the selector blocks on the lowest-priority lane's
+ * counter and re-checks the higher-priority lanes' counters periodically. Every lane is also re-scanned
+ * periodically, so that stale buffers are still reset (see SharedMemoryManager::ResetBuffer).
+ */
+class SharedMemorySelector
+{
+public:
+	/**
+	 * \brief SharedMemorySelector Constructor
+	 * \param lane_check_us While blocked on the lowest-priority lane, how often to check the other lanes, in microseconds
+	 * \param rescan_us How often to scan every lane regardless of its counter, in microseconds
+	 */
+	explicit SharedMemorySelector(uint64_t lane_check_us = 1000, uint64_t rescan_us = 100000);
+
+	/**
+	 * \brief Add a lane. Lanes are checked in the order they were added; the first has the highest priority.
+	 * \param shm SharedMemoryManager to read from. Must outlive the selector.
+	 * \return Index of the new lane
+	 */
+	size_t AddLane(SharedMemoryManager& shm);
+
+	/**
+	 * \brief Get the number of lanes
+	 * \return Number of lanes added with AddLane
+	 */
+	size_t size() const { return lanes_.size(); }
+
+	/**
+	 * \brief Wait until one of the lanes has a buffer ready for reading
+	 * \param timeout_us Maximum time to wait, in microseconds. With 0, each lane is checked once.
+	 * \param lane_count Only consider the first lane_count lanes (by default, all of them)
+	 * \return Index of the highest-priority lane with a buffer ready for reading, or -1 if the timeout expired
+	 *
+	 * The caller is expected to call GetBufferForReading on the returned lane. That may still fail if another
+	 * reader claimed the buffer first, in which case Select can simply be called again.
+	 */
+	int Select(uint64_t timeout_us, size_t lane_count = SIZE_MAX);
+
+	/**
+	 * \brief Get the number of ReadyForRead scans performed on a lane, for diagnostics
+	 * \param lane Index of the lane
+	 * \return Number of scans since the lane was added
+	 */
+	uint64_t GetScanCount(size_t lane) const { return lane < lanes_.size() ? lanes_[lane].scans : 0; }
+
+private:
+	struct Lane
+	{
+		SharedMemoryManager* shm{nullptr};
+		uint32_t generation{0};
+		bool idle{false};
+		uint64_t scans{0};
+	};
+
+	std::vector<Lane> lanes_;
+	uint64_t lane_check_us_;
+	uint64_t rescan_us_;
+	std::chrono::steady_clock::time_point last_rescan_;
+};
+}  // namespace artdaq
+
+#endif  // artdaq_core_Core_SharedMemorySelector_hh
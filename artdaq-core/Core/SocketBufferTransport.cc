@@ -0,0 +1,787 @@
+#define TRACE_NAME "SocketBufferTransport"
+#include "artdaq-core/Core/SocketBufferTransport.hh"
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <set>
+#ifdef __linux__
+#include <linux/errqueue.h>
+#endif
+
+#include "TRACE/tracemf.h"
+#include "artdaq-core/Core/WaitPolicy.hh"
+#include "cetlib_except/exception.h"
+
+#define TLVL_CONNECT 32
+#define TLVL_REQUEST 33
+#define TLVL_ZEROCOPY 34
+
+#if defined(__linux__) && defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+#define SOCKET_BUFFER_ZEROCOPY 1
+#endif
+
+namespace {
+/// Read payloads smaller than this are copied into the socket; pinning pages costs more than the copy.
+constexpr size_t ZEROCOPY_THRESHOLD = 16384;
+/// Number of batched releases after which the client sends them without waiting for the next request
+constexpr size_t MAX_PENDING_RELEASES = 64;
+
+struct SocketAddress
+{
+	sockaddr_storage storage{};
+	socklen_t length{0};
+	bool is_tcp{false};
+	std::string unix_path;
+};
+
+bool parseAddress(std::string const& address, SocketAddress& out)
+{
+	if (address.compare(0, 5, "unix:") == 0)
+	{
+		auto path = address.substr(5);
+		auto sun = reinterpret_cast<sockaddr_un*>(&out.storage);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+		if (path.empty() || path.size() >= sizeof(sun->sun_path))
+		{
+			TLOG(TLVL_ERROR) << "Invalid Unix-domain socket path \"" << path << "\"";
+			return false;
+		}
+		sun->sun_family = AF_UNIX;
+		strncpy(&sun->sun_path[0], path.c_str(), sizeof(sun->sun_path) - 1);
+		out.length = sizeof(sockaddr_un);
+		out.is_tcp = false;
+		out.unix_path = path;
+		return true;
+	}
+	if (address.compare(0, 4, "tcp:") == 0)
+	{
+		auto hostport = address.substr(4);
+		auto colon = hostport.rfind(':');
+		if (colon == std::string::npos)
+		{
+			TLOG(TLVL_ERROR) << "TCP address \"" << address << "\" does not have the form tcp:host:port";
+			return false;
+		}
+		auto host = hostport.substr(0, colon);
+		auto port = hostport.substr(colon + 1);
+
+		addrinfo hints{};
+		hints.ai_family = AF_INET;
+		hints.ai_socktype = SOCK_STREAM;
+		addrinfo* result = nullptr;
+		auto sts = getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &result);
+		if (sts != 0 || result == nullptr)
+		{
+			TLOG(TLVL_ERROR) << "Could not resolve \"" << address << "\": " << gai_strerror(sts);
+			return false;
+		}
+		memcpy(&out.storage, result->ai_addr, result->ai_addrlen);
+		out.length = result->ai_addrlen;
+		out.is_tcp = true;
+		freeaddrinfo(result);
+		return true;
+	}
+	TLOG(TLVL_ERROR) << "Unknown socket address \"" << address << "\" (expected unix:/path or tcp:host:port)";
+	return false;
+}
+
+bool recvAll(int fd, void* data, size_t size)
+{
+	auto ptr = static_cast<uint8_t*>(data);
+	while (size > 0)
+	{
+		auto sts = recv(fd, ptr, size, 0);
+		if (sts < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (sts <= 0)
+		{
+			return false;
+		}
+		ptr += sts;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		size -= sts;
+	}
+	return true;
+}
+
+bool discardAll(int fd, size_t size)
+{
+	uint8_t scratch[4096];
+	while (size > 0)
+	{
+		auto chunk = std::min(size, sizeof(scratch));
+		if (!recvAll(fd, &scratch[0], chunk))
+		{
+			return false;
+		}
+		size -= chunk;
+	}
+	return true;
+}
+
+// With MSG_ZEROCOPY in flags, zerocopy_sends is incremented for every sendmsg call the kernel will report a completion for
+bool sendIov(int fd, iovec* iov, size_t count, int flags, uint32_t* zerocopy_sends = nullptr)
+{
+	while (count > 0)
+	{
+		msghdr msg{};
+		msg.msg_iov = iov;
+		msg.msg_iovlen = count;
+		auto sts = sendmsg(fd, &msg, flags | MSG_NOSIGNAL);
+		if (sts < 0 && errno == EINTR)
+		{
+			continue;
+		}
+#ifdef SOCKET_BUFFER_ZEROCOPY
+		if (sts < 0 && errno == ENOBUFS && (flags & MSG_ZEROCOPY) != 0)
+		{
+			// The socket's optmem limit is exhausted by outstanding completions; send the rest by copying
+			TLOG(TLVL_ZEROCOPY) << "sendIov: MSG_ZEROCOPY send failed with ENOBUFS, copying instead";
+			flags &= ~MSG_ZEROCOPY;
+			continue;
+		}
+#endif
+		if (sts < 0)
+		{
+			return false;
+		}
+#ifdef SOCKET_BUFFER_ZEROCOPY
+		if ((flags & MSG_ZEROCOPY) != 0 && zerocopy_sends != nullptr)
+		{
+			++*zerocopy_sends;
+		}
+#endif
+		// Skip past the iovecs which were sent completely, then adjust the partially-sent one
+		auto sent = static_cast<size_t>(sts);
+		while (count > 0 && sent >= iov->iov_len)
+		{
+			sent -= iov->iov_len;
+			++iov;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+			--count;
+		}
+		if (count > 0)
+		{
+			iov->iov_base = static_cast<uint8_t*>(iov->iov_base) + sent;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+			iov->iov_len -= sent;
+		}
+	}
+	return true;
+}
+}  // namespace
+
+artdaq::SocketBufferServer::SocketBufferServer(SharedMemoryManager& shm, std::string const& address, bool use_zerocopy)
+    : shm_(shm)
+    , address_(address)
+    , use_zerocopy_(use_zerocopy)
+    , listen_fd_(-1)
+    , port_(0)
+    , running_(false)
+    , connection_count_(0)
+{
+	SocketAddress addr;
+	if (!parseAddress(address, addr))
+	{
+		return;
+	}
+
+	listen_fd_ = socket(addr.storage.ss_family, SOCK_STREAM, 0);
+	if (listen_fd_ < 0)
+	{
+		TLOG(TLVL_ERROR) << "SocketBufferServer: Error creating socket for " << address << ", errno=" << errno << " (" << strerror(errno) << ")";
+		return;
+	}
+	if (addr.is_tcp)
+	{
+		int yes = 1;
+		setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+	}
+	else
+	{
+		unlink(addr.unix_path.c_str());
+	}
+
+	if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr.storage), addr.length) < 0 || listen(listen_fd_, 16) < 0)  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	{
+		TLOG(TLVL_ERROR) << "SocketBufferServer: Error listening on " << address << ", errno=" << errno << " (" << strerror(errno) << ")";
+		close(listen_fd_);
+		listen_fd_ = -1;
+		return;
+	}
+
+	if (addr.is_tcp)
+	{
+		sockaddr_in bound{};
+		socklen_t len = sizeof(bound);
+		getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&bound), &len);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+		port_ = ntohs(bound.sin_port);
+	}
+
+	if (!shm_.IsDestructiveReadMode())
+	{
+		TLOG(TLVL_WARNING) << "SocketBufferServer: Shared memory is in broadcast (non-destructive) read mode, which is not supported; "
+		                   << "all clients share one reader, so an event read by one client is not seen by the others";
+	}
+
+	TLOG(TLVL_INFO) << "SocketBufferServer listening on " << address << (addr.is_tcp ? " (port " + std::to_string(port_) + ")" : "");
+	running_ = true;
+	accept_thread_ = std::thread(&SocketBufferServer::acceptLoop_, this, addr.is_tcp);
+}
+
+void artdaq::SocketBufferServer::acceptLoop_(bool is_tcp)
+{
+	while (running_)
+	{
+		joinFinished_();
+		pollfd pfd{listen_fd_, POLLIN, 0};
+		if (poll(&pfd, 1, 100) <= 0)
+		{
+			continue;
+		}
+		auto fd = accept(listen_fd_, nullptr, nullptr);
+		if (fd < 0)
+		{
+			continue;
+		}
+
+		bool zerocopy = false;
+		if (is_tcp)
+		{
+			int yes = 1;
+			setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+#ifdef SOCKET_BUFFER_ZEROCOPY
+			zerocopy = use_zerocopy_ && setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &yes, sizeof(yes)) == 0;
+#endif
+		}
+		TLOG(TLVL_CONNECT) << "SocketBufferServer accepted connection on fd " << fd << (zerocopy ? " (MSG_ZEROCOPY enabled)" : "");
+
+		std::lock_guard<std::mutex> lk(client_mutex_);
+		client_fds_.push_back(fd);
+		++connection_count_;
+		client_threads_.emplace_back(&SocketBufferServer::serveClient_, this, fd, zerocopy);
+	}
+}
+
+artdaq::SocketBufferServer::~SocketBufferServer()
+{
+	Stop();
+	if (address_.compare(0, 5, "unix:") == 0)
+	{
+		unlink(address_.substr(5).c_str());
+	}
+}
+
+void artdaq::SocketBufferServer::Stop()
+{
+	running_ = false;
+	if (accept_thread_.joinable())
+	{
+		accept_thread_.join();
+	}
+	if (listen_fd_ >= 0)
+	{
+		close(listen_fd_);
+		listen_fd_ = -1;
+	}
+
+	std::list<std::thread> threads;
+	{
+		std::lock_guard<std::mutex> lk(client_mutex_);
+		for (auto fd : client_fds_)
+		{
+			shutdown(fd, SHUT_RDWR);
+		}
+		threads.swap(client_threads_);
+	}
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+	std::lock_guard<std::mutex> lk(client_mutex_);
+	finished_threads_.clear();
+}
+
+void artdaq::SocketBufferServer::serveClient_(int fd, bool zerocopy)
+{
+	std::set<int> owned;
+
+	// MSG_ZEROCOPY sends are numbered by the kernel; a buffer may only be released once every send has completed
+	uint32_t zerocopy_sent = 0;
+	uint32_t zerocopy_done = 0;
+	auto drainZerocopy = [&]() {
+#ifdef SOCKET_BUFFER_ZEROCOPY
+		while (zerocopy_done < zerocopy_sent)
+		{
+			pollfd pfd{fd, 0, 0};
+			poll(&pfd, 1, 100);
+
+			msghdr msg{};
+			char control[128];
+			msg.msg_control = &control[0];
+			msg.msg_controllen = sizeof(control);
+			if (recvmsg(fd, &msg, MSG_ERRQUEUE) < 0)
+			{
+				if (errno == EAGAIN || errno == EINTR)
+				{
+					continue;
+				}
+				TLOG(TLVL_WARNING) << "SocketBufferServer: Error reading zero-copy completions, errno=" << errno << " (" << strerror(errno) << ")";
+				break;
+			}
+			for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg))
+			{
+				auto serr = reinterpret_cast<sock_extended_err*>(CMSG_DATA(cmsg));  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+				if (serr->ee_origin == SO_EE_ORIGIN_ZEROCOPY)
+				{
+					zerocopy_done += serr->ee_data - serr->ee_info + 1;
+					TLOG(TLVL_ZEROCOPY) << "SocketBufferServer: Zero-copy sends " << serr->ee_info << " through " << serr->ee_data << " complete" << ((serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0 ? " (kernel copied)" : "");
+				}
+			}
+		}
+#endif
+	};
+
+	while (running_)
+	{
+		detail::SocketBufferRequest req;
+		if (!recvAll(fd, &req, sizeof(req)))
+		{
+			break;
+		}
+		if (req.magic != detail::SocketBufferRequest::MAGIC)
+		{
+			TLOG(TLVL_ERROR) << "SocketBufferServer: Received corrupt request frame, disconnecting client";
+			break;
+		}
+		TLOG(TLVL_REQUEST) << "SocketBufferServer: Request op=" << static_cast<int>(req.op) << ", buffer=" << req.buffer << ", arg=" << req.arg << ", size=" << req.size;
+
+		auto buffer = req.buffer;
+		auto isOwned = [&]() { return buffer >= 0 && static_cast<size_t>(buffer) < shm_.size() && owned.count(buffer) != 0; };
+		detail::SocketBufferReply reply;
+		bool replied = false;
+		bool connected = true;
+		try
+		{
+			switch (req.op)
+			{
+				case detail::SocketBufferOp::Size:
+					reply.status = shm_.size();
+					reply.size = shm_.BufferSize();
+					break;
+				case detail::SocketBufferOp::ReadyForRead:
+					reply.status = shm_.ReadyForRead() ? 1 : 0;
+					break;
+				case detail::SocketBufferOp::ReadyForWrite:
+					reply.status = shm_.ReadyForWrite(req.arg != 0) ? 1 : 0;
+					break;
+				case detail::SocketBufferOp::GetBufferForReading:
+					reply.status = shm_.GetBufferForReading();
+					if (reply.status >= 0) owned.insert(reply.status);
+					break;
+				case detail::SocketBufferOp::GetBufferForWriting:
+					reply.status = shm_.GetBufferForWriting(req.arg != 0);
+					if (reply.status >= 0) owned.insert(reply.status);
+					break;
+				case detail::SocketBufferOp::BufferDataSize:
+					reply.status = buffer >= 0 && static_cast<size_t>(buffer) < shm_.size() ? static_cast<int64_t>(shm_.BufferDataSize(buffer)) : -1;
+					break;
+				case detail::SocketBufferOp::Write:
+					if (isOwned() && shm_.CheckBuffer(buffer, SharedMemoryManager::BufferSemaphoreFlags::Writing) && shm_.BufferDataSize(buffer) + req.size <= shm_.BufferSize())
+					{
+						// Receive directly into the shared memory buffer
+						connected = req.size == 0 || recvAll(fd, shm_.GetWritePos(buffer), req.size);
+						if (connected && req.size > 0)
+						{
+							shm_.IncrementWritePos(buffer, req.size);
+						}
+						reply.status = req.size;
+					}
+					else
+					{
+						TLOG(TLVL_WARNING) << "SocketBufferServer: Rejecting write of " << req.size << " bytes to buffer " << buffer;
+						connected = discardAll(fd, req.size);
+					}
+					break;
+				case detail::SocketBufferOp::Read:
+					if (isOwned() && shm_.CheckBuffer(buffer, SharedMemoryManager::BufferSemaphoreFlags::Reading) &&
+					    shm_.GetReadOffset(buffer) + req.size <= shm_.BufferDataSize(buffer))
+					{
+						// Send directly from the shared memory buffer. A chained event is not contiguous, so the data
+						// is gathered from each of its buffers, starting at the current read offset.
+						reply.status = 1;
+						reply.size = req.size;
+						int flags = 0;
+#ifdef SOCKET_BUFFER_ZEROCOPY
+						if (zerocopy && req.size >= ZEROCOPY_THRESHOLD)
+						{
+							flags = MSG_ZEROCOPY;
+						}
+#endif
+						std::vector<iovec> iov{{&reply, sizeof(reply)}};
+						auto skip = shm_.GetReadOffset(buffer);
+						auto remaining = req.size;
+						for (auto const& piece : shm_.GetGatherView(buffer))
+						{
+							if (remaining == 0)
+							{
+								break;
+							}
+							if (skip >= piece.second)
+							{
+								skip -= piece.second;
+								continue;
+							}
+							auto len = std::min(piece.second - skip, remaining);
+							iov.push_back({const_cast<uint8_t*>(piece.first) + skip, len});  // NOLINT(cppcoreguidelines-pro-type-const-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+							remaining -= len;
+							skip = 0;
+						}
+						if (flags == 0 || iov.size() == 1)
+						{
+							connected = sendIov(fd, iov.data(), iov.size(), 0);
+						}
+						else
+						{
+							// The kernel keeps referencing zero-copy pages after sendmsg returns, so the reply (which is
+							// reused for the next request) is copied in a send of its own
+							connected = sendIov(fd, iov.data(), 1, 0) && sendIov(fd, &iov[1], iov.size() - 1, flags, &zerocopy_sent);
+						}
+						replied = true;
+						if (req.size > 0)
+						{
+							shm_.IncrementReadPos(buffer, req.size);
+						}
+					}
+					break;
+				case detail::SocketBufferOp::MarkBufferFull:
+					if (isOwned())
+					{
+						drainZerocopy();
+						shm_.MarkBufferFull(buffer, req.arg);
+						owned.erase(buffer);
+						reply.status = 0;
+					}
+					break;
+				case detail::SocketBufferOp::MarkBufferEmpty:
+					if (isOwned())
+					{
+						drainZerocopy();
+						shm_.MarkBufferEmpty(buffer, req.arg != 0, false);
+						owned.erase(buffer);
+						reply.status = 0;
+					}
+					break;
+				default:
+					TLOG(TLVL_ERROR) << "SocketBufferServer: Unknown request op " << static_cast<int>(req.op);
+					break;
+			}
+		}
+		catch (cet::exception const& ex)
+		{
+			TLOG(TLVL_ERROR) << "SocketBufferServer: Exception handling request op " << static_cast<int>(req.op) << ": " << ex.what();
+			reply.status = -2;
+		}
+
+		if (connected && !replied && (req.flags & detail::SocketBufferRequest::NO_REPLY) == 0)
+		{
+			iovec iov{&reply, sizeof(reply)};
+			connected = sendIov(fd, &iov, 1, 0);
+		}
+		if (!connected)
+		{
+			break;
+		}
+	}
+
+	TLOG(TLVL_CONNECT) << "SocketBufferServer: Client on fd " << fd << " disconnected, releasing " << owned.size() << " buffers";
+	drainZerocopy();
+	for (auto buffer : owned)
+	{
+		if (shm_.CheckBuffer(buffer, SharedMemoryManager::BufferSemaphoreFlags::Writing))
+		{
+			shm_.MarkBufferEmpty(buffer, true, false);
+		}
+		else
+		{
+			// As for a local reader which goes away, the event stays available to other readers
+			TLOG(TLVL_WARNING) << "SocketBufferServer: Client disconnected while reading buffer " << buffer << ", returning it to Full";
+			shm_.MarkBufferFull(buffer);
+		}
+	}
+
+	std::lock_guard<std::mutex> lk(client_mutex_);
+	client_fds_.remove(fd);
+	close(fd);
+	--connection_count_;
+	finished_threads_.push_back(std::this_thread::get_id());
+}
+
+void artdaq::SocketBufferServer::joinFinished_()
+{
+	std::list<std::thread> finished;
+	{
+		std::lock_guard<std::mutex> lk(client_mutex_);
+		for (auto id : finished_threads_)
+		{
+			auto it = std::find_if(client_threads_.begin(), client_threads_.end(), [id](std::thread const& thread) { return thread.get_id() == id; });
+			if (it != client_threads_.end())
+			{
+				finished.splice(finished.end(), client_threads_, it);
+			}
+		}
+		finished_threads_.clear();
+	}
+	for (auto& thread : finished)
+	{
+		thread.join();
+	}
+}
+
+artdaq::SocketBufferClient::SocketBufferClient(std::string const& address, size_t timeout_us)
+    : fd_(-1)
+{
+	SocketAddress addr;
+	if (!parseAddress(address, addr))
+	{
+		return;
+	}
+
+	auto waiter = WaitPolicy::Default().MakeWaiter();
+	while (true)
+	{
+		auto fd = socket(addr.storage.ss_family, SOCK_STREAM, 0);
+		if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&addr.storage), addr.length) == 0)  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+		{
+			fd_ = fd;
+			break;
+		}
+		if (fd >= 0)
+		{
+			close(fd);
+		}
+		if (waiter.ElapsedMicroseconds() >= timeout_us)
+		{
+			TLOG(TLVL_ERROR) << "SocketBufferClient: Could not connect to " << address << ", errno=" << errno << " (" << strerror(errno) << ")";
+			return;
+		}
+		waiter.Wait();
+	}
+
+	if (addr.is_tcp)
+	{
+		int yes = 1;
+		setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+	}
+	TLOG(TLVL_CONNECT) << "SocketBufferClient connected to " << address;
+}
+
+artdaq::SocketBufferClient::~SocketBufferClient()
+{
+	Flush();
+	if (fd_ >= 0)
+	{
+		close(fd_);
+	}
+}
+
+size_t artdaq::SocketBufferClient::size()
+{
+	detail::SocketBufferRequest req;
+	req.op = detail::SocketBufferOp::Size;
+	auto sts = transact_(req);
+	return sts > 0 ? sts : 0;
+}
+
+size_t artdaq::SocketBufferClient::BufferSize()
+{
+	detail::SocketBufferRequest req;
+	req.op = detail::SocketBufferOp::Size;
+	uint64_t buffer_size = 0;
+	auto sts = transact_(req, nullptr, nullptr, &buffer_size);
+	return sts >= 0 ? buffer_size : 0;
+}
+
+bool artdaq::SocketBufferClient::ReadyForRead()
+{
+	detail::SocketBufferRequest req;
+	req.op = detail::SocketBufferOp::ReadyForRead;
+	return transact_(req) > 0;
+}
+
+bool artdaq::SocketBufferClient::ReadyForWrite(bool overwrite)
+{
+	detail::SocketBufferRequest req;
+	req.op = detail::SocketBufferOp::ReadyForWrite;
+	req.arg = overwrite ? 1 : 0;
+	return transact_(req) > 0;
+}
+
+int artdaq::SocketBufferClient::GetBufferForReading()
+{
+	detail::SocketBufferRequest req;
+	req.op = detail::SocketBufferOp::GetBufferForReading;
+	return transact_(req);
+}
+
+int artdaq::SocketBufferClient::GetBufferForWriting(bool overwrite)
+{
+	detail::SocketBufferRequest req;
+	req.op = detail::SocketBufferOp::GetBufferForWriting;
+	req.arg = overwrite ? 1 : 0;
+	return transact_(req);
+}
+
+size_t artdaq::SocketBufferClient::BufferDataSize(int buffer)
+{
+	detail::SocketBufferRequest req;
+	req.op = detail::SocketBufferOp::BufferDataSize;
+	req.buffer = buffer;
+	auto sts = transact_(req);
+	return sts > 0 ? sts : 0;
+}
+
+size_t artdaq::SocketBufferClient::Write(int buffer, void* data, size_t size)
+{
+	detail::SocketBufferRequest req;
+	req.op = detail::SocketBufferOp::Write;
+	req.buffer = buffer;
+	req.size = size;
+	auto sts = transact_(req, data);
+	return sts > 0 ? sts : 0;
+}
+
+bool artdaq::SocketBufferClient::Read(int buffer, void* data, size_t size)
+{
+	detail::SocketBufferRequest req;
+	req.op = detail::SocketBufferOp::Read;
+	req.buffer = buffer;
+	req.size = size;
+	return transact_(req, nullptr, data) > 0;
+}
+
+void artdaq::SocketBufferClient::MarkBufferFull(int buffer, int destination)
+{
+	detail::SocketBufferRequest req;
+	req.op = detail::SocketBufferOp::MarkBufferFull;
+	req.flags = detail::SocketBufferRequest::NO_REPLY;
+	req.buffer = buffer;
+	req.arg = destination;
+
+	std::unique_lock<std::mutex> lk(mutex_);
+	pending_.push_back(req);
+	if (pending_.size() >= MAX_PENDING_RELEASES)
+	{
+		lk.unlock();
+		Flush();
+	}
+}
+
+void artdaq::SocketBufferClient::MarkBufferEmpty(int buffer, bool force)
+{
+	detail::SocketBufferRequest req;
+	req.op = detail::SocketBufferOp::MarkBufferEmpty;
+	req.flags = detail::SocketBufferRequest::NO_REPLY;
+	req.buffer = buffer;
+	req.arg = force ? 1 : 0;
+
+	std::unique_lock<std::mutex> lk(mutex_);
+	pending_.push_back(req);
+	if (pending_.size() >= MAX_PENDING_RELEASES)
+	{
+		lk.unlock();
+		Flush();
+	}
+}
+
+bool artdaq::SocketBufferClient::Flush()
+{
+	std::lock_guard<std::mutex> lk(mutex_);
+	if (fd_ < 0)
+	{
+		return false;
+	}
+	if (pending_.empty())
+	{
+		return true;
+	}
+
+	std::vector<iovec> iov;
+	for (auto& pending : pending_)
+	{
+		iov.push_back({&pending, sizeof(pending)});
+	}
+	if (!sendIov(fd_, iov.data(), iov.size(), 0))
+	{
+		disconnect_("Error sending batched releases");
+		return false;
+	}
+	pending_.clear();
+	return true;
+}
+
+int64_t artdaq::SocketBufferClient::transact_(detail::SocketBufferRequest request, void const* payload, void* reply_data, uint64_t* reply_size)
+{
+	std::lock_guard<std::mutex> lk(mutex_);
+	if (fd_ < 0)
+	{
+		return -1;
+	}
+
+	// Batched releases go out in the same sendmsg as this request
+	std::vector<iovec> iov;
+	for (auto& pending : pending_)
+	{
+		iov.push_back({&pending, sizeof(pending)});
+	}
+	iov.push_back({&request, sizeof(request)});
+	if (payload != nullptr && request.size > 0)
+	{
+		iov.push_back({const_cast<void*>(payload), request.size});  // NOLINT(cppcoreguidelines-pro-type-const-cast)
+	}
+	if (!sendIov(fd_, iov.data(), iov.size(), 0))
+	{
+		disconnect_("Error sending request");
+		return -1;
+	}
+	pending_.clear();
+
+	detail::SocketBufferReply reply;
+	if (!recvAll(fd_, &reply, sizeof(reply)))
+	{
+		disconnect_("Error receiving reply");
+		return -1;
+	}
+	if (reply_size != nullptr)
+	{
+		*reply_size = reply.size;
+	}
+	if (request.op == detail::SocketBufferOp::Read && reply.status > 0 && reply.size > 0)
+	{
+		if (reply.size > request.size || reply_data == nullptr)
+		{
+			disconnect_("Server sent more data than requested");
+			return -1;
+		}
+		if (!recvAll(fd_, reply_data, reply.size))
+		{
+			disconnect_("Error receiving data");
+			return -1;
+		}
+	}
+	return reply.status;
+}
+
+void artdaq::SocketBufferClient::disconnect_(std::string const& reason)
+{
+	TLOG(TLVL_ERROR) << "SocketBufferClient: " << reason << ", errno=" << errno << " (" << strerror(errno) << "). Disconnecting.";
+	close(fd_);
+	fd_ = -1;
+	pending_.clear();
+}
@@ -0,0 +1,260 @@
+#ifndef artdaq_core_Core_SocketBufferTransport_hh
+#define artdaq_core_Core_SocketBufferTransport_hh 1
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "artdaq-core/Core/SharedMemoryManager.hh"
+
+namespace artdaq {
+namespace detail {
+/**
+ * \brief Operations which a SocketBufferClient may request from a SocketBufferServer
+ */
+enum class SocketBufferOp : uint16_t
+{
+	Size,
+	ReadyForRead,
+	ReadyForWrite,
+	GetBufferForReading,
+	GetBufferForWriting,
+	BufferDataSize,
+	Write,
+	Read,
+	MarkBufferFull,
+	MarkBufferEmpty,
+};
+
+/**
+ * \brief Request frame sent from SocketBufferClient to SocketBufferServer. For Write, size bytes of data follow.
+ */
+struct SocketBufferRequest
+{
+	static constexpr uint32_t MAGIC = 0x5348534B;  ///< "SHSK"
+	static constexpr uint16_t NO_REPLY = 0x1;      ///< The client does not wait for a reply (used for batched releases)
+
+	uint32_t magic{MAGIC};                          ///< Frame marker, to detect a corrupted stream
+	SocketBufferOp op{SocketBufferOp::Size};        ///< Requested operation
+	uint16_t flags{0};                              ///< Request flags (NO_REPLY)
+	int32_t buffer{-1};                             ///< Buffer ID the operation applies to
+	int32_t arg{0};                                 ///< Operation argument (overwrite flag, destination, force flag)
+	uint64_t size{0};                               ///< Number of bytes to Write or Read
+};
+
+/**
+ * \brief Reply frame sent from SocketBufferServer to SocketBufferClient. For Read, size bytes of data follow.
+ */
+struct SocketBufferReply
+{
+	int64_t status{-1};  ///< Return value of the operation. Negative values indicate errors.
+	uint64_t size{0};    ///< Number of bytes following the reply (or the buffer size, for Size)
+};
+}  // namespace detail
+
+/**
+ * \brief Serves the buffers of a SharedMemoryManager to SocketBufferClient instances over a Unix-domain or TCP socket
+ *
+ * Addresses are of the form "unix:/path/to/socket" or "tcp:host:port". Each connection is served by its own thread,
+ * which acts on the wrapped SharedMemoryManager on behalf of the client. Read data is sent with sendmsg directly from
+ * the shared memory buffer, and written data is received directly into it. For TCP connections, MSG_ZEROCOPY may be
+ * enabled; buffers are then only released once the kernel has reported that it no longer references them.
+ *
+ * All clients act through the one wrapped SharedMemoryManager, so they share its manager ID and read position. Only
+ * destructive read mode is supported: in broadcast mode, an event read by one client would be skipped by the others.
+ * A buffer which a client was reading when it disconnected is marked Full again, as for a local reader which detaches.
+ */
+class SocketBufferServer
+{
+public:
+	/**
+	 * \brief SocketBufferServer Constructor. Starts listening immediately.
+	 * \param shm SharedMemoryManager whose buffers are served. Must outlive the server.
+	 * \param address Address to listen on ("unix:/path" or "tcp:host:port". A TCP port of 0 picks a free port, see GetPort.)
+	 * \param use_zerocopy Whether to send Read data with MSG_ZEROCOPY (TCP only, ignored where unsupported)
+	 */
+	SocketBufferServer(SharedMemoryManager& shm, std::string const& address, bool use_zerocopy = false);
+
+	/**
+	 * \brief SocketBufferServer Destructor. Disconnects all clients, releasing any buffers they held.
+	 */
+	virtual ~SocketBufferServer();
+
+	SocketBufferServer(SocketBufferServer const&) = delete;             ///< Copy Constructor is deleted
+	SocketBufferServer(SocketBufferServer&&) = delete;                  ///< Move Constructor is deleted
+	SocketBufferServer& operator=(SocketBufferServer const&) = delete;  ///< Copy Assignment Operator is deleted
+	SocketBufferServer& operator=(SocketBufferServer&&) = delete;       ///< Move Assignment Operator is deleted
+
+	/**
+	 * \brief Whether the server is listening for connections
+	 * \return True if the listening socket was opened successfully and Stop has not been called
+	 */
+	bool IsRunning() const { return running_; }
+
+	/**
+	 * \brief Get the TCP port the server is listening on (useful when listening on port 0)
+	 * \return TCP port number, or 0 for Unix-domain sockets
+	 */
+	uint16_t GetPort() const { return port_; }
+
+	/**
+	 * \brief Get the number of currently-connected clients
+	 * \return Number of connected clients
+	 */
+	size_t GetConnectionCount() const { return connection_count_; }
+
+	/**
+	 * \brief Stop listening and disconnect all clients
+	 */
+	void Stop();
+
+private:
+	void acceptLoop_(bool is_tcp);
+	void serveClient_(int fd, bool zerocopy);
+	void joinFinished_();
+
+	SharedMemoryManager& shm_;
+	std::string address_;
+	bool use_zerocopy_;
+	int listen_fd_;
+	uint16_t port_;
+	std::atomic<bool> running_;
+	std::atomic<size_t> connection_count_;
+	std::thread accept_thread_;
+	std::mutex client_mutex_;
+	std::list<std::thread> client_threads_;
+	std::list<std::thread::id> finished_threads_;  ///< Client threads which have returned, to be joined by the accept thread
+	std::list<int> client_fds_;
+};
+
+/**
+ * \brief Accesses the buffers of a remote SharedMemoryManager through a SocketBufferServer
+ *
+ * The buffer methods have the same names and semantics as those of SharedMemoryManager, so consumer code written
+ * against either (e.g. as a template parameter) works locally over shared memory or remotely over a socket.
+ * MarkBufferFull and MarkBufferEmpty do not wait for a reply; they are batched with the next request (or Flush).
+ */
+class SocketBufferClient
+{
+public:
+	/**
+	 * \brief SocketBufferClient Constructor. Connects to the server.
+	 * \param address Address of the SocketBufferServer ("unix:/path" or "tcp:host:port")
+	 * \param timeout_us How long to keep retrying the connection, in microseconds
+	 */
+	explicit SocketBufferClient(std::string const& address, size_t timeout_us = 1000000);
+
+	/**
+	 * \brief SocketBufferClient Destructor. Sends any batched releases, then disconnects.
+	 */
+	virtual ~SocketBufferClient();
+
+	SocketBufferClient(SocketBufferClient const&) = delete;             ///< Copy Constructor is deleted
+	SocketBufferClient(SocketBufferClient&&) = delete;                  ///< Move Constructor is deleted
+	SocketBufferClient& operator=(SocketBufferClient const&) = delete;  ///< Copy Assignment Operator is deleted
+	SocketBufferClient& operator=(SocketBufferClient&&) = delete;       ///< Move Assignment Operator is deleted
+
+	/**
+	 * \brief Is the connection to the server valid?
+	 * \return Whether the connection to the server is valid
+	 */
+	bool IsValid() const { return fd_ >= 0; }
+
+	/**
+	 * \brief Get the number of buffers in the remote shared memory
+	 * \return The number of buffers in the remote shared memory
+	 */
+	size_t size();
+
+	/**
+	 * \brief Get the size of a single buffer in the remote shared memory
+	 * \return The size of a single buffer, in bytes
+	 */
+	size_t BufferSize();
+
+	/**
+	 * \brief Whether any buffer is ready for read
+	 * \return True if there is a buffer available
+	 */
+	bool ReadyForRead();
+
+	/**
+	 * \brief Whether any buffer is available for write
+	 * \param overwrite Allow writes to buffers which are in the Full and Reading state
+	 * \return True if there is a buffer available
+	 */
+	bool ReadyForWrite(bool overwrite);
+
+	/**
+	 * \brief Finds a buffer that is ready to be read, and reserves it for this client
+	 * \return The id number of the buffer. -1 indicates no buffers available for read.
+	 */
+	int GetBufferForReading();
+
+	/**
+	 * \brief Finds a buffer that is ready to be written to, and reserves it for this client
+	 * \param overwrite Whether to consider buffers that are in the Full and Reading state as ready for write
+	 * \return The id number of the buffer. -1 indicates no buffers available for write.
+	 */
+	int GetBufferForWriting(bool overwrite);
+
+	/**
+	 * \brief Get the current size of the buffer's data
+	 * \param buffer Buffer ID of buffer
+	 * \return Current size of data in the buffer, in bytes
+	 */
+	size_t BufferDataSize(int buffer);
+
+	/**
+	 * \brief Write size bytes of data from the given pointer to a buffer
+	 * \param buffer Buffer ID of buffer
+	 * \param data Source pointer for data write
+	 * \param size Size of write, in bytes
+	 * \return Amount of data written (0 on error)
+	 */
+	size_t Write(int buffer, void* data, size_t size);
+
+	/**
+	 * \brief Read size bytes of data from buffer into the given pointer
+	 * \param buffer Buffer ID of buffer
+	 * \param data Destination pointer for data read
+	 * \param size Size of read, in bytes
+	 * \return Whether the read was successful
+	 */
+	bool Read(int buffer, void* data, size_t size);
+
+	/**
+	 * \brief Release a buffer from a writer, marking it Full and ready for a reader (batched with the next request)
+	 * \param buffer Buffer ID of buffer
+	 * \param destination If desired, a destination manager ID may be specified for a buffer
+	 */
+	void MarkBufferFull(int buffer, int destination = -1);
+
+	/**
+	 * \brief Release a buffer from a reader, marking it Empty and ready to accept more data (batched with the next request)
+	 * \param buffer Buffer ID of buffer
+	 * \param force Force buffer to empty state
+	 */
+	void MarkBufferEmpty(int buffer, bool force = false);
+
+	/**
+	 * \brief Send any batched releases to the server now
+	 * \return Whether the releases were sent successfully
+	 */
+	bool Flush();
+
+private:
+	int64_t transact_(detail::SocketBufferRequest request, void const* payload = nullptr, void* reply_data = nullptr, uint64_t* reply_size = nullptr);
+	void disconnect_(std::string const& reason);
+
+	int fd_;
+	std::mutex mutex_;
+	std::vector<detail::SocketBufferRequest> pending_;
+};
+}  // namespace artdaq
+
+#endif  // artdaq_core_Core_SocketBufferTransport_hh
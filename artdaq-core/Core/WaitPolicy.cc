@@ -0,0 +1,58 @@
+#include "artdaq-core/Core/WaitPolicy.hh"
+
+#include <sched.h>
+#include <unistd.h>
+#include <algorithm>
+
+#include "artdaq-core/Utilities/TimeUtils.hh"
+
+artdaq::WaitPolicy::WaitPolicy(uint64_t spin_us, uint64_t yield_us, uint64_t min_sleep_us, uint64_t max_sleep_us)
+    : spin_us_(spin_us)
+    , yield_us_(yield_us)
+    , min_sleep_us_(min_sleep_us > 0 ? min_sleep_us : 1)
+    , max_sleep_us_(std::max(max_sleep_us, min_sleep_us_))
+{
+}
+
+artdaq::WaitPolicy::Waiter::Waiter(WaitPolicy const& policy)
+    : spin_us_(policy.spin_us_)
+    , yield_us_(policy.yield_us_)
+    , max_sleep_us_(policy.max_sleep_us_)
+    , start_(std::chrono::steady_clock::now())
+    , next_sleep_us_(policy.min_sleep_us_)
+    , sleeping_(policy.spin_us_ + policy.yield_us_ == 0)
+{
+}
+
+void artdaq::WaitPolicy::Waiter::Wait()
+{
+	auto elapsed = ElapsedMicroseconds();
+	if (elapsed < spin_us_)
+	{
+#if defined(__x86_64__) || defined(__i386__)
+		__builtin_ia32_pause();
+#elif defined(__aarch64__)
+		asm volatile("yield");
+#endif
+		return;
+	}
+	if (elapsed < spin_us_ + yield_us_)
+	{
+		sched_yield();
+		return;
+	}
+	if (!sleeping_)
+	{
+		// The busy phases may have ended just after the caller checked Spinning(); let it re-check its condition before sleeping
+		sleeping_ = true;
+		return;
+	}
+
+	usleep(next_sleep_us_);
+	next_sleep_us_ = std::min(next_sleep_us_ * 2, max_sleep_us_);
+}
+
+uint64_t artdaq::WaitPolicy::Waiter::ElapsedMicroseconds() const
+{
+	return TimeUtils::GetElapsedTimeMicroseconds(start_);
+}
@@ -0,0 +1,120 @@
+#ifndef artdaq_core_Core_WaitPolicy_hh
+#define artdaq_core_Core_WaitPolicy_hh 1
+
+#include <chrono>
+#include <cstdint>
+
+namespace artdaq {
+/**
+ * \brief Describes how a loop waiting on shared memory spends its time: spin, then yield, then sleep with exponential backoff
+ *
+ * Latency-critical clients can spin for a long time before giving up the CPU, while idle monitoring
+ * clients can go straight to long sleeps.
+ */
+class WaitPolicy
+{
+public:
+	/**
+	 * \brief WaitPolicy Constructor
+	 * \param spin_us Time to busy-wait before yielding, in microseconds
+	 * \param yield_us Time to call sched_yield between checks (after spinning), in microseconds
+	 * \param min_sleep_us First sleep time once spinning and yielding are done, in microseconds
+	 * \param max_sleep_us Maximum sleep time. Each sleep doubles the next, up to this value.
+	 */
+	WaitPolicy(uint64_t spin_us, uint64_t yield_us, uint64_t min_sleep_us, uint64_t max_sleep_us);
+
+	/**
+	 * \brief Spin for 1 ms, then sleep 1 ms between checks
+	 * \return WaitPolicy suitable for most clients
+	 */
+	static WaitPolicy Default() { return WaitPolicy(1000, 0, 1000, 1000); }
+
+	/**
+	 * \brief Spin for 5 ms, then yield for 50 ms, then sleep from 10 us up to 1 ms
+	 * \return WaitPolicy for latency-critical clients (e.g. event builders)
+	 */
+	static WaitPolicy LowLatency() { return WaitPolicy(5000, 50000, 10, 1000); }
+
+	/**
+	 * \brief Sleep from 10 ms up to 5 s between checks, without spinning
+	 * \return WaitPolicy for clients that are mostly idle (e.g. online monitoring)
+	 */
+	static WaitPolicy Idle() { return WaitPolicy(0, 0, 10000, 5000000); }
+
+	/**
+	 * \brief Get the time spent spinning before yielding
+	 * \return Spin time, in microseconds
+	 */
+	uint64_t SpinMicroseconds() const { return spin_us_; }
+
+	/**
+	 * \brief Get the time spent yielding before sleeping
+	 * \return Yield time, in microseconds
+	 */
+	uint64_t YieldMicroseconds() const { return yield_us_; }
+
+	/**
+	 * \brief Get the first sleep time
+	 * \return Minimum sleep time, in microseconds
+	 */
+	uint64_t MinSleepMicroseconds() const { return min_sleep_us_; }
+
+	/**
+	 * \brief Get the maximum sleep time
+	 * \return Maximum sleep time, in microseconds
+	 */
+	uint64_t MaxSleepMicroseconds() const { return max_sleep_us_; }
+
+	/**
+	 * \brief Tracks the progress of a single wait through the phases of a WaitPolicy
+	 */
+	class Waiter
+	{
+	public:
+		/**
+		 * \brief Start a wait
+		 * \param policy WaitPolicy to follow. The Waiter copies its parameters.
+		 */
+		explicit Waiter(WaitPolicy const& policy);
+
+		/**
+		 * \brief Wait once: spin, yield, or sleep, depending on how long this wait has been going on
+		 */
+		void Wait();
+
+		/**
+		 * \brief Get the time since the wait started
+		 * \return Elapsed time, in microseconds
+		 */
+		uint64_t ElapsedMicroseconds() const;
+
+		/**
+		 * \brief Determine whether the wait is still in its spinning phase
+		 * \return Whether Wait() would busy-wait
+		 */
+		bool Spinning() const { return ElapsedMicroseconds() < spin_us_; }
+
+	private:
+		uint64_t spin_us_;
+		uint64_t yield_us_;
+		uint64_t max_sleep_us_;
+		std::chrono::steady_clock::time_point start_;
+		uint64_t next_sleep_us_;
+		bool sleeping_;
+	};
+
+	/**
+	 * \brief Start a wait following this policy
+	 * \return Waiter for the new wait
+	 */
+	Waiter MakeWaiter() const { return Waiter(*this); }
+
+private:
+	uint64_t spin_us_;
+	uint64_t yield_us_;
+	uint64_t min_sleep_us_;
+	uint64_t max_sleep_us_;
+};
+}  // namespace artdaq
+
+#endif  // artdaq_core_Core_WaitPolicy_hh
@@ -0,0 +1,190 @@
+#ifndef artdaq_core_Data_EventTOC_hh
+#define artdaq_core_Data_EventTOC_hh
+
+#include <cstring>
+#include <vector>
+
+#include "artdaq-core/Data/Fragment.hh"
+#include "artdaq-core/Data/FragmentView.hh"
+#include "artdaq-core/Data/RawEvent.hh"
+#include "cetlib_except/exception.h"
+
+// Implementation of "EventTOC", the optional table of contents of an event in shared memory
+
+namespace artdaq {
+class EventTOC;
+}
+
+/**
+ * \brief The artdaq::EventTOC class describes the table of contents Fragment of an event
+ *
+ * A writer may put an EventTOCFragmentType Fragment directly after the RawEventHeader of an event. Its payload
+ * lists the offset, size, type and Fragment ID of every other Fragment in the event, so that readers can find a
+ * Fragment without walking the headers of the ones before it. Since the table of contents is itself a Fragment
+ * (of a system type), readers which do not know about it still see a well-formed event, and events without
+ * one stay readable.
+ */
+class artdaq::EventTOC
+{
+public:
+	/// The current version of the EventTOC layout
+	static constexpr uint8_t CURRENT_VERSION = 1;
+
+	/**
+	 * \brief First word of the EventTOC payload
+	 */
+	struct Header
+	{
+		uint32_t entry_count;  ///< Number of Entry records following the Header
+		uint8_t version;       ///< Version of the EventTOC layout
+		uint8_t unused1;       ///< Unused
+		uint16_t unused2;      ///< Unused
+	};
+	static_assert(sizeof(Header) == sizeof(RawDataType), "EventTOC::Header size changed");
+
+	/**
+	 * \brief Location and identity of one Fragment in the event
+	 */
+	struct Entry
+	{
+		uint64_t offset;       ///< Offset of the Fragment header from the start of the event (the RawEventHeader), in bytes
+		uint32_t word_count;   ///< Size of the Fragment, in RawDataType words
+		uint16_t fragment_id;  ///< Fragment ID of the Fragment
+		uint8_t type;          ///< Type of the Fragment
+		uint8_t unused;        ///< Unused
+	};
+	static_assert(sizeof(Entry) == 2 * sizeof(RawDataType), "EventTOC::Entry size changed");
+
+	/**
+	 * \brief Create an EventTOC overlay of a table of contents Fragment
+	 * \param frag View of the EventTOCFragmentType Fragment. Must stay valid for the lifetime of the EventTOC.
+	 * \exception cet::exception if the Fragment is not a well-formed table of contents
+	 */
+	explicit EventTOC(FragmentView const& frag);
+
+	/**
+	 * \brief Get the number of Fragments listed in the table of contents
+	 * \return The number of Entry records
+	 */
+	size_t size() const { return header_()->entry_count; }
+
+	/**
+	 * \brief Get an Entry of the table of contents
+	 * \param index Index of the Entry, in the order the Fragments appear in the event
+	 * \return Reference to the Entry
+	 */
+	Entry const& operator[](size_t index) const { return begin()[index]; }  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+	/**
+	 * \brief Get a pointer to the first Entry
+	 * \return Pointer to the first Entry
+	 */
+	Entry const* begin() const { return reinterpret_cast<Entry const*>(frag_.dataBegin() + 1); }  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+	/**
+	 * \brief Get a pointer past the last Entry
+	 * \return Pointer past the last Entry
+	 */
+	Entry const* end() const { return begin() + size(); }  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+	/**
+	 * \brief Get the size of a table of contents Fragment listing the given number of Fragments
+	 * \param count Number of Fragments in the event (not counting the table of contents)
+	 * \return Size of the table of contents Fragment, in RawDataType words
+	 */
+	static size_t SizeWords(size_t count)
+	{
+		return detail::RawFragmentHeader::num_words() + (sizeof(Header) + count * sizeof(Entry)) / sizeof(RawDataType);
+	}
+
+	/**
+	 * \brief Build the table of contents for an event
+	 * \param sequence_id Sequence ID of the event
+	 * \param frags Fragments of the event, in the order they will be written after the table of contents
+	 * \return EventTOCFragmentType Fragment, to be written directly after the RawEventHeader
+	 */
+	static Fragment Make(Fragment::sequence_id_t sequence_id, std::vector<FragmentView> const& frags);
+
+	/**
+	 * \brief Build the table of contents for an event
+	 * \param sequence_id Sequence ID of the event
+	 * \param frags Fragments of the event, in the order they will be written after the table of contents
+	 * \return EventTOCFragmentType Fragment, to be written directly after the RawEventHeader
+	 */
+	static Fragment Make(Fragment::sequence_id_t sequence_id, Fragments const& frags)
+	{
+		std::vector<FragmentView> views;
+		views.reserve(frags.size());
+		for (auto const& frag : frags)
+		{
+			views.emplace_back(frag);
+		}
+		return Make(sequence_id, views);
+	}
+
+	/**
+	 * \brief Build the table of contents for an event
+	 * \param sequence_id Sequence ID of the event
+	 * \param frags Fragments of the event, in the order they will be written after the table of contents
+	 * \return EventTOCFragmentType Fragment, to be written directly after the RawEventHeader
+	 */
+	static Fragment Make(Fragment::sequence_id_t sequence_id, FragmentPtrs const& frags)
+	{
+		std::vector<FragmentView> views;
+		for (auto const& frag : frags)
+		{
+			views.emplace_back(*frag);
+		}
+		return Make(sequence_id, views);
+	}
+
+private:
+	Header const* header_() const { return reinterpret_cast<Header const*>(frag_.dataBegin()); }  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+
+	FragmentView frag_;
+};
+
+inline artdaq::EventTOC::EventTOC(FragmentView const& frag)
+    : frag_(frag)
+{
+	if (frag_.type() != Fragment::EventTOCFragmentType)
+	{
+		throw cet::exception("EventTOC") << "Fragment of type " << frag_.typeString() << " is not an EventTOC";  // NOLINT(cert-err60-cpp)
+	}
+	if (frag_.dataSize() < 1 || header_()->version != CURRENT_VERSION)
+	{
+		throw cet::exception("EventTOC") << "EventTOC Fragment has no header or an unknown version";  // NOLINT(cert-err60-cpp)
+	}
+	if (frag_.dataSizeBytes() < sizeof(Header) + size() * sizeof(Entry))
+	{
+		throw cet::exception("EventTOC") << "EventTOC Fragment is too small for its " << size() << " entries";  // NOLINT(cert-err60-cpp)
+	}
+}
+
+inline artdaq::Fragment artdaq::EventTOC::Make(Fragment::sequence_id_t sequence_id, std::vector<FragmentView> const& frags)
+{
+	Fragment toc(SizeWords(frags.size()) - detail::RawFragmentHeader::num_words());
+	toc.setSequenceID(sequence_id);
+	toc.setSystemType(Fragment::EventTOCFragmentType);
+
+	Header header{};
+	header.entry_count = frags.size();
+	header.version = CURRENT_VERSION;
+	memcpy(toc.dataBeginBytes(), &header, sizeof(header));
+
+	auto entry = reinterpret_cast<Entry*>(toc.dataBeginBytes() + sizeof(header));  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	uint64_t offset = sizeof(detail::RawEventHeader) + toc.sizeBytes();
+	for (auto const& frag : frags)
+	{
+		*entry = Entry{};
+		entry->offset = offset;
+		entry->word_count = frag.size();
+		entry->fragment_id = frag.fragmentID();
+		entry->type = frag.type();
+		offset += frag.sizeBytes();
+		++entry;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	}
+	return toc;
+}
+
+#endif /* artdaq_core_Data_EventTOC_hh */
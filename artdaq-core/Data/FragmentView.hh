@@ -0,0 +1,245 @@
+#ifndef artdaq_core_Data_FragmentView_hh
+#define artdaq_core_Data_FragmentView_hh
+
+#include <cstring>
+#include <string>
+
+#include "artdaq-core/Data/Fragment.hh"
+#include "cetlib_except/exception.h"
+
+namespace artdaq {
+class FragmentView;
+
+/**
+ * \brief A std::vector of FragmentView objects
+ */
+typedef std::vector<FragmentView> FragmentViews;
+}  // namespace artdaq
+
+/**
+ * \brief A read-only view of a Fragment that lives in memory owned by someone else
+ *
+ * A FragmentView points at the serialized form of a Fragment (RawFragmentHeader, metadata and payload)
+ * without copying it, and provides the same const accessors as Fragment. It is only valid for as long as
+ * the memory it points to; for views returned by SharedMemoryEventReceiver::GetFragmentViewsByType, that is
+ * until the buffer is released. Use materialize() to get a Fragment which owns a copy of the data.
+ */
+class artdaq::FragmentView
+{
+public:
+	typedef Fragment::byte_t byte_t;                ///< typedef for byte_t from Fragment
+	typedef Fragment::version_t version_t;          ///< typedef for version_t from Fragment
+	typedef Fragment::type_t type_t;                ///< typedef for type_t from Fragment
+	typedef Fragment::sequence_id_t sequence_id_t;  ///< typedef for sequence_id_t from Fragment
+	typedef Fragment::fragment_id_t fragment_id_t;  ///< typedef for fragment_id_t from Fragment
+	typedef Fragment::timestamp_t timestamp_t;      ///< typedef for timestamp_t from Fragment
+
+	/**
+	 * \brief Create a FragmentView of the serialized Fragment at the given address
+	 * \param begin Pointer to the Fragment's RawFragmentHeader. Must stay valid for the lifetime of the view.
+	 * \exception cet::exception if the header has an unknown version
+	 *
+	 * Older header versions are upgraded into a copy of the header held by the view, as Fragment::fragmentHeader does.
+	 */
+	explicit FragmentView(RawDataType const* begin);
+
+	/**
+	 * \brief Create a FragmentView of an existing Fragment
+	 * \param frag Fragment to view. Must not be modified or destroyed while the view is in use.
+	 */
+	explicit FragmentView(Fragment const& frag)
+	    : FragmentView(&*frag.headerBegin()) {}
+
+	/**
+	 * \brief Gets the size of the Fragment, from the Fragment header
+	 * \return Number of words in the Fragment. Includes header, metadata, and payload
+	 */
+	std::size_t size() const { return hdr_.word_count; }
+
+	/**
+	 * \brief Version of the Fragment, from the Fragment header
+	 * \return Version of the Fragment, as stored in memory (before any upgrade)
+	 */
+	version_t version() const { return reinterpret_cast<detail::RawFragmentHeader const*>(begin_)->version; }  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+
+	/**
+	 * \brief Type of the Fragment, from the Fragment header
+	 * \return Type of the Fragment
+	 */
+	type_t type() const { return static_cast<type_t>(hdr_.type); }
+
+	/**
+	 * \brief Print the type of the Fragment
+	 * \return String representation of the Fragment type. For system types, the name will be included in parentheses
+	 */
+	std::string typeString() const
+	{
+		return std::to_string(type()) + (Fragment::isSystemFragmentType(type()) ? " (" + detail::RawFragmentHeader::SystemTypeToString(type()) + ")" : "");
+	}
+
+	/**
+	 * \brief Sequence ID of the Fragment, from the Fragment header
+	 * \return Sequence ID of the Fragment
+	 */
+	sequence_id_t sequenceID() const { return hdr_.sequence_id; }
+
+	/**
+	 * \brief Fragment ID of the Fragment, from the Fragment header
+	 * \return Fragment ID of the Fragment
+	 */
+	fragment_id_t fragmentID() const { return hdr_.fragment_id; }
+
+	/**
+	 * \brief Timestamp of the Fragment, from the Fragment header
+	 * \return Timestamp of the Fragment
+	 */
+	timestamp_t timestamp() const { return hdr_.timestamp; }
+
+	/**
+	 * \brief Get the last access time of the Fragment, from the Fragment header
+	 * \return struct timespec with last access time of the Fragment
+	 */
+	struct timespec atime() const { return hdr_.atime(); }
+
+	/**
+	 * \brief Size of the Fragment in bytes
+	 * \return The size of the Fragment in bytes, including header, metadata, and payload
+	 */
+	std::size_t sizeBytes() const { return sizeof(RawDataType) * size(); }
+
+	/**
+	 * \brief Return the number of RawDataType words in the data payload
+	 * \return Number of RawDataType words in the payload section of the Fragment
+	 */
+	std::size_t dataSize() const { return size() - header_words_ - hdr_.metadata_word_count; }
+
+	/**
+	 * \brief Return the number of bytes in the data payload
+	 * \return Number of bytes in the payload section of the Fragment
+	 */
+	std::size_t dataSizeBytes() const { return sizeof(RawDataType) * dataSize(); }
+
+	/**
+	 * \brief Test whether this Fragment has metadata
+	 * \return If a metadata object has been set
+	 */
+	bool hasMetadata() const { return hdr_.metadata_word_count != 0; }
+
+	/**
+	 * \brief Return a const pointer to the metadata. This throws an exception
+	 * if the Fragment contains no metadata.
+	 * \tparam T Type of the metadata
+	 * \return const Pointer to the metadata
+	 * \exception cet::exception if no metadata is present
+	 */
+	template<class T>
+	T const* metadata() const
+	{
+		if (!hasMetadata())
+		{
+			throw cet::exception("InvalidRequest")  // NOLINT(cert-err60-cpp)
+			    << "No metadata has been stored in this Fragment.";
+		}
+		return reinterpret_cast<T const*>(begin_ + header_words_);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	}
+
+	/**
+	 * \brief Returns a pointer to the beginning of the data payload
+	 * \return A pointer to the beginning of the data payload
+	 */
+	RawDataType const* dataBegin() const { return begin_ + header_words_ + hdr_.metadata_word_count; }  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+	/**
+	 * \brief Returns a pointer to the end of the data payload
+	 * \return A pointer to the end of the data payload
+	 */
+	RawDataType const* dataEnd() const { return begin_ + size(); }  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+	/**
+	 * \brief Return const byte_t* pointing at the beginning of the payload
+	 * \return const byte_t pointer to beginning of data payload
+	 */
+	byte_t const* dataBeginBytes() const { return reinterpret_cast<byte_t const*>(dataBegin()); }  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+
+	/**
+	 * \brief Return const byte_t* pointing at the end of the payload
+	 * \return const byte_t pointer to end of data payload
+	 */
+	byte_t const* dataEndBytes() const { return reinterpret_cast<byte_t const*>(dataEnd()); }  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+
+	/**
+	 * \brief Return a pointer to the beginning of the header, as stored in memory
+	 * \return A pointer to the beginning of the header
+	 */
+	RawDataType const* headerBegin() const { return begin_; }
+
+	/**
+	 * \brief Return a const byte_t pointer pointing to the beginning of the header
+	 * \return const byte_t pointer to the beginning of the header
+	 */
+	byte_t const* headerBeginBytes() const { return reinterpret_cast<byte_t const*>(begin_); }  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+
+	/**
+	 * \brief Get the size of this Fragment's header, in RawDataType words
+	 * \return The in-memory size of the Fragment header, in RawDataType words
+	 */
+	size_t headerSizeWords() const { return header_words_; }
+
+	/**
+	 * \brief Get the size of this Fragment's header, in bytes
+	 * \return The in-memory size of the Fragment header, in bytes
+	 */
+	size_t headerSizeBytes() const { return sizeof(RawDataType) * header_words_; }
+
+	/**
+	 * \brief Get a copy of the RawFragmentHeader
+	 * \return Copy of the RawFragmentHeader, upgraded to the latest version
+	 */
+	detail::RawFragmentHeader const fragmentHeader() const { return hdr_; }
+
+	/**
+	 * \brief Copy the viewed Fragment into a new Fragment, which stays valid after the view's memory goes away
+	 * \return Fragment containing a copy of the header, metadata, and payload
+	 */
+	Fragment materialize() const
+	{
+		Fragment output(size() - detail::RawFragmentHeader::num_words());
+		memcpy(output.headerAddress(), begin_, sizeBytes());
+		output.autoResize();
+		return output;
+	}
+
+private:
+	RawDataType const* begin_;
+	detail::RawFragmentHeader hdr_;
+	size_t header_words_;
+};
+
+inline artdaq::FragmentView::FragmentView(RawDataType const* begin)
+    : begin_(begin)
+    , hdr_(*reinterpret_cast<detail::RawFragmentHeader const*>(begin))  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    , header_words_(detail::RawFragmentHeader::num_words())
+{
+	switch (hdr_.version)
+	{
+		case detail::RawFragmentHeader::CurrentVersion:
+		case 0xFFFF:
+			break;
+		case 0: {
+			auto old_hdr = reinterpret_cast<detail::RawFragmentHeaderV0 const*>(begin);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+			hdr_ = old_hdr->upgrade();
+			header_words_ = old_hdr->num_words();
+			break;
+		}
+		case 1: {
+			auto old_hdr = reinterpret_cast<detail::RawFragmentHeaderV1 const*>(begin);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+			hdr_ = old_hdr->upgrade();
+			header_words_ = old_hdr->num_words();
+			break;
+		}
+		default:
+			throw cet::exception("FragmentView") << "A Fragment with an unknown version (" << std::to_string(hdr_.version) << ") was received!";  // NOLINT(cert-err60-cpp)
+	}
+}
+
+#endif /* artdaq_core_Data_FragmentView_hh */
@@ -62,6 +62,7 @@ struct artdaq::detail::RawFragmentHeader
 	static constexpr type_t EmptyFragmentType = FIRST_SYSTEM_TYPE + 6;        ///< This Fragment contains no data and serves as a placeholder for when no data from a FragmentGenerator is expected
 	static constexpr type_t ContainerFragmentType = FIRST_SYSTEM_TYPE + 7;    ///< This Fragment is a ContainerFragment and analysis code should unpack it
 	static constexpr type_t ErrorFragmentType = FIRST_SYSTEM_TYPE + 8;        ///< This Fragment has experienced some error, and no attempt should be made to read it
+	static constexpr type_t EventTOCFragmentType = FIRST_SYSTEM_TYPE + 9;     ///< This Fragment is the table of contents of an event (see EventTOC)
 
 	/**
 	 * \brief Returns a map of the most-commonly used system types
@@ -92,7 +93,8 @@ struct artdaq::detail::RawFragmentHeader
 		    {type_t(EndOfSubrunFragmentType), "EndOfSubrun"},
 		    {type_t(ShutdownFragmentType), "Shutdown"},
 		    {type_t(EmptyFragmentType), "Empty"},
-		    {type_t(ContainerFragmentType), "Container"}};
+		    {type_t(ContainerFragmentType), "Container"},
+		    {type_t(EventTOCFragmentType), "EventTOC"}};
 	}
 
 	/**
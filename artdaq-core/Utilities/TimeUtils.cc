@@ -55,6 +55,17 @@ uint64_t artdaq::TimeUtils::gettimeofday_us()
 	return static_cast<uint64_t>(tv.tv_sec) * 1000000 + tv.tv_usec;
 }
 
+uint64_t artdaq::TimeUtils::gettime_monotonic_coarse_us()
+{
+	struct timespec ts;
+#ifdef CLOCK_MONOTONIC_COARSE
+	clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+#else
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+	return static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
 struct timespec artdaq::TimeUtils::get_realtime_clock()
 {
 	struct timespec ts;
@@ -100,6 +100,15 @@ std::string convertUnixTimeToString(struct timespec const& inputUnixTime);
  */
 uint64_t gettimeofday_us();
 
+/**
+ * \brief Get a cheap monotonic timestamp in microseconds (from clock_gettime(CLOCK_MONOTONIC_COARSE, ...))
+ * \return Microseconds since an arbitrary (boot-time) epoch
+ *
+ * The resolution is one kernel tick (typically 1-4 ms). The value is not affected by wall-clock adjustments,
+ * and may be compared between processes on the same host.
+ */
+uint64_t gettime_monotonic_coarse_us();
+
 /**
  * \brief Converts a Unix time to double
  * \param inputUnixTime A time_t Unix time variable
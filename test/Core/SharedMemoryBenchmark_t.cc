@@ -0,0 +1,487 @@
+// Throughput and latency benchmark for SharedMemoryManager and SharedMemoryFragmentManager.
+//
+// Runs N writers and M readers (processes by default, or threads) against a segment, sweeping the buffer count,
+// buffer size, read mode and overwrite flag, and prints one JSON document with the results. Not run by ctest;
+// run by hand and keep the output to compare against later builds:
+//
+//   SharedMemoryBenchmark_t [--writers N] [--readers M] [--threads] [--duration-ms T] [--quick] [--output file.json]
+
+#define TRACE_NAME "SharedMemoryBenchmark_t"
+#include "TRACE/tracemf.h"
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SharedMemoryTestShims.hh"
+#include "artdaq-core/Core/SharedMemoryFragmentManager.hh"
+#include "artdaq-core/Core/SharedMemoryManager.hh"
+#include "artdaq-core/Data/Fragment.hh"
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct Options
+{
+	size_t writers{1};
+	size_t readers{1};
+	bool threads{false};
+	size_t duration_ms{1000};
+	bool quick{false};
+	std::string output;
+};
+
+struct Scenario
+{
+	bool fragments{false};  ///< Use SharedMemoryFragmentManager::WriteFragment/ReadFragment instead of the buffer API
+	size_t buffer_count{0};
+	size_t buffer_size{0};
+	bool destructive{true};
+	bool overwrite{false};
+};
+
+struct ParticipantResult
+{
+	uint64_t events{0};
+	uint64_t bytes{0};
+	uint64_t cpu_us{0};
+	std::vector<uint64_t> latencies_ns;  ///< Time taken to acquire each buffer
+};
+
+uint64_t cpuMicroseconds(bool thread)
+{
+	struct rusage usage = {};
+	getrusage(thread ? RUSAGE_THREAD : RUSAGE_SELF, &usage);
+	return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000ull + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+uint64_t nanosecondsSince(Clock::time_point start)
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+}
+
+ParticipantResult runWriter(Scenario const& scenario, uint32_t key, Clock::time_point start_time, Clock::time_point deadline, bool thread)
+{
+	ParticipantResult result;
+	uint64_t cpu_start = 0;
+	if (scenario.fragments)
+	{
+		artdaq::SharedMemoryFragmentManager shm(key);
+		std::this_thread::sleep_until(start_time);
+		cpu_start = cpuMicroseconds(thread);
+		auto header_bytes = artdaq::detail::RawFragmentHeader::num_words() * sizeof(artdaq::RawDataType);
+		artdaq::Fragment frag((scenario.buffer_size - header_bytes) / sizeof(artdaq::RawDataType));
+		while (Clock::now() < deadline)
+		{
+			// WriteFragment would wait for a buffer without a deadline when not overwriting, so acquire it first
+			auto start = Clock::now();
+			auto waiter = shm.GetWaitPolicy().MakeWaiter();
+			while (!shm.ReadyForWrite(scenario.overwrite) && Clock::now() < deadline)
+			{
+				waiter.Wait();
+			}
+			if (!shm.ReadyForWrite(scenario.overwrite))
+			{
+				break;
+			}
+			result.latencies_ns.push_back(nanosecondsSince(start));
+			// WriteFragment only copies the Fragment's data, so the same Fragment is sent every time
+			if (shm.WriteFragment(std::move(frag), scenario.overwrite, 0) != 0)
+			{
+				break;
+			}
+			++result.events;
+			result.bytes += frag.sizeBytes();
+		}
+	}
+	else
+	{
+		artdaq::SharedMemoryManager shm(key);
+		std::this_thread::sleep_until(start_time);
+		cpu_start = cpuMicroseconds(thread);
+		std::vector<uint8_t> payload(scenario.buffer_size, 0xA5);
+		while (Clock::now() < deadline)
+		{
+			auto start = Clock::now();
+			auto waiter = shm.GetWaitPolicy().MakeWaiter();
+			int buf = -1;
+			while ((buf = shm.GetBufferForWriting(scenario.overwrite)) == -1 && Clock::now() < deadline)
+			{
+				waiter.Wait();
+			}
+			if (buf == -1)
+			{
+				break;
+			}
+			result.latencies_ns.push_back(nanosecondsSince(start));
+			shm.Write(buf, payload.data(), payload.size());
+			shm.MarkBufferFull(buf);
+			++result.events;
+			result.bytes += payload.size();
+		}
+	}
+	result.cpu_us = cpuMicroseconds(thread) - cpu_start;
+	return result;
+}
+
+ParticipantResult runReader(Scenario const& scenario, uint32_t key, Clock::time_point start_time, Clock::time_point deadline, bool thread)
+{
+	ParticipantResult result;
+	uint64_t cpu_start = 0;
+	if (scenario.fragments)
+	{
+		artdaq::SharedMemoryFragmentManager shm(key);
+		std::this_thread::sleep_until(start_time);
+		cpu_start = cpuMicroseconds(thread);
+		artdaq::Fragment frag;
+		while (Clock::now() < deadline)
+		{
+			auto start = Clock::now();
+			auto waiter = shm.GetWaitPolicy().MakeWaiter();
+			int sts = -1;
+			while ((sts = shm.ReadFragment(frag)) == -1 && Clock::now() < deadline)
+			{
+				waiter.Wait();
+			}
+			if (sts != 0)
+			{
+				continue;
+			}
+			result.latencies_ns.push_back(nanosecondsSince(start));
+			++result.events;
+			result.bytes += frag.sizeBytes();
+		}
+	}
+	else
+	{
+		artdaq::SharedMemoryManager shm(key);
+		std::this_thread::sleep_until(start_time);
+		cpu_start = cpuMicroseconds(thread);
+		std::vector<uint8_t> data(scenario.buffer_size);
+		while (Clock::now() < deadline)
+		{
+			auto start = Clock::now();
+			auto waiter = shm.GetWaitPolicy().MakeWaiter();
+			int buf = -1;
+			while ((buf = shm.GetBufferForReading()) == -1 && Clock::now() < deadline)
+			{
+				waiter.Wait();
+			}
+			if (buf == -1)
+			{
+				break;
+			}
+			result.latencies_ns.push_back(nanosecondsSince(start));
+			auto size = shm.BufferDataSize(buf);
+			shm.Read(buf, data.data(), size);
+			shm.MarkBufferEmpty(buf);
+			++result.events;
+			result.bytes += size;
+		}
+	}
+	result.cpu_us = cpuMicroseconds(thread) - cpu_start;
+	return result;
+}
+
+// Results of forked participants are sent back to the parent through a pipe
+bool writeAll(int fd, void const* data, size_t size)
+{
+	auto ptr = static_cast<uint8_t const*>(data);
+	while (size > 0)
+	{
+		auto sts = write(fd, ptr, size);
+		if (sts <= 0)
+		{
+			return false;
+		}
+		ptr += sts;
+		size -= sts;
+	}
+	return true;
+}
+
+bool readAll(int fd, void* data, size_t size)
+{
+	auto ptr = static_cast<uint8_t*>(data);
+	while (size > 0)
+	{
+		auto sts = read(fd, ptr, size);
+		if (sts <= 0)
+		{
+			return false;
+		}
+		ptr += sts;
+		size -= sts;
+	}
+	return true;
+}
+
+bool sendResult(int fd, ParticipantResult const& result)
+{
+	uint64_t header[4] = {result.events, result.bytes, result.cpu_us, result.latencies_ns.size()};
+	return writeAll(fd, &header[0], sizeof(header)) &&
+	       writeAll(fd, result.latencies_ns.data(), result.latencies_ns.size() * sizeof(uint64_t));
+}
+
+bool receiveResult(int fd, ParticipantResult& result)
+{
+	uint64_t header[4];
+	if (!readAll(fd, &header[0], sizeof(header)))
+	{
+		return false;
+	}
+	result.events = header[0];
+	result.bytes = header[1];
+	result.cpu_us = header[2];
+	result.latencies_ns.resize(header[3]);
+	return readAll(fd, result.latencies_ns.data(), result.latencies_ns.size() * sizeof(uint64_t));
+}
+
+bool runParticipants(Scenario const& scenario, uint32_t key, Options const& options, std::vector<ParticipantResult>& writers, std::vector<ParticipantResult>& readers)
+{
+	auto count = options.writers + options.readers;
+	std::vector<ParticipantResult> results(count);
+	// Give every participant time to attach before the clock starts
+	auto start_time = Clock::now() + std::chrono::milliseconds(200);
+	auto deadline = start_time + std::chrono::milliseconds(options.duration_ms);
+	auto run = [&](size_t index, bool thread) {
+		return index < options.writers ? runWriter(scenario, key, start_time, deadline, thread) : runReader(scenario, key, start_time, deadline, thread);
+	};
+
+	auto ok = true;
+	if (options.threads)
+	{
+		std::vector<std::thread> threads;
+		for (size_t ii = 0; ii < count; ++ii)
+		{
+			threads.emplace_back([&, ii]() { results[ii] = run(ii, true); });
+		}
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+	}
+	else
+	{
+		std::vector<std::pair<pid_t, int>> children;
+		for (size_t ii = 0; ii < count; ++ii)
+		{
+			int fds[2];
+			if (pipe(&fds[0]) != 0)
+			{
+				ok = false;
+				break;
+			}
+			auto pid = fork();
+			if (pid == 0)
+			{
+				close(fds[0]);
+				auto sent = sendResult(fds[1], run(ii, false));
+				_exit(sent ? 0 : 1);
+			}
+			close(fds[1]);
+			if (pid < 0)
+			{
+				close(fds[0]);
+				ok = false;
+				break;
+			}
+			children.emplace_back(pid, fds[0]);
+		}
+		for (size_t ii = 0; ii < children.size(); ++ii)
+		{
+			ok = receiveResult(children[ii].second, results[ii]) && ok;
+			close(children[ii].second);
+			int status = 0;
+			waitpid(children[ii].first, &status, 0);
+			ok = ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+		}
+	}
+
+	writers.assign(results.begin(), results.begin() + options.writers);
+	readers.assign(results.begin() + options.writers, results.end());
+	return ok;
+}
+
+std::string percentiles(std::vector<ParticipantResult> const& participants)
+{
+	std::vector<uint64_t> latencies;
+	for (auto& participant : participants)
+	{
+		latencies.insert(latencies.end(), participant.latencies_ns.begin(), participant.latencies_ns.end());
+	}
+	std::sort(latencies.begin(), latencies.end());
+	auto at = [&](double fraction) {
+		return latencies.empty() ? 0.0 : latencies[std::min(static_cast<size_t>(fraction * latencies.size()), latencies.size() - 1)] / 1000.0;
+	};
+
+	std::ostringstream ostr;
+	ostr << "{\"p50\": " << at(0.5) << ", \"p99\": " << at(0.99) << ", \"p999\": " << at(0.999) << "}";
+	return ostr.str();
+}
+
+std::string runScenario(Scenario const& scenario, Options const& options)
+{
+	auto key = GetRandomKey(0xBE7C);
+	std::unique_ptr<artdaq::SharedMemoryManager> owner;
+	if (scenario.fragments)
+	{
+		owner = std::make_unique<artdaq::SharedMemoryFragmentManager>(key, scenario.buffer_count, scenario.buffer_size, 1000000);
+	}
+	else
+	{
+		owner = std::make_unique<artdaq::SharedMemoryManager>(key, scenario.buffer_count, scenario.buffer_size, 1000000, scenario.destructive);
+	}
+
+	std::vector<ParticipantResult> writers;
+	std::vector<ParticipantResult> readers;
+	auto ok = runParticipants(scenario, key, options, writers, readers);
+
+	uint64_t written = 0;
+	uint64_t read = 0;
+	uint64_t bytes_read = 0;
+	uint64_t cpu_us = 0;
+	for (auto& writer : writers)
+	{
+		written += writer.events;
+		cpu_us += writer.cpu_us;
+	}
+	for (auto& reader : readers)
+	{
+		read += reader.events;
+		bytes_read += reader.bytes;
+		cpu_us += reader.cpu_us;
+	}
+	auto seconds = options.duration_ms / 1000.0;
+
+	std::ostringstream ostr;
+	ostr << "    {\"manager\": \"" << (scenario.fragments ? "SharedMemoryFragmentManager" : "SharedMemoryManager") << "\""
+	     << ", \"buffer_count\": " << scenario.buffer_count
+	     << ", \"buffer_size\": " << scenario.buffer_size
+	     << ", \"mode\": \"" << (scenario.destructive ? "destructive" : "broadcast") << "\""
+	     << ", \"overwrite\": " << (scenario.overwrite ? "true" : "false")
+	     << ", \"ok\": " << (ok ? "true" : "false")
+	     << ", \"events_written\": " << written
+	     << ", \"events_read\": " << read
+	     << ", \"write_rate_hz\": " << written / seconds
+	     << ", \"read_rate_hz\": " << read / seconds
+	     << ", \"published_consumption_rate_hz\": " << owner->GetConsumptionRate()
+	     << ", \"read_throughput_GBps\": " << bytes_read / seconds / 1e9
+	     << ", \"write_acquire_latency_us\": " << percentiles(writers)
+	     << ", \"read_acquire_latency_us\": " << percentiles(readers)
+	     << ", \"cpu_us_per_event\": " << (written > 0 ? static_cast<double>(cpu_us) / written : 0.0)
+	     << "}";
+	TLOG(TLVL_INFO) << ostr.str();
+	return ostr.str();
+}
+
+std::vector<Scenario> makeScenarios(Options const& options)
+{
+	std::vector<size_t> counts = options.quick ? std::vector<size_t>{8} : std::vector<size_t>{4, 32};
+	std::vector<size_t> sizes = options.quick ? std::vector<size_t>{0x10000} : std::vector<size_t>{0x1000, 0x10000, 0x100000};
+
+	std::vector<Scenario> scenarios;
+	for (auto fragments : {false, true})
+	{
+		for (auto count : counts)
+		{
+			for (auto size : sizes)
+			{
+				for (auto destructive : {true, false})
+				{
+					for (auto overwrite : {false, true})
+					{
+						// SharedMemoryFragmentManager only supports destructive reads. In broadcast mode, buffers are only
+						// freed by their timeout, so writers which do not overwrite would just measure the timeout.
+						if ((fragments && !destructive) || (!destructive && !overwrite))
+						{
+							continue;
+						}
+						scenarios.push_back(Scenario{fragments, count, size, destructive, overwrite});
+					}
+				}
+			}
+		}
+	}
+	return scenarios;
+}
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+	Options options;
+	for (int ii = 1; ii < argc; ++ii)
+	{
+		std::string arg = argv[ii];
+		auto value = [&]() { return ii + 1 < argc ? std::string(argv[++ii]) : std::string(); };
+		if (arg == "--writers")
+		{
+			options.writers = std::stoul(value());
+		}
+		else if (arg == "--readers")
+		{
+			options.readers = std::stoul(value());
+		}
+		else if (arg == "--threads")
+		{
+			options.threads = true;
+		}
+		else if (arg == "--duration-ms")
+		{
+			options.duration_ms = std::stoul(value());
+		}
+		else if (arg == "--quick")
+		{
+			options.quick = true;
+			options.duration_ms = std::min(options.duration_ms, static_cast<size_t>(200));
+		}
+		else if (arg == "--output")
+		{
+			options.output = value();
+		}
+		else
+		{
+			std::cerr << "Usage: " << argv[0] << " [--writers N] [--readers M] [--threads] [--duration-ms T] [--quick] [--output file.json]" << std::endl;
+			return 1;
+		}
+	}
+	if (options.writers == 0 || options.readers == 0 || options.duration_ms == 0)
+	{
+		std::cerr << "At least one writer, one reader and a non-zero duration are required" << std::endl;
+		return 1;
+	}
+
+	std::ostringstream json;
+	json << "{\n  \"benchmark\": \"SharedMemoryBenchmark\",\n"
+	     << "  \"writers\": " << options.writers << ",\n"
+	     << "  \"readers\": " << options.readers << ",\n"
+	     << "  \"participants\": \"" << (options.threads ? "threads" : "processes") << "\",\n"
+	     << "  \"duration_ms\": " << options.duration_ms << ",\n"
+	     << "  \"results\": [\n";
+	auto scenarios = makeScenarios(options);
+	for (size_t ii = 0; ii < scenarios.size(); ++ii)
+	{
+		json << runScenario(scenarios[ii], options) << (ii + 1 < scenarios.size() ? ",\n" : "\n");
+	}
+	json << "  ]\n}\n";
+
+	if (options.output.empty())
+	{
+		std::cout << json.str();
+	}
+	else
+	{
+		std::ofstream(options.output) << json.str();
+	}
+	return 0;
+}
@@ -0,0 +1,474 @@
+#include "artdaq-core/Core/SharedMemoryEventReceiver.hh"
+#include "artdaq-core/Data/EventTOC.hh"
+
+#define BOOST_TEST_MODULE SharedMemoryEventReceiver_t
+#include "cetlib/quiet_unit_test.hpp"
+
+#include <unistd.h>
+#include <atomic>
+#include <set>
+#include <thread>
+
+#define TRACE_NAME "SharedMemoryEventReceiver_t"
+#include "SharedMemoryTestShims.hh"
+#include "TRACE/tracemf.h"
+
+namespace {
+artdaq::Fragments MakeFragments(artdaq::Fragment::sequence_id_t seq, size_t count)
+{
+	artdaq::Fragments frags;
+	for (size_t ii = 0; ii < count; ++ii)
+	{
+		frags.emplace_back(100 + ii * 37);
+		auto& frag = frags.back();
+		frag.setSequenceID(seq);
+		frag.setFragmentID(ii);
+		frag.setUserType(ii % 2 != 0u ? 1 : 2);
+		for (size_t jj = 0; jj < frag.dataSize(); ++jj)
+		{
+			*(frag.dataBegin() + jj) = seq * 100000 + ii * 1000 + jj;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		}
+	}
+	return frags;
+}
+
+void WriteEvent(artdaq::SharedMemoryManager& shm, artdaq::Fragment::sequence_id_t seq, artdaq::Fragments frags, bool toc = false)
+{
+	auto buf = shm.GetBufferForWriting(false);
+	BOOST_REQUIRE_NE(buf, -1);
+	artdaq::detail::RawEventHeader hdr(1, 1, seq, seq, 0);
+	shm.Write(buf, &hdr, sizeof(hdr));
+	if (toc)
+	{
+		auto toc_frag = artdaq::EventTOC::Make(seq, frags);
+		shm.Write(buf, toc_frag.headerBeginBytes(), toc_frag.sizeBytes());
+	}
+	for (auto& frag : frags)
+	{
+		shm.Write(buf, frag.headerBeginBytes(), frag.sizeBytes());
+	}
+	shm.MarkBufferFull(buf);
+}
+
+// Called from worker threads, so it reports instead of using the Boost.Test macros
+bool CheckEvent(artdaq::SharedMemoryEventReceiver::Event& event, artdaq::Fragment::sequence_id_t seq, size_t count)
+{
+	auto frags = MakeFragments(seq, count);
+	bool err = false;
+	auto index = event.GetFragmentIndex(err);
+	auto views = event.GetFragmentViewsByType(err, artdaq::Fragment::InvalidFragmentType);
+	if (err || index.size() != count || views.size() != count || event.GetFragmentTypes(err).size() != 2)
+	{
+		return false;
+	}
+	for (size_t ii = 0; ii < count; ++ii)
+	{
+		if (index[ii].fragment_id != ii || index[ii].word_count != frags[ii].size() || views[ii].sequenceID() != seq ||
+		    !std::equal(views[ii].dataBegin(), views[ii].dataEnd(), frags[ii].dataBegin()))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(SharedMemoryEventReceiver_test)
+
+BOOST_AUTO_TEST_CASE(FragmentIndex)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST FragmentIndex";
+	uint32_t key = GetRandomKey(0xEE1);
+	uint32_t broadcast_key = GetRandomKey(0xEE2);
+	artdaq::SharedMemoryManager owner(key, 2, 0x4000);
+	artdaq::SharedMemoryManager broadcast_owner(broadcast_key, 2, 0x1000);
+	artdaq::SharedMemoryManager writer(key);
+	artdaq::SharedMemoryEventReceiver receiver(key, broadcast_key);
+
+	// The index lists each Fragment's offset, type, Fragment ID and size, in order
+	auto frags = MakeFragments(5, 3);
+	WriteEvent(writer, 5, MakeFragments(5, 3));
+	BOOST_REQUIRE(receiver.ReadyForRead(false, 1000000));
+	bool err = true;
+	auto index = receiver.GetFragmentIndex(err);
+	BOOST_REQUIRE(!err);
+	BOOST_REQUIRE_EQUAL(index.size(), 3);
+	size_t offset = sizeof(artdaq::detail::RawEventHeader);
+	for (size_t ii = 0; ii < index.size(); ++ii)
+	{
+		BOOST_REQUIRE_EQUAL(index[ii].offset, offset);
+		BOOST_REQUIRE_EQUAL(index[ii].type, frags[ii].type());
+		BOOST_REQUIRE_EQUAL(index[ii].fragment_id, ii);
+		BOOST_REQUIRE_EQUAL(index[ii].word_count, frags[ii].size());
+		offset += frags[ii].sizeBytes();
+	}
+
+	// The type queries are answered from it
+	auto types = receiver.GetFragmentTypes(err);
+	BOOST_REQUIRE(!err);
+	BOOST_REQUIRE(types == std::set<artdaq::Fragment::type_t>({frags[0].type(), frags[1].type()}));
+	auto copies = receiver.GetFragmentsByType(err, frags[1].type());
+	BOOST_REQUIRE(!err);
+	BOOST_REQUIRE_EQUAL(copies->size(), 1);
+	BOOST_REQUIRE_EQUAL(copies->at(0).fragmentID(), 1);
+	BOOST_REQUIRE(std::equal(copies->at(0).dataBegin(), copies->at(0).dataEnd(), frags[1].dataBegin()));
+	auto views = receiver.GetFragmentViewsByType(err, frags[0].type());
+	BOOST_REQUIRE(!err);
+	BOOST_REQUIRE_EQUAL(views.size(), 2);
+	BOOST_REQUIRE_EQUAL(views[1].fragmentID(), 2);
+	BOOST_REQUIRE(std::equal(views[1].dataBegin(), views[1].dataEnd(), frags[2].dataBegin()));
+	receiver.ReleaseBuffer();
+
+	// A Fragment which runs past the end of the event leaves no usable index, and every query reports an error
+	auto buf = writer.GetBufferForWriting(false);
+	BOOST_REQUIRE_NE(buf, -1);
+	artdaq::detail::RawEventHeader hdr(1, 1, 6, 6, 0);
+	writer.Write(buf, &hdr, sizeof(hdr));
+	writer.Write(buf, frags[0].headerBeginBytes(), frags[0].sizeBytes() / 2);
+	writer.MarkBufferFull(buf);
+	BOOST_REQUIRE(receiver.ReadyForRead(false, 1000000));
+	err = false;
+	BOOST_REQUIRE(receiver.GetFragmentIndex(err).empty());
+	BOOST_REQUIRE(err);
+	err = false;
+	BOOST_REQUIRE(receiver.GetFragmentTypes(err).empty());
+	BOOST_REQUIRE(err);
+	err = false;
+	BOOST_REQUIRE(receiver.GetFragmentsByType(err, artdaq::Fragment::InvalidFragmentType) == nullptr);
+	BOOST_REQUIRE(err);
+	err = false;
+	BOOST_REQUIRE(receiver.GetFragmentViewsByType(err, artdaq::Fragment::InvalidFragmentType).empty());
+	BOOST_REQUIRE(err);
+	receiver.ReleaseBuffer();
+	BOOST_REQUIRE_EQUAL(owner.WriteReadyCount(false), 2);
+	TLOG(TLVL_DEBUG) << "END TEST FragmentIndex";
+}
+
+BOOST_AUTO_TEST_CASE(ChainedEvent)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST ChainedEvent";
+	uint32_t key = GetRandomKey(0xEE1);
+	uint32_t broadcast_key = GetRandomKey(0xEE2);
+	artdaq::SharedMemoryManager owner(key, 4, 0x1000);
+	artdaq::SharedMemoryManager broadcast_owner(broadcast_key, 2, 0x1000);
+	artdaq::SharedMemoryManager writer(key);
+	writer.SetMaxChainLength(3);
+	artdaq::SharedMemoryEventReceiver receiver(key, broadcast_key);
+
+	// Six Fragments spread over three chained buffers, with and without a table of contents
+	for (int toc = 0; toc < 2; ++toc)
+	{
+		WriteEvent(writer, 7, MakeFragments(7, 6), toc != 0);
+		BOOST_REQUIRE(receiver.ReadyForRead(false, 1000000));
+		bool err = false;
+		BOOST_REQUIRE_EQUAL(receiver.ReadHeader(err)->sequence_id, 7);
+		BOOST_REQUIRE(!err);
+
+		auto frags = MakeFragments(7, 6);
+		auto views = receiver.GetFragmentViewsByType(err, artdaq::Fragment::InvalidFragmentType);
+		auto again = receiver.GetFragmentViewsByType(err, artdaq::Fragment::InvalidFragmentType);
+		BOOST_REQUIRE_EQUAL(views.size(), 6);
+		size_t in_place = 0;
+		for (size_t ii = 0; ii < views.size(); ++ii)
+		{
+			BOOST_REQUIRE(std::equal(views[ii].dataBegin(), views[ii].dataEnd(), frags[ii].dataBegin()));
+			// Fragments which are not split across buffers are viewed in place, so every call returns the same address
+			if (views[ii].headerBegin() == again[ii].headerBegin())
+			{
+				++in_place;
+			}
+		}
+		BOOST_REQUIRE_GE(in_place, 4);
+		BOOST_REQUIRE_LT(in_place, 6);
+
+		auto copies = receiver.GetFragmentsByType(err, artdaq::Fragment::InvalidFragmentType);
+		BOOST_REQUIRE_EQUAL(copies->size(), 6);
+		BOOST_REQUIRE(std::equal(copies->at(5).dataBegin(), copies->at(5).dataEnd(), frags[5].dataBegin()));
+		auto index = receiver.GetFragmentIndex(err);
+		BOOST_REQUIRE_EQUAL(index.size(), 6);
+		BOOST_REQUIRE_EQUAL(index[0].offset, sizeof(artdaq::detail::RawEventHeader) + (toc != 0 ? artdaq::EventTOC::SizeWords(6) * sizeof(artdaq::RawDataType) : 0));
+		receiver.ReleaseBuffer();
+	}
+	bool err = false;
+	BOOST_REQUIRE_THROW(receiver.GetFragmentIndex(err), cet::exception);
+	BOOST_REQUIRE_EQUAL(owner.WriteReadyCount(false), 4);
+	TLOG(TLVL_DEBUG) << "END TEST ChainedEvent";
+}
+
+BOOST_AUTO_TEST_CASE(ParallelReceive)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST ParallelReceive";
+	uint32_t key = GetRandomKey(0xEE3);
+	uint32_t broadcast_key = GetRandomKey(0xEE4);
+	artdaq::SharedMemoryManager owner(key, 16, 0x2000);
+	artdaq::SharedMemoryManager broadcast_owner(broadcast_key, 2, 0x1000);
+	artdaq::SharedMemoryEventReceiver receiver(key, broadcast_key);
+	for (size_t seq = 1; seq <= 12; ++seq)
+	{
+		WriteEvent(owner, seq, MakeFragments(seq, 4));
+	}
+
+	std::atomic<int> running(0);
+	std::atomic<int> max_running(0);
+	std::atomic<size_t> processed(0);
+	std::atomic<bool> corrupt(false);
+	std::vector<artdaq::Fragment::sequence_id_t> order;
+	size_t broadcasts = 0;
+	auto process = [&](artdaq::SharedMemoryEventReceiver::Event& event) {
+		auto now = ++running;
+		auto max = max_running.load();
+		while (now > max && !max_running.compare_exchange_weak(max, now)) {}
+		bool err = false;
+		auto seq = event.ReadHeader(err)->sequence_id;
+		if (!CheckEvent(event, seq, 4))
+		{
+			corrupt = true;
+		}
+		// Earlier events take longer, so that later ones finish first
+		usleep(seq == 1 ? 100000 : (13 - seq) * 2000);
+		--running;
+		++processed;
+	};
+	auto deliver = [&](artdaq::SharedMemoryEventReceiver::Event& event) {
+		bool err = false;
+		auto hdr = event.ReadHeader(err);
+		BOOST_REQUIRE(!err);
+		if (event.IsBroadcast())
+		{
+			// Every data event handed to a worker before the broadcast arrived has been delivered
+			BOOST_REQUIRE_EQUAL(hdr->sequence_id, 99);
+			BOOST_REQUIRE_EQUAL(order.size(), processed.load());
+			++broadcasts;
+		}
+		else
+		{
+			order.push_back(hdr->sequence_id);
+		}
+		if (hdr->sequence_id == 6)
+		{
+			WriteEvent(broadcast_owner, 99, MakeFragments(99, 2));
+		}
+		return true;
+	};
+	auto delivered = receiver.ParallelReceive(4, 6, process, deliver, 200000);
+
+	BOOST_REQUIRE(!corrupt);
+	BOOST_REQUIRE_EQUAL(delivered, 13);
+	BOOST_REQUIRE_EQUAL(broadcasts, 1);
+	BOOST_REQUIRE_EQUAL(order.size(), 12);
+	BOOST_REQUIRE(std::is_sorted(order.begin(), order.end()));
+	BOOST_REQUIRE_GT(max_running.load(), 1);
+	BOOST_REQUIRE_LE(max_running.load(), 4);
+	BOOST_REQUIRE_EQUAL(owner.WriteReadyCount(false), 16);
+	TLOG(TLVL_DEBUG) << "END TEST ParallelReceive";
+}
+
+BOOST_AUTO_TEST_CASE(ParallelReceiveErrors)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST ParallelReceiveErrors";
+	uint32_t key = GetRandomKey(0xEE5);
+	uint32_t broadcast_key = GetRandomKey(0xEE6);
+	artdaq::SharedMemoryManager owner(key, 8, 0x2000);
+	artdaq::SharedMemoryManager broadcast_owner(broadcast_key, 2, 0x1000);
+	artdaq::SharedMemoryEventReceiver receiver(key, broadcast_key);
+	for (size_t seq = 1; seq <= 8; ++seq)
+	{
+		WriteEvent(owner, seq, MakeFragments(seq, 2));
+	}
+
+	// An exception from a worker stops receiving and is rethrown once every held buffer is released
+	auto process = [&](artdaq::SharedMemoryEventReceiver::Event& event) {
+		bool err = false;
+		if (event.ReadHeader(err)->sequence_id == 3)
+		{
+			throw cet::exception("ParallelReceiveErrors") << "Failing event 3";
+		}
+	};
+	size_t delivered = 0;
+	auto deliver = [&](artdaq::SharedMemoryEventReceiver::Event&) { ++delivered; return true; };
+	BOOST_REQUIRE_THROW(receiver.ParallelReceive(2, 4, process, deliver, 200000), cet::exception);
+	BOOST_REQUIRE_EQUAL(delivered, 2);
+	BOOST_REQUIRE_EQUAL(owner.ReadReadyCount() + owner.WriteReadyCount(false), 8);
+
+	// Returning false from deliver stops receiving as well
+	WriteEvent(owner, 9, MakeFragments(9, 2));
+	WriteEvent(owner, 10, MakeFragments(10, 2));
+	auto stop = [&](artdaq::SharedMemoryEventReceiver::Event&) { return ++delivered < 4; };
+	BOOST_REQUIRE_EQUAL(receiver.ParallelReceive(2, 2, [](artdaq::SharedMemoryEventReceiver::Event&) {}, stop, 200000), 2);
+	BOOST_REQUIRE_EQUAL(owner.ReadReadyCount() + owner.WriteReadyCount(false), 8);
+	TLOG(TLVL_DEBUG) << "END TEST ParallelReceiveErrors";
+}
+
+BOOST_AUTO_TEST_CASE(Lookahead)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST Lookahead";
+	uint32_t key = GetRandomKey(0xEE7);
+	uint32_t broadcast_key = GetRandomKey(0xEE8);
+	artdaq::SharedMemoryManager owner(key, 8, 0x2000);
+	artdaq::SharedMemoryManager broadcast_owner(broadcast_key, 2, 0x1000);
+	artdaq::SharedMemoryEventReceiver receiver(key, broadcast_key);
+	receiver.SetLookahead(true);
+	BOOST_REQUIRE(receiver.GetLookahead());
+	for (size_t seq = 1; seq <= 6; ++seq)
+	{
+		WriteEvent(owner, seq, MakeFragments(seq, 3), seq % 2 == 0);
+	}
+
+	// Events arrive in order, and a broadcast still comes ahead of the claimed event
+	for (size_t seq = 1; seq <= 4; ++seq)
+	{
+		BOOST_REQUIRE(receiver.ReadyForRead(false, 1000000));
+		bool err = false;
+		BOOST_REQUIRE_EQUAL(receiver.ReadHeader(err)->sequence_id, seq);
+		auto views = receiver.GetFragmentViewsByType(err, artdaq::Fragment::InvalidFragmentType);
+		BOOST_REQUIRE(!err);
+		BOOST_REQUIRE_EQUAL(views.size(), 3);
+		BOOST_REQUIRE_EQUAL(views[2].sequenceID(), seq);
+		receiver.ReleaseBuffer();
+		if (seq == 2)
+		{
+			WriteEvent(broadcast_owner, 99, MakeFragments(99, 1));
+			BOOST_REQUIRE(receiver.ReadyForRead(false, 1000000));
+			BOOST_REQUIRE_EQUAL(receiver.ReadHeader(err)->sequence_id, 99);
+			receiver.ReleaseBuffer();
+		}
+	}
+
+	// Disabling lookahead still returns the claimed event next
+	usleep(100000);
+	BOOST_REQUIRE_EQUAL(owner.ReadReadyCount(), 1);
+	receiver.SetLookahead(false);
+	BOOST_REQUIRE(!receiver.GetLookahead());
+	for (size_t seq = 5; seq <= 6; ++seq)
+	{
+		BOOST_REQUIRE(receiver.ReadyForRead(false, 1000000));
+		bool err = false;
+		BOOST_REQUIRE_EQUAL(receiver.ReadHeader(err)->sequence_id, seq);
+		receiver.ReleaseBuffer();
+	}
+	BOOST_REQUIRE_EQUAL(owner.WriteReadyCount(false), 8);
+
+	// A receiver destroyed while holding a claimed event gives it back as well
+	receiver.SetLookahead(true);
+	WriteEvent(owner, 7, MakeFragments(7, 2));
+	WriteEvent(owner, 8, MakeFragments(8, 2));
+	{
+		artdaq::SharedMemoryEventReceiver other(key, broadcast_key);
+		other.SetLookahead(true);
+		BOOST_REQUIRE(other.ReadyForRead(false, 1000000));
+		other.ReleaseBuffer();
+		usleep(100000);
+		BOOST_REQUIRE_EQUAL(owner.ReadReadyCount(), 0);
+	}
+	BOOST_REQUIRE_EQUAL(owner.ReadReadyCount(), 1);
+	BOOST_REQUIRE(receiver.ReadyForRead(false, 1000000));
+	bool err = false;
+	BOOST_REQUIRE_EQUAL(receiver.ReadHeader(err)->sequence_id, 8);
+	receiver.ReleaseBuffer();
+
+	// ParallelReceive dispatches the claimed event first
+	for (size_t seq = 9; seq <= 11; ++seq)
+	{
+		WriteEvent(owner, seq, MakeFragments(seq, 2));
+	}
+	BOOST_REQUIRE(receiver.ReadyForRead(false, 1000000));
+	BOOST_REQUIRE_EQUAL(receiver.ReadHeader(err)->sequence_id, 9);
+	receiver.ReleaseBuffer();
+	std::vector<artdaq::Fragment::sequence_id_t> order;
+	auto deliver = [&](artdaq::SharedMemoryEventReceiver::Event& event) {
+		bool read_err = false;
+		order.push_back(event.ReadHeader(read_err)->sequence_id);
+		return order.size() < 2;
+	};
+	BOOST_REQUIRE_EQUAL(receiver.ParallelReceive(2, 2, [](artdaq::SharedMemoryEventReceiver::Event&) {}, deliver, 200000), 2);
+	BOOST_REQUIRE_EQUAL(order.size(), 2);
+	BOOST_REQUIRE_EQUAL(order[0], 10);
+	BOOST_REQUIRE_EQUAL(order[1], 11);
+	BOOST_REQUIRE_EQUAL(owner.WriteReadyCount(false), 8);
+
+	// When the reader keeps up, the worker waits for the next event and claims it as soon as it is written
+	WriteEvent(owner, 12, MakeFragments(12, 2));
+	BOOST_REQUIRE(receiver.ReadyForRead(false, 1000000));
+	BOOST_REQUIRE_EQUAL(receiver.ReadHeader(err)->sequence_id, 12);
+	usleep(100000);
+	WriteEvent(owner, 13, MakeFragments(13, 2));
+	usleep(100000);
+	BOOST_REQUIRE_EQUAL(owner.ReadReadyCount(), 0);
+	receiver.ReleaseBuffer();
+	BOOST_REQUIRE(receiver.ReadyForRead(false, 1000000));
+	BOOST_REQUIRE_EQUAL(receiver.ReadHeader(err)->sequence_id, 13);
+	receiver.ReleaseBuffer();
+	BOOST_REQUIRE(!receiver.ReadyForRead(false, 10000));
+	BOOST_REQUIRE_EQUAL(owner.WriteReadyCount(false), 8);
+	TLOG(TLVL_DEBUG) << "END TEST Lookahead";
+}
+
+BOOST_AUTO_TEST_CASE(FragmentSelection)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST FragmentSelection";
+	uint32_t key = GetRandomKey(0xEE9);
+	uint32_t broadcast_key = GetRandomKey(0xEEA);
+	artdaq::SharedMemoryManager owner(key, 4, 0x2000);
+	artdaq::SharedMemoryManager broadcast_owner(broadcast_key, 2, 0x1000);
+	artdaq::SharedMemoryManager writer(key);
+	writer.SetMaxChainLength(3);
+	artdaq::SharedMemoryEventReceiver receiver(key, broadcast_key);
+
+	for (int toc = 0; toc < 2; ++toc)
+	{
+		auto frags = MakeFragments(5, 8);
+		for (size_t ii = 0; ii < frags.size(); ++ii)
+		{
+			frags[ii].setTimestamp(1000 + ii * 10);
+		}
+		WriteEvent(writer, 5, frags, toc != 0);
+		BOOST_REQUIRE(receiver.ReadyForRead(false, 1000000));
+		bool err = false;
+
+		// An empty selection selects everything
+		artdaq::SharedMemoryEventReceiver::FragmentSelection all;
+		BOOST_REQUIRE_EQUAL(receiver.GetFragmentViewsBySelection(err, all).size(), 8);
+		BOOST_REQUIRE(!err);
+
+		// Type 1 is every odd Fragment ID
+		artdaq::SharedMemoryEventReceiver::FragmentSelection by_type;
+		by_type.type_mask.set(1);
+		auto views = receiver.GetFragmentViewsBySelection(err, by_type);
+		BOOST_REQUIRE_EQUAL(views.size(), 4);
+		BOOST_REQUIRE_EQUAL(views[0].fragmentID(), 1);
+		BOOST_REQUIRE_EQUAL(views[3].fragmentID(), 7);
+
+		artdaq::SharedMemoryEventReceiver::FragmentSelection by_id;
+		by_id.fragment_ids = {0, 3, 6, 42};
+		by_id.last_fragment_id = 5;
+		auto copies = receiver.GetFragmentsBySelection(err, by_id);
+		BOOST_REQUIRE_EQUAL(copies->size(), 2);
+		BOOST_REQUIRE_EQUAL(copies->at(1).fragmentID(), 3);
+		BOOST_REQUIRE(std::equal(copies->at(1).dataBegin(), copies->at(1).dataEnd(), frags[3].dataBegin()));
+
+		// The timestamp range is checked against the headers, including Fragments split across buffers
+		artdaq::SharedMemoryEventReceiver::FragmentSelection by_time;
+		by_time.first_timestamp = 1025;
+		by_time.last_timestamp = 1060;
+		by_time.type_mask.set(2);
+		by_time.type_mask.set(1);
+		views = receiver.GetFragmentViewsBySelection(err, by_time);
+		BOOST_REQUIRE_EQUAL(views.size(), 4);
+		for (size_t ii = 0; ii < views.size(); ++ii)
+		{
+			BOOST_REQUIRE_EQUAL(views[ii].fragmentID(), ii + 3);
+			BOOST_REQUIRE(std::equal(views[ii].dataBegin(), views[ii].dataEnd(), frags[ii + 3].dataBegin()));
+		}
+		by_time.type_mask.reset();
+		by_time.type_mask.set(3);
+		BOOST_REQUIRE_EQUAL(receiver.GetFragmentsBySelection(err, by_time)->size(), 0);
+		BOOST_REQUIRE(!err);
+		receiver.ReleaseBuffer();
+	}
+	bool err = false;
+	BOOST_REQUIRE_THROW(receiver.GetFragmentsBySelection(err, artdaq::SharedMemoryEventReceiver::FragmentSelection()), cet::exception);
+	BOOST_REQUIRE_EQUAL(owner.WriteReadyCount(false), 4);
+	TLOG(TLVL_DEBUG) << "END TEST FragmentSelection";
+}
+
+BOOST_AUTO_TEST_SUITE_END()
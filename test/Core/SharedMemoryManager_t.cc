@@ -6,10 +6,38 @@
 #include "cetlib/quiet_unit_test.hpp"
 #include "cetlib_except/exception.h"
 
+#include <sys/wait.h>
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <set>
+#include <thread>
+
 #define TRACE_NAME "SharedMemoryManager_t"
 #include "SharedMemoryTestShims.hh"
 #include "TRACE/tracemf.h"
 
+namespace {
+// Number of IPC_PRIVATE (extension) segments created by this process, from /proc/sysvipc/shm
+size_t CountPrivateSegments()
+{
+	std::ifstream shm("/proc/sysvipc/shm");
+	std::string line;
+	std::getline(shm, line);
+	size_t count = 0;
+	unsigned long key, shmid, size;  // NOLINT(google-runtime-int)
+	int perms, cpid;
+	while (shm >> key >> shmid >> perms >> size >> cpid && std::getline(shm, line))
+	{
+		if (key == 0 && cpid == getpid())
+		{
+			++count;
+		}
+	}
+	return count;
+}
+}  // namespace
+
 BOOST_AUTO_TEST_SUITE(SharedMemoryManager_test)
 
 BOOST_AUTO_TEST_CASE(Construct)
@@ -341,4 +369,847 @@ BOOST_AUTO_TEST_CASE(Broadcast)
 	TLOG(TLVL_DEBUG) << "END TEST Broadcast";
 }
 
+BOOST_AUTO_TEST_CASE(AddBuffers)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST AddBuffers";
+	uint32_t key = GetRandomKey(0x7357);
+	artdaq::SharedMemoryManager man(key, 2, 0x1000);
+	artdaq::SharedMemoryManager man2(key);
+
+	// Only the owner may add buffers
+	BOOST_REQUIRE_EQUAL(man2.AddBuffers(2), false);
+	BOOST_REQUIRE_EQUAL(man2.size(), 2);
+
+	auto buf1 = man.GetBufferForWriting(false);
+	auto buf2 = man.GetBufferForWriting(false);
+	BOOST_REQUIRE_NE(buf1, buf2);
+	BOOST_REQUIRE_EQUAL(man.ReadyForWrite(false), false);
+
+	BOOST_REQUIRE_EQUAL(man.AddBuffers(2), true);
+	BOOST_REQUIRE_EQUAL(man.size(), 4);
+	BOOST_REQUIRE_EQUAL(man.ReadyForWrite(false), true);
+	BOOST_REQUIRE_EQUAL(man.WriteReadyCount(false), 2);
+	// Buffers which were already in use are unaffected
+	BOOST_REQUIRE_EQUAL(man.CheckBuffer(buf1, artdaq::SharedMemoryManager::BufferSemaphoreFlags::Writing), true);
+	BOOST_REQUIRE_EQUAL(man.GetBuffersOwnedByManager().size(), 2);
+
+	// The other manager picks up the new buffers on its next search
+	BOOST_REQUIRE_EQUAL(man2.ReadyForRead(), false);
+	BOOST_REQUIRE_EQUAL(man2.size(), 4);
+
+	auto buf = man.GetBufferForWriting(false);
+	BOOST_REQUIRE_GE(buf, 2);
+	uint8_t n = 0;
+	uint8_t data[0x1000];
+	std::generate_n(data, 0x1000, [&]() { return ++n; });
+	man.Write(buf, data, 0x1000);
+	man.MarkBufferFull(buf, 1);
+
+	BOOST_REQUIRE_EQUAL(man2.ReadyForRead(), true);
+	auto readbuf = man2.GetBufferForReading();
+	BOOST_REQUIRE_EQUAL(readbuf, buf);
+	BOOST_REQUIRE_EQUAL(man2.BufferDataSize(readbuf), 0x1000);
+	uint8_t readdata[0x1000];
+	BOOST_REQUIRE_EQUAL(man2.Read(readbuf, readdata, 0x1000), true);
+	BOOST_REQUIRE_EQUAL(memcmp(data, readdata, 0x1000), 0);
+	man2.MarkBufferEmpty(readbuf);
+
+	man.MarkBufferEmpty(buf1, true);
+	man.MarkBufferEmpty(buf2, true);
+	BOOST_REQUIRE_EQUAL(man.WriteReadyCount(false), 4);
+	TLOG(TLVL_DEBUG) << "END TEST AddBuffers";
+}
+
+BOOST_AUTO_TEST_CASE(ReinitializeRemovesExtensions)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST ReinitializeRemovesExtensions";
+	uint32_t key = GetRandomKey(0x7357);
+	auto before = CountPrivateSegments();
+	{
+		// A warm-restartable owner leaves its segments behind when it goes away
+		artdaq::SharedMemoryManager man(key, 2, 0x1000, 0x10000, true, true);
+		BOOST_REQUIRE_EQUAL(man.AddBuffers(2), true);
+		BOOST_REQUIRE_EQUAL(man.AddBuffers(1), true);
+	}
+	BOOST_REQUIRE_EQUAL(CountPrivateSegments(), before + 2);
+	{
+		// An owner which initializes the segment from scratch removes the extensions it would otherwise orphan
+		artdaq::SharedMemoryManager man(key, 2, 0x1000, 0x10000);
+		BOOST_REQUIRE_EQUAL(man.size(), 2);
+		BOOST_REQUIRE_EQUAL(CountPrivateSegments(), before);
+	}
+	TLOG(TLVL_DEBUG) << "END TEST ReinitializeRemovesExtensions";
+}
+
+BOOST_AUTO_TEST_CASE(Peek)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST Peek";
+	uint32_t key = GetRandomKey(0x7357);
+	artdaq::SharedMemoryManager man(key, 1, 0x1000);
+	artdaq::SharedMemoryManager man2(key);
+	artdaq::SharedMemoryManager monitor(key);
+
+	std::vector<uint8_t> peeked;
+	size_t sequence_id = 0;
+	uint32_t generation = 0;
+	BOOST_REQUIRE_EQUAL(monitor.PeekLatest(peeked, sequence_id), false);
+	BOOST_REQUIRE_EQUAL(monitor.GetLatestFullBuffer(generation), -1);
+
+	int buf = man.GetBufferForWriting(false);
+	uint8_t n = 0;
+	uint8_t data[0x100];
+	std::generate_n(data, 0x100, [&]() { return ++n; });
+	man.Write(buf, data, 0x100);
+	BOOST_REQUIRE_EQUAL(monitor.PeekLatest(peeked, sequence_id), false);
+	man.MarkBufferFull(buf);
+
+	// Peeking does not change the buffer state
+	BOOST_REQUIRE_EQUAL(monitor.PeekLatest(peeked, sequence_id), true);
+	BOOST_REQUIRE_EQUAL(peeked.size(), 0x100);
+	BOOST_REQUIRE_EQUAL(memcmp(peeked.data(), data, 0x100), 0);
+	BOOST_REQUIRE_EQUAL(sequence_id, 1);
+	BOOST_REQUIRE_EQUAL(monitor.GetBuffersOwnedByManager().size(), 0);
+	BOOST_REQUIRE_EQUAL(man2.ReadReadyCount(), 1);
+
+	BOOST_REQUIRE_EQUAL(monitor.GetLatestFullBuffer(generation), buf);
+	BOOST_REQUIRE_EQUAL(monitor.BufferDataSize(buf), 0x100);
+	BOOST_REQUIRE_EQUAL(monitor.PeekIsValid(buf, generation), true);
+
+	auto readbuf = man2.GetBufferForReading();
+	BOOST_REQUIRE_EQUAL(readbuf, buf);
+	man2.MarkBufferEmpty(readbuf);
+
+	// Data which has been consumed can still be peeked until a writer re-uses the buffer
+	BOOST_REQUIRE_EQUAL(monitor.PeekLatest(peeked, sequence_id), true);
+	buf = man.GetBufferForWriting(false);
+	BOOST_REQUIRE_EQUAL(monitor.PeekIsValid(buf, generation), false);
+	BOOST_REQUIRE_EQUAL(monitor.PeekLatest(peeked, sequence_id), false);
+	man.Write(buf, data, 0x80);
+	man.MarkBufferFull(buf);
+	BOOST_REQUIRE_EQUAL(monitor.PeekLatest(peeked, sequence_id), true);
+	BOOST_REQUIRE_EQUAL(peeked.size(), 0x80);
+	BOOST_REQUIRE_EQUAL(sequence_id, 2);
+	TLOG(TLVL_DEBUG) << "END TEST Peek";
+}
+
+BOOST_AUTO_TEST_CASE(ConsumerGroups)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST ConsumerGroups";
+	uint32_t key = GetRandomKey(0x7357);
+	artdaq::SharedMemoryManager man(key, 4, 0x1000, 200000);
+	artdaq::SharedMemoryManager reader(key);
+	artdaq::SharedMemoryManager monitor(key);
+	artdaq::SharedMemoryManager sampler(key);
+
+	auto all = man.AddConsumerGroup();
+	auto sampled = man.AddConsumerGroup(2);
+	BOOST_REQUIRE_EQUAL(all, 1);
+	BOOST_REQUIRE_EQUAL(sampled, 2);
+	BOOST_REQUIRE_EQUAL(monitor.SetConsumerGroup(all), true);
+	BOOST_REQUIRE_EQUAL(sampler.SetConsumerGroup(sampled), true);
+	BOOST_REQUIRE_EQUAL(sampler.SetConsumerGroup(5), false);
+	BOOST_REQUIRE_EQUAL(sampler.GetConsumerGroup(), sampled);
+
+	uint8_t n = 0;
+	uint8_t data[0x100];
+	std::generate_n(data, 0x100, [&]() { return ++n; });
+	for (int ii = 0; ii < 2; ++ii)
+	{
+		auto buf = man.GetBufferForWriting(false);
+		man.Write(buf, data, 0x100);
+		man.MarkBufferFull(buf);
+	}
+	BOOST_REQUIRE_EQUAL(reader.ReadReadyCount(), 2);
+	BOOST_REQUIRE_EQUAL(monitor.ReadReadyCount(), 2);
+	BOOST_REQUIRE_EQUAL(sampler.ReadReadyCount(), 1);
+
+	// A consumer group reads the same buffer as the regular readers, with its own read position
+	auto readbuf = reader.GetBufferForReading();
+	auto monbuf = monitor.GetBufferForReading();
+	BOOST_REQUIRE_EQUAL(monbuf, readbuf);
+	uint8_t out[0x100];
+	BOOST_REQUIRE_EQUAL(reader.Read(readbuf, out, 0x80), true);
+	BOOST_REQUIRE_EQUAL(monitor.Read(monbuf, out, 0x100), true);
+	BOOST_REQUIRE_EQUAL(memcmp(out, data, 0x100), 0);
+	BOOST_REQUIRE_EQUAL(monitor.MoreDataInBuffer(monbuf), false);
+	BOOST_REQUIRE_EQUAL(reader.MoreDataInBuffer(readbuf), true);
+	BOOST_REQUIRE_EQUAL(monitor.CheckBuffer(monbuf, artdaq::SharedMemoryManager::BufferSemaphoreFlags::Reading), true);
+	BOOST_REQUIRE_EQUAL(monitor.ReadReadyCount(), 1);
+
+	// The buffer only returns to Empty once every group has released it
+	reader.MarkBufferEmpty(readbuf);
+	BOOST_REQUIRE_EQUAL(man.WriteReadyCount(false), 2);
+	monitor.MarkBufferEmpty(monbuf);
+	BOOST_REQUIRE_EQUAL(man.WriteReadyCount(false), 3);
+
+	readbuf = reader.GetBufferForReading();
+	reader.MarkBufferEmpty(readbuf);
+	auto samplebuf = sampler.GetBufferForReading();
+	BOOST_REQUIRE_EQUAL(samplebuf, readbuf);
+	BOOST_REQUIRE_EQUAL(sampler.GetBufferForReading(), -1);
+	sampler.MarkBufferEmpty(samplebuf);
+	BOOST_REQUIRE_EQUAL(man.WriteReadyCount(false), 3);
+	monbuf = monitor.GetBufferForReading();
+	BOOST_REQUIRE_EQUAL(monbuf, readbuf);
+	monitor.MarkBufferEmpty(monbuf);
+	BOOST_REQUIRE_EQUAL(man.WriteReadyCount(false), 4);
+
+	// Removing a group drops its references
+	auto buf = man.GetBufferForWriting(false);
+	man.Write(buf, data, 0x100);
+	man.MarkBufferFull(buf);
+	readbuf = reader.GetBufferForReading();
+	reader.MarkBufferEmpty(readbuf);
+	BOOST_REQUIRE_EQUAL(man.WriteReadyCount(false), 3);
+	man.RemoveConsumerGroup(all);
+	BOOST_REQUIRE_EQUAL(man.WriteReadyCount(false), 4);
+	BOOST_REQUIRE_EQUAL(monitor.GetBufferForReading(), -1);
+
+	// References held by a group that stops reading expire with the buffer timeout
+	buf = man.GetBufferForWriting(false);
+	man.Write(buf, data, 0x100);
+	man.MarkBufferFull(buf);
+	readbuf = reader.GetBufferForReading();
+	reader.MarkBufferEmpty(readbuf);
+	BOOST_REQUIRE_EQUAL(man.WriteReadyCount(false), 3);
+	usleep(300000);
+	BOOST_REQUIRE_EQUAL(man.WriteReadyCount(false), 4);
+	BOOST_REQUIRE_EQUAL(sampler.GetBufferForReading(), -1);
+
+	artdaq::SharedMemoryManager broadcast(key + 1, 2, 0x1000, 1000000, false);
+	BOOST_REQUIRE_EQUAL(broadcast.AddConsumerGroup(), -1);
+	TLOG(TLVL_DEBUG) << "END TEST ConsumerGroups";
+}
+
+BOOST_AUTO_TEST_CASE(ConsumerGroupDetach)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST ConsumerGroupDetach";
+	uint32_t key = GetRandomKey(0x7357);
+	artdaq::SharedMemoryManager man(key, 8, 0x1000, 100000000);
+	auto group = man.AddConsumerGroup();
+	BOOST_REQUIRE_EQUAL(man.AddBuffers(8), true);
+	artdaq::SharedMemoryManager other(key);
+	BOOST_REQUIRE_EQUAL(other.SetConsumerGroup(group), true);
+
+	uint8_t data[0x100] = {};
+	auto fill = [&]() {
+		for (int ii = 0; ii < 16; ++ii)
+		{
+			auto buf = man.GetBufferForWriting(false);
+			BOOST_REQUIRE_NE(buf, -1);
+			man.Write(buf, data, 0x100);
+			man.MarkBufferFull(buf);
+		}
+	};
+
+	{
+		artdaq::SharedMemoryManager monitor(key);
+		BOOST_REQUIRE_EQUAL(monitor.SetConsumerGroup(group), true);
+
+		// Claims are released from several threads at once, across both segments
+		fill();
+		std::vector<int> claimed;
+		for (int buf; (buf = monitor.GetBufferForReading()) != -1;)
+		{
+			claimed.push_back(buf);
+		}
+		BOOST_REQUIRE_EQUAL(claimed.size(), 16);
+		std::vector<std::thread> threads;
+		for (size_t tt = 0; tt < 4; ++tt)
+		{
+			threads.emplace_back([&, tt]() {
+				for (size_t ii = tt; ii < claimed.size(); ii += 4)
+				{
+					monitor.MarkBufferEmpty(claimed[ii]);
+				}
+			});
+		}
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+		for (int ii = 0; ii < 16; ++ii)
+		{
+			auto buf = man.GetBufferForReading();
+			man.MarkBufferEmpty(buf);
+		}
+		BOOST_REQUIRE_EQUAL(man.WriteReadyCount(false), 16);
+
+		// The claims still held when the reader goes away are released by Detach, not by the buffer timeout
+		fill();
+		for (int ii = 0; ii < 10; ++ii)
+		{
+			BOOST_REQUIRE_NE(monitor.GetBufferForReading(), -1);
+		}
+		BOOST_REQUIRE_EQUAL(other.ReadReadyCount(), 6);
+	}
+	BOOST_REQUIRE_EQUAL(other.ReadReadyCount(), 16);
+	TLOG(TLVL_DEBUG) << "END TEST ConsumerGroupDetach";
+}
+
+BOOST_AUTO_TEST_CASE(ConsumerGroupOverwrite)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST ConsumerGroupOverwrite";
+	uint32_t key = GetRandomKey(0x7357);
+	artdaq::SharedMemoryManager man(key, 4, 0x1000, 100000000);
+	auto group = man.AddConsumerGroup();
+	artdaq::SharedMemoryManager writer(key);
+	artdaq::SharedMemoryManager monitor(key);
+	BOOST_REQUIRE_EQUAL(monitor.SetConsumerGroup(group), true);
+
+	// Without regular readers, the writer keeps overwriting Full buffers, but never one a group member is reading
+	std::atomic<bool> running(true);
+	std::atomic<size_t> written(0);
+	std::thread writing([&]() {
+		std::vector<uint8_t> data(0x1000);
+		while (running)
+		{
+			auto buf = writer.GetBufferForWriting(true);
+			if (buf == -1)
+			{
+				continue;
+			}
+			std::fill(data.begin(), data.end(), static_cast<uint8_t>(writer.GetSequenceID(buf)));
+			writer.Write(buf, data.data(), data.size());
+			writer.MarkBufferFull(buf);
+			++written;
+		}
+	});
+
+	size_t read = 0;
+	size_t clobbered = 0;
+	std::vector<uint8_t> out(0x1000);
+	auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(500);
+	while (std::chrono::steady_clock::now() < end)
+	{
+		auto buf = monitor.GetBufferForReading();
+		if (buf == -1)
+		{
+			continue;
+		}
+		auto sequence_id = monitor.GetSequenceID(buf);
+		BOOST_REQUIRE(monitor.Read(buf, out.data(), out.size()));
+		for (int ii = 0; ii < 100; ++ii)
+		{
+			std::this_thread::yield();
+		}
+		if (monitor.GetSequenceID(buf) != sequence_id || memcmp(monitor.GetBufferStart(buf), out.data(), out.size()) != 0 ||
+		    std::count(out.begin(), out.end(), out[0]) != static_cast<long>(out.size()))  // NOLINT(google-runtime-int)
+		{
+			++clobbered;
+		}
+		monitor.MarkBufferEmpty(buf);
+		++read;
+	}
+	running = false;
+	writing.join();
+	TLOG(TLVL_INFO) << "ConsumerGroupOverwrite: " << written << " events written, " << read << " read by the group";
+	BOOST_REQUIRE_GT(read, 0);
+	BOOST_REQUIRE_EQUAL(clobbered, 0);
+	TLOG(TLVL_DEBUG) << "END TEST ConsumerGroupOverwrite";
+}
+
+BOOST_AUTO_TEST_CASE(Locality)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST Locality";
+	uint32_t key = GetRandomKey(0x7357);
+	artdaq::SharedMemoryManager writer0(key, 4, 0x1000);
+	artdaq::SharedMemoryManager writer1(key);
+	artdaq::SharedMemoryManager reader0(key);
+	artdaq::SharedMemoryManager reader1(key);
+	writer0.SetLocality(0);
+	writer1.SetLocality(1);
+	reader0.SetLocality(0);
+	reader1.SetLocality(1);
+	BOOST_REQUIRE_GE(artdaq::SharedMemoryManager::CurrentNumaNode(), 0);
+
+	uint8_t data[0x10] = {0};
+	auto write = [&](artdaq::SharedMemoryManager& writer, uint8_t value) {
+		auto buf = writer.GetBufferForWriting(false);
+		BOOST_REQUIRE_NE(buf, -1);
+		data[0] = value;
+		writer.Write(buf, data, sizeof(data));
+		writer.MarkBufferFull(buf);
+	};
+	auto read = [&](artdaq::SharedMemoryManager& reader) {
+		auto buf = reader.GetBufferForReading();
+		BOOST_REQUIRE_NE(buf, -1);
+		BOOST_REQUIRE_EQUAL(reader.Read(buf, data, sizeof(data)), true);
+		reader.MarkBufferEmpty(buf);
+		return data[0];
+	};
+
+	// Readers prefer buffers written with their own locality
+	write(writer1, 1);
+	write(writer0, 0);
+	write(writer1, 1);
+	BOOST_REQUIRE_EQUAL(read(reader0), 0);
+	BOOST_REQUIRE_EQUAL(read(reader1), 1);
+	BOOST_REQUIRE_EQUAL(reader0.GetStolenBufferCount(), 0);
+
+	// ...but take other buffers when none of their own are Full
+	BOOST_REQUIRE_EQUAL(read(reader0), 1);
+	BOOST_REQUIRE_EQUAL(reader0.GetStolenBufferCount(), 1);
+	BOOST_REQUIRE_EQUAL(reader0.GetBufferForReading(), -1);
+
+	// Untagged buffers are taken by any reader without counting as stolen
+	artdaq::SharedMemoryManager untagged(key);
+	write(untagged, 2);
+	BOOST_REQUIRE_EQUAL(read(reader1), 2);
+	BOOST_REQUIRE_EQUAL(reader1.GetStolenBufferCount(), 0);
+	TLOG(TLVL_DEBUG) << "END TEST Locality";
+}
+
+BOOST_AUTO_TEST_CASE(WriteCredits)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST WriteCredits";
+	uint32_t key = GetRandomKey(0x7357);
+	artdaq::SharedMemoryManager writer(key, 4, 0x1000);
+	artdaq::SharedMemoryManager reader(key);
+	BOOST_REQUIRE_EQUAL(writer.GetWriteCredits(), 4);
+	BOOST_REQUIRE_EQUAL(writer.GetConsumptionRate(), 0.0);
+	BOOST_REQUIRE_EQUAL(writer.GetSuggestedWriteRate(), std::numeric_limits<double>::infinity());
+
+	uint8_t data[0x10] = {0};
+	for (int ii = 0; ii < 4; ++ii)
+	{
+		auto buf = writer.GetBufferForWriting(false);
+		writer.Write(buf, data, sizeof(data));
+		writer.MarkBufferFull(buf);
+	}
+	BOOST_REQUIRE_EQUAL(writer.GetWriteCredits(), 0);
+	BOOST_REQUIRE_EQUAL(writer.GetSuggestedWriteRate(), 0.0);
+
+	// Consume at about 40 Hz, refilling as buffers are freed. The accuracy of the published rate depends on
+	// the timing of the host, and is reported by SharedMemoryBenchmark_t instead of checked here.
+	for (int ii = 0; ii < 20; ++ii)
+	{
+		usleep(25000);
+		auto buf = reader.GetBufferForReading();
+		BOOST_REQUIRE_NE(buf, -1);
+		reader.MarkBufferEmpty(buf);
+		BOOST_REQUIRE_EQUAL(writer.GetWriteCredits(), 1);
+		buf = writer.GetBufferForWriting(false);
+		writer.Write(buf, data, sizeof(data));
+		writer.MarkBufferFull(buf);
+	}
+	BOOST_REQUIRE_GT(writer.GetConsumptionRate(), 0.0);
+
+	// With half of the buffers free, the suggestion is the consumption rate (which can only decay meanwhile)
+	for (int ii = 0; ii < 2; ++ii)
+	{
+		reader.MarkBufferEmpty(reader.GetBufferForReading());
+	}
+	BOOST_REQUIRE_EQUAL(writer.GetWriteCredits(), 2);
+	auto rate = writer.GetConsumptionRate();
+	auto suggested = writer.GetSuggestedWriteRate();
+	BOOST_REQUIRE_GT(suggested, 0.0);
+	BOOST_REQUIRE_LE(suggested, rate * 1.00001);
+
+	// Once the readers stop, the published rate decays
+	usleep(1000000);
+	BOOST_REQUIRE_LT(writer.GetConsumptionRate(), rate);
+	TLOG(TLVL_DEBUG) << "END TEST WriteCredits";
+}
+
+BOOST_AUTO_TEST_CASE(SharedWrite)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST SharedWrite";
+	uint32_t key = GetRandomKey(0x7357);
+	const size_t regions = 8;
+	const size_t region_size = 0x100;
+	artdaq::SharedMemoryManager builder(key, 2, 0x10 + regions * region_size);
+	artdaq::SharedMemoryManager reader(key);
+
+	auto buf = builder.GetBufferForWriting(false);
+	BOOST_REQUIRE_NE(buf, -1);
+	BOOST_REQUIRE_EQUAL(builder.ReserveRegion(buf, region_size), nullptr);
+	uint8_t header[0x10] = {0xFF};
+	builder.Write(buf, header, sizeof(header));
+	BOOST_REQUIRE(builder.BeginSharedWrite(buf, regions));
+
+	// Each source appends its fragment through its own manager, in parallel
+	std::atomic<int> failed_reservations(0);
+	std::vector<std::thread> sources;
+	for (size_t ii = 0; ii < regions; ++ii)
+	{
+		sources.emplace_back([&, ii]() {
+			artdaq::SharedMemoryManager source(key);
+			auto region = static_cast<uint8_t*>(source.ReserveRegion(buf, region_size));
+			if (region != nullptr)
+			{
+				memset(region, static_cast<int>(ii), region_size);
+			}
+			else
+			{
+				++failed_reservations;
+			}
+			source.CommitRegion(buf);
+		});
+	}
+	for (auto& source : sources)
+	{
+		source.join();
+	}
+	BOOST_REQUIRE_EQUAL(failed_reservations, 0);
+
+	// A region which does not fit fails without moving the cursor
+	BOOST_REQUIRE_EQUAL(builder.ReserveRegion(buf, 1), nullptr);
+	BOOST_REQUIRE_EQUAL(reader.GetBufferForReading(), buf);
+	BOOST_REQUIRE_EQUAL(reader.BufferDataSize(buf), sizeof(header) + regions * region_size);
+
+	std::vector<uint8_t> data(reader.BufferDataSize(buf));
+	BOOST_REQUIRE(reader.Read(buf, data.data(), data.size()));
+	BOOST_REQUIRE_EQUAL(data[0], 0xFF);
+	std::vector<size_t> counts(regions, 0);
+	for (size_t ii = 0; ii < regions; ++ii)
+	{
+		auto value = data[sizeof(header) + ii * region_size];
+		BOOST_REQUIRE_LT(value, regions);
+		BOOST_REQUIRE_EQUAL(std::count(data.begin() + sizeof(header) + ii * region_size, data.begin() + sizeof(header) + (ii + 1) * region_size, value), region_size);
+		++counts[value];
+	}
+	BOOST_REQUIRE_EQUAL(std::count(counts.begin(), counts.end(), 1), regions);
+	reader.MarkBufferEmpty(buf);
+	BOOST_REQUIRE_EQUAL(builder.CommitRegion(buf), false);
+	TLOG(TLVL_DEBUG) << "END TEST SharedWrite";
+}
+
+BOOST_AUTO_TEST_CASE(DeadWriter)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST DeadWriter";
+	uint32_t key = GetRandomKey(0x7357);
+	artdaq::SharedMemoryManager owner(key, 2, 0x1000, 100000);
+	artdaq::SharedMemoryManager slow_writer(key);
+	BOOST_REQUIRE_NE(slow_writer.GetBufferForWriting(false), -1);
+
+	// A writer process which dies while holding a buffer
+	auto pid = fork();
+	if (pid == 0)
+	{
+		artdaq::SharedMemoryManager writer(key);
+		_exit(writer.GetBufferForWriting(false) == -1 ? 1 : 0);
+	}
+	BOOST_REQUIRE_GT(pid, 0);
+	int status = 0;
+	waitpid(pid, &status, 0);
+	BOOST_REQUIRE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	BOOST_REQUIRE_EQUAL(owner.WriteReadyCount(false), 0);
+
+	// Once timed out, the dead writer's buffer is reclaimed, but the live writer keeps its own
+	usleep(250000);
+	BOOST_REQUIRE_EQUAL(owner.WriteReadyCount(false), 1);
+	auto buf = owner.GetBufferForWriting(false);
+	BOOST_REQUIRE_NE(buf, -1);
+	owner.MarkBufferFull(buf);
+	BOOST_REQUIRE_EQUAL(owner.WriteReadyCount(false), 0);
+	TLOG(TLVL_DEBUG) << "END TEST DeadWriter";
+}
+
+BOOST_AUTO_TEST_CASE(ChainedBuffers)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST ChainedBuffers";
+	uint32_t key = GetRandomKey(0x7357);
+	artdaq::SharedMemoryManager owner(key, 4, 0x1000);
+	artdaq::SharedMemoryManager writer(key);
+	artdaq::SharedMemoryManager reader(key);
+	writer.SetMaxChainLength(3);
+	BOOST_REQUIRE_EQUAL(writer.GetMaxChainLength(), 3);
+
+	std::vector<uint8_t> data(0x2800);
+	for (size_t ii = 0; ii < data.size(); ++ii)
+	{
+		data[ii] = static_cast<uint8_t>(ii * 7);
+	}
+	auto buf = writer.GetBufferForWriting(false);
+	BOOST_REQUIRE_NE(buf, -1);
+	writer.Write(buf, &data[0], 0x800);
+	writer.Write(buf, &data[0x800], data.size() - 0x800);
+	writer.MarkBufferFull(buf);
+
+	// Peeking copies the whole chain
+	std::vector<uint8_t> peeked;
+	size_t sequence_id = 0;
+	BOOST_REQUIRE(reader.PeekLatest(peeked, sequence_id));
+	BOOST_REQUIRE(peeked == data);
+
+	// The continuations are neither readable nor writable on their own
+	BOOST_REQUIRE_EQUAL(reader.ReadReadyCount(), 1);
+	BOOST_REQUIRE_EQUAL(reader.WriteReadyCount(false), 1);
+	BOOST_REQUIRE_EQUAL(reader.GetBufferForReading(), buf);
+	BOOST_REQUIRE_EQUAL(reader.GetBufferForReading(), -1);
+	BOOST_REQUIRE_EQUAL(reader.BufferDataSize(buf), data.size());
+	BOOST_REQUIRE_EQUAL(reader.GetChainLength(buf), 3);
+	auto view = reader.GetGatherView(buf);
+	BOOST_REQUIRE_EQUAL(view.size(), 3);
+	BOOST_REQUIRE_EQUAL(view[0].second, 0x1000);
+	BOOST_REQUIRE_EQUAL(view[1].second, 0x1000);
+	BOOST_REQUIRE_EQUAL(view[2].second, 0x800);
+	BOOST_REQUIRE_EQUAL(memcmp(view[1].first, &data[0x1000], 0x1000), 0);
+
+	std::vector<uint8_t> received(data.size());
+	BOOST_REQUIRE(reader.Read(buf, &received[0], 0x10));
+	BOOST_REQUIRE(reader.Read(buf, &received[0x10], received.size() - 0x10));
+	BOOST_REQUIRE(received == data);
+	BOOST_REQUIRE(!reader.MoreDataInBuffer(buf));
+	reader.MarkBufferEmpty(buf);
+	BOOST_REQUIRE_EQUAL(reader.WriteReadyCount(false), 4);
+
+	// Without chaining, or beyond the maximum chain length, oversized events are still an error
+	artdaq::SharedMemoryManager unchained(key);
+	buf = unchained.GetBufferForWriting(false);
+	BOOST_REQUIRE_THROW(unchained.Write(buf, &data[0], 0x1001), cet::exception);
+	data.resize(0x3001);
+	buf = writer.GetBufferForWriting(false);
+	BOOST_REQUIRE_THROW(writer.Write(buf, &data[0], data.size()), cet::exception);
+	BOOST_REQUIRE_EQUAL(owner.WriteReadyCount(false), 4);
+	TLOG(TLVL_DEBUG) << "END TEST ChainedBuffers";
+}
+
+BOOST_AUTO_TEST_CASE(OccupancyCounters)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST OccupancyCounters";
+	uint32_t key = GetRandomKey(0x7357);
+	artdaq::SharedMemoryManager owner(key, 4, 0x1000);
+	artdaq::SharedMemoryManager writer(key);
+	artdaq::SharedMemoryManager reader(key);
+	BOOST_REQUIRE_EQUAL(reader.WriteReadyCount(false), 4);
+	BOOST_REQUIRE_EQUAL(reader.ReadReadyCount(), 0);
+	BOOST_REQUIRE(!reader.ReadyForRead());
+
+	// One buffer in each state
+	for (int ii = 0; ii < 2; ++ii)
+	{
+		writer.MarkBufferFull(writer.GetBufferForWriting(false));
+	}
+	auto reading = reader.GetBufferForReading();
+	auto writing = writer.GetBufferForWriting(false);
+	BOOST_REQUIRE_NE(writing, -1);
+	BOOST_REQUIRE_EQUAL(reader.ReadReadyCount(), 1);
+	BOOST_REQUIRE(reader.ReadyForRead());
+	BOOST_REQUIRE_EQUAL(reader.WriteReadyCount(false), 1);
+	BOOST_REQUIRE_EQUAL(reader.WriteReadyCount(true), 3);
+	BOOST_REQUIRE_EQUAL(reader.GetWriteCredits(), 1);
+
+	// Detaching returns the reader's buffer to Full and the writer's to Empty
+	reader.Detach();
+	writer.Detach();
+	BOOST_REQUIRE_EQUAL(owner.ReadReadyCount(), 2);
+	BOOST_REQUIRE_EQUAL(owner.WriteReadyCount(false), 2);
+	BOOST_REQUIRE_EQUAL(owner.WriteReadyCount(true), 4);
+	reading = owner.GetBufferForReading();
+	BOOST_REQUIRE_NE(reading, -1);
+	owner.MarkBufferEmpty(reading);
+	BOOST_REQUIRE_EQUAL(owner.ReadReadyCount(), 1);
+	BOOST_REQUIRE_EQUAL(owner.WriteReadyCount(false), 3);
+
+	// A buffer marked Full for a destination makes the readiness queries scan, until it has been read
+	artdaq::SharedMemoryManager destination(key);
+	destination.GetNewId();
+	auto targeted = owner.GetBufferForWriting(false);
+	owner.MarkBufferFull(targeted, destination.GetMyId());
+	BOOST_REQUIRE_EQUAL(owner.GetTargetedFullCount(), 1);
+	BOOST_REQUIRE_EQUAL(owner.ReadReadyCount(), 1);
+	BOOST_REQUIRE_EQUAL(destination.ReadReadyCount(), 2);
+	BOOST_REQUIRE_EQUAL(destination.GetBufferForReading(), targeted);
+	BOOST_REQUIRE_EQUAL(owner.GetTargetedFullCount(), 0);
+	destination.MarkBufferEmpty(targeted);
+	BOOST_REQUIRE_EQUAL(destination.ReadReadyCount(), 1);
+	BOOST_REQUIRE_EQUAL(owner.GetTargetedFullCount(), 0);
+
+	// Also once a targeted buffer is released without being read
+	targeted = owner.GetBufferForWriting(false);
+	owner.MarkBufferFull(targeted, destination.GetMyId());
+	BOOST_REQUIRE_EQUAL(owner.GetTargetedFullCount(), 1);
+	owner.MarkBufferEmpty(targeted, true);
+	BOOST_REQUIRE_EQUAL(owner.GetTargetedFullCount(), 0);
+	BOOST_REQUIRE_EQUAL(owner.ReadReadyCount(), 1);
+	BOOST_REQUIRE_EQUAL(owner.WriteReadyCount(false), 3);
+	TLOG(TLVL_DEBUG) << "END TEST OccupancyCounters";
+}
+
+BOOST_AUTO_TEST_CASE(OwnedBufferTracking)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST OwnedBufferTracking";
+	uint32_t key = GetRandomKey(0x7357);
+	artdaq::SharedMemoryManager owner(key, 24, 0x100);
+	artdaq::SharedMemoryManager writer(key);
+	artdaq::SharedMemoryManager reader(key);
+	reader.GetNewId();
+
+	// Buffers marked Full for a destination belong to it
+	auto buf = writer.GetBufferForWriting(false);
+	BOOST_REQUIRE_EQUAL(writer.GetBuffersOwnedByManager().size(), 1);
+	writer.MarkBufferFull(buf, reader.GetMyId());
+	BOOST_REQUIRE_EQUAL(writer.GetBuffersOwnedByManager().size(), 0);
+	BOOST_REQUIRE_EQUAL(reader.GetBuffersOwnedByManager().size(), 1);
+	BOOST_REQUIRE_EQUAL(reader.GetBufferForReading(), buf);
+	reader.MarkBufferEmpty(buf);
+	BOOST_REQUIRE_EQUAL(reader.GetBuffersOwnedByManager().size(), 0);
+
+	// More buffers than the tracked list holds are found by scanning
+	std::deque<int> claimed;
+	for (int ii = 0; ii < 20; ++ii)
+	{
+		claimed.push_back(writer.GetBufferForWriting(false));
+		BOOST_REQUIRE_NE(claimed.back(), -1);
+	}
+	std::sort(claimed.begin(), claimed.end());
+	BOOST_REQUIRE(writer.GetBuffersOwnedByManager() == claimed);
+
+	// Once the buffers fit again, the list is rebuilt and kept up to date
+	for (int ii = 0; ii < 10; ++ii)
+	{
+		writer.MarkBufferEmpty(claimed.front(), true);
+		claimed.pop_front();
+	}
+	BOOST_REQUIRE(writer.GetBuffersOwnedByManager() == claimed);
+	for (int ii = 0; ii < 4; ++ii)
+	{
+		claimed.push_back(writer.GetBufferForWriting(false));
+		BOOST_REQUIRE_NE(claimed.back(), -1);
+	}
+	writer.MarkBufferEmpty(claimed.front(), true);
+	claimed.pop_front();
+	std::sort(claimed.begin(), claimed.end());
+	BOOST_REQUIRE(writer.GetBuffersOwnedByManager() == claimed);
+	BOOST_REQUIRE(writer.GetBuffersOwnedByManager(false) == claimed);
+	writer.Detach();
+	BOOST_REQUIRE_EQUAL(owner.WriteReadyCount(false), 24);
+	TLOG(TLVL_DEBUG) << "END TEST OwnedBufferTracking";
+}
+
+BOOST_AUTO_TEST_CASE(SequenceLookup)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST SequenceLookup";
+	uint32_t key = GetRandomKey(0x7357);
+	artdaq::SharedMemoryManager owner(key, 4, 0x1000);
+	artdaq::SharedMemoryManager writer(key);
+	artdaq::SharedMemoryManager reader(key);
+
+	std::vector<int> buffers;
+	std::vector<size_t> sequence_ids;
+	for (int ii = 0; ii < 3; ++ii)
+	{
+		auto buf = writer.GetBufferForWriting(false);
+		auto sequence_id = writer.GetSequenceID(buf);
+		BOOST_REQUIRE_EQUAL(reader.FindBuffer(sequence_id), -1);
+		writer.Write(buf, &sequence_id, sizeof(sequence_id));
+		writer.MarkBufferFull(buf);
+		buffers.push_back(buf);
+		sequence_ids.push_back(sequence_id);
+	}
+	BOOST_REQUIRE_EQUAL(reader.FindBuffer(sequence_ids[1]), buffers[1]);
+	BOOST_REQUIRE_EQUAL(reader.FindBuffer(sequence_ids[2] + 1), -1);
+
+	// Targeted retrieval
+	BOOST_REQUIRE_EQUAL(reader.GetBufferForReading(sequence_ids[1]), buffers[1]);
+	size_t data = 0;
+	reader.Read(buffers[1], &data, sizeof(data));
+	BOOST_REQUIRE_EQUAL(data, sequence_ids[1]);
+	BOOST_REQUIRE_EQUAL(reader.FindBuffer(sequence_ids[1]), buffers[1]);
+	BOOST_REQUIRE_EQUAL(writer.GetBufferForReading(sequence_ids[1]), -1);
+	reader.MarkBufferEmpty(buffers[1]);
+	BOOST_REQUIRE_EQUAL(reader.FindBuffer(sequence_ids[1]), -1);
+	BOOST_REQUIRE_EQUAL(reader.GetBufferForReading(sequence_ids[1]), -1);
+	BOOST_REQUIRE_EQUAL(reader.ReadReadyCount(), 2);
+
+	// An event which stays while SEQUENCE_INDEX_SIZE newer ones pass is still found
+	for (size_t ii = 0; ii < artdaq::SharedMemoryManager::SEQUENCE_INDEX_SIZE; ++ii)
+	{
+		auto buf = writer.GetBufferForWriting(false);
+		BOOST_REQUIRE_NE(buf, -1);
+		writer.MarkBufferFull(buf);
+		BOOST_REQUIRE_EQUAL(reader.GetBufferForReading(writer.GetSequenceID(buf)), buf);
+		reader.MarkBufferEmpty(buf);
+	}
+	BOOST_REQUIRE_EQUAL(reader.FindBuffer(sequence_ids[0]), buffers[0]);
+	BOOST_REQUIRE_EQUAL(reader.GetBufferForReading(sequence_ids[0]), buffers[0]);
+	reader.MarkBufferEmpty(buffers[0]);
+	BOOST_REQUIRE_EQUAL(reader.FindBuffer(sequence_ids[2]), buffers[2]);
+	BOOST_REQUIRE_EQUAL(reader.GetBufferForReading(sequence_ids[2]), buffers[2]);
+	reader.MarkBufferEmpty(buffers[2]);
+
+	// Once the evicted events are gone, a scan stops further ones, and later evictions are detected again
+	BOOST_REQUIRE_EQUAL(reader.FindBuffer(sequence_ids[0]), -1);
+	auto kept = writer.GetBufferForWriting(false);
+	auto kept_id = writer.GetSequenceID(kept);
+	writer.MarkBufferFull(kept);
+	BOOST_REQUIRE_EQUAL(reader.FindBuffer(kept_id), kept);
+	for (size_t ii = 0; ii < artdaq::SharedMemoryManager::SEQUENCE_INDEX_SIZE; ++ii)
+	{
+		auto buf = writer.GetBufferForWriting(false);
+		BOOST_REQUIRE_NE(buf, -1);
+		writer.MarkBufferFull(buf);
+		BOOST_REQUIRE_EQUAL(reader.GetBufferForReading(writer.GetSequenceID(buf)), buf);
+		reader.MarkBufferEmpty(buf);
+	}
+	BOOST_REQUIRE_EQUAL(reader.FindBuffer(kept_id), kept);
+	BOOST_REQUIRE_EQUAL(reader.GetBufferForReading(kept_id), kept);
+	reader.MarkBufferEmpty(kept);
+	BOOST_REQUIRE_EQUAL(reader.FindBuffer(kept_id), -1);
+	TLOG(TLVL_DEBUG) << "END TEST SequenceLookup";
+}
+
+BOOST_AUTO_TEST_CASE(WarmRestart)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST WarmRestart";
+	uint32_t key = GetRandomKey(0x7357);
+	auto owner = std::make_unique<artdaq::SharedMemoryManager>(key, 4, 0x1000, 100000, true, true);
+	BOOST_REQUIRE_EQUAL(owner->WasWarmRestarted(), false);
+	artdaq::SharedMemoryManager reader(key);
+
+	for (uint64_t data = 1; data <= 2; ++data)
+	{
+		auto buf = owner->GetBufferForWriting(false);
+		owner->Write(buf, &data, sizeof(data));
+		owner->MarkBufferFull(buf);
+	}
+	// A writer which dies in the middle of an event
+	auto pid = fork();
+	if (pid == 0)
+	{
+		artdaq::SharedMemoryManager writer(key);
+		_exit(writer.GetBufferForWriting(false) == -1 ? 1 : 0);
+	}
+	BOOST_REQUIRE_GT(pid, 0);
+	int status = 0;
+	waitpid(pid, &status, 0);
+	BOOST_REQUIRE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+	// The owner restarts: the Full buffers and their sequence IDs survive, the dead writer's buffer is reset
+	owner.reset();
+	BOOST_REQUIRE(reader.IsValid());
+	owner = std::make_unique<artdaq::SharedMemoryManager>(key, 4, 0x1000, 100000, true, true);
+	BOOST_REQUIRE(owner->IsValid());
+	BOOST_REQUIRE_EQUAL(owner->WasWarmRestarted(), true);
+	BOOST_REQUIRE_EQUAL(owner->ReadReadyCount(), 2);
+	BOOST_REQUIRE_EQUAL(owner->WriteReadyCount(false), 2);
+	BOOST_REQUIRE_EQUAL(owner->GetBufferCount(), 3);
+
+	std::set<uint64_t> received;
+	for (int ii = 0; ii < 2; ++ii)
+	{
+		auto buf = reader.GetBufferForReading();
+		BOOST_REQUIRE_NE(buf, -1);
+		uint64_t data = 0;
+		reader.Read(buf, &data, sizeof(data));
+		received.insert(data);
+		reader.MarkBufferEmpty(buf);
+	}
+	BOOST_REQUIRE(received == std::set<uint64_t>({1, 2}));
+	auto buf = owner->GetBufferForWriting(false);
+	BOOST_REQUIRE_NE(buf, -1);
+	BOOST_REQUIRE_EQUAL(owner->GetBufferCount(), 4);
+	owner->MarkBufferFull(buf);
+
+	// A different layout is never reused
+	owner.reset();
+	artdaq::SharedMemoryManager other(key, 2, 0x1000, 100000, true, true);
+	BOOST_REQUIRE_EQUAL(other.WasWarmRestarted(), false);
+	BOOST_REQUIRE_EQUAL(other.ReadReadyCount(), 0);
+	other.Detach(false, "", "", true);
+	TLOG(TLVL_DEBUG) << "END TEST WarmRestart";
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,163 @@
+#include "artdaq-core/Core/SharedMemoryRecorder.hh"
+#include "artdaq-core/Core/SharedMemoryManager.hh"
+
+#define BOOST_TEST_MODULE SharedMemoryRecorder_t
+#include "cetlib/quiet_unit_test.hpp"
+
+#include <unistd.h>
+#include <cstdlib>
+#include <fstream>
+#include <vector>
+
+#define TRACE_NAME "SharedMemoryRecorder_t"
+#include "SharedMemoryTestShims.hh"
+#include "TRACE/tracemf.h"
+
+namespace {
+struct TempDir
+{
+	TempDir()
+	{
+		char tmpl[] = "/tmp/SharedMemoryRecorder_t_XXXXXX";
+		path = mkdtemp(&tmpl[0]);
+	}
+	~TempDir()
+	{
+		for (auto& file : files)
+		{
+			unlink(file.c_str());
+		}
+		rmdir(path.c_str());
+	}
+	std::string path;
+	std::vector<std::string> files;
+};
+
+void WriteBuffers(artdaq::SharedMemoryManager& shm, size_t count, size_t size)
+{
+	for (size_t ii = 0; ii < count; ++ii)
+	{
+		while (!shm.ReadyForWrite(false))
+		{
+			usleep(100);
+		}
+		auto buf = shm.GetBufferForWriting(false);
+		BOOST_REQUIRE_NE(buf, -1);
+		std::vector<uint64_t> data(size / sizeof(uint64_t), ii);
+		shm.Write(buf, data.data(), size);
+		shm.MarkBufferFull(buf);
+	}
+}
+
+// Returns the number of records in the file, checking that each record's data matches its sequence ID
+size_t CheckFile(std::string const& name, uint64_t& next_sequence_id, size_t size)
+{
+	std::ifstream is(name, std::ios::binary);
+	BOOST_REQUIRE(is.good());
+	size_t records = 0;
+	artdaq::detail::RecordHeader header;
+	while (is.read(reinterpret_cast<char*>(&header), sizeof(header)))  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	{
+		BOOST_REQUIRE_EQUAL(header.magic, artdaq::detail::RecordHeader::MAGIC);
+		BOOST_REQUIRE_EQUAL(header.sequence_id, next_sequence_id);
+		BOOST_REQUIRE_EQUAL(header.data_size, size);
+		std::vector<uint64_t> data(header.data_size / sizeof(uint64_t));
+		is.read(reinterpret_cast<char*>(data.data()), header.data_size);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+		is.seekg(header.RecordSize() - sizeof(header) - header.data_size, std::ios::cur);
+		for (auto word : data)
+		{
+			BOOST_REQUIRE_EQUAL(word, next_sequence_id);
+		}
+		++next_sequence_id;
+		++records;
+	}
+	return records;
+}
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(SharedMemoryRecorder_test)
+
+BOOST_AUTO_TEST_CASE(RolloverByRecords)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST RolloverByRecords";
+	uint32_t key = GetRandomKey(0x7357);
+	artdaq::SharedMemoryManager writer(key, 4, 0x10000);
+	artdaq::SharedMemoryManager reader(key);
+	TempDir dir;
+
+	artdaq::SharedMemoryRecorder::Config config;
+	config.directory = dir.path;
+	config.max_file_records = 3;
+	config.block_size = 0x8000;
+	artdaq::SharedMemoryRecorder recorder(reader, config);
+	BOOST_REQUIRE(recorder.Start());
+	WriteBuffers(writer, 10, 0x10000 - 8);
+	while (writer.WriteReadyCount(false) < 4)
+	{
+		usleep(1000);
+	}
+	recorder.Stop();
+	dir.files = recorder.GetFileNames();
+
+	BOOST_REQUIRE(!recorder.HasError());
+	BOOST_REQUIRE_EQUAL(recorder.GetRecordCount(), 10);
+	BOOST_REQUIRE_EQUAL(recorder.GetBytesWritten(), 10 * (0x10000 - 8 + sizeof(artdaq::detail::RecordHeader)));
+	BOOST_REQUIRE_GT(recorder.GetThroughputGBps(), 0.0);
+	BOOST_REQUIRE_EQUAL(dir.files.size(), 4);
+	uint64_t sequence_id = 0;
+	BOOST_REQUIRE_EQUAL(CheckFile(dir.files[0], sequence_id, 0x10000 - 8), 3);
+	BOOST_REQUIRE_EQUAL(CheckFile(dir.files[1], sequence_id, 0x10000 - 8), 3);
+	BOOST_REQUIRE_EQUAL(CheckFile(dir.files[2], sequence_id, 0x10000 - 8), 3);
+	BOOST_REQUIRE_EQUAL(CheckFile(dir.files[3], sequence_id, 0x10000 - 8), 1);
+	TLOG(TLVL_DEBUG) << "END TEST RolloverByRecords";
+}
+
+BOOST_AUTO_TEST_CASE(RolloverBySize)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST RolloverBySize";
+	uint32_t key = GetRandomKey(0x7357);
+	artdaq::SharedMemoryManager writer(key, 8, 0x1000);
+	artdaq::SharedMemoryManager reader(key);
+	TempDir dir;
+
+	artdaq::SharedMemoryRecorder::Config config;
+	config.directory = dir.path;
+	config.max_file_bytes = 0x4000;
+	config.outstanding_writes = 2;
+	artdaq::SharedMemoryRecorder recorder(reader, config);
+	BOOST_REQUIRE(recorder.Start());
+	WriteBuffers(writer, 20, 0x1000 - 96);
+	while (writer.WriteReadyCount(false) < 8)
+	{
+		usleep(1000);
+	}
+	recorder.Stop();
+	dir.files = recorder.GetFileNames();
+
+	// Each record is 0xFC0 bytes, so four fit in 0x4000
+	BOOST_REQUIRE(!recorder.HasError());
+	BOOST_REQUIRE_EQUAL(dir.files.size(), 5);
+	uint64_t sequence_id = 0;
+	for (auto& file : dir.files)
+	{
+		BOOST_REQUIRE_EQUAL(CheckFile(file, sequence_id, 0x1000 - 96), 4);
+	}
+	BOOST_REQUIRE_EQUAL(sequence_id, 20);
+	TLOG(TLVL_DEBUG) << "END TEST RolloverBySize";
+}
+
+BOOST_AUTO_TEST_CASE(BadDirectory)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST BadDirectory";
+	uint32_t key = GetRandomKey(0x7357);
+	artdaq::SharedMemoryManager shm(key, 2, 0x1000);
+	artdaq::SharedMemoryRecorder::Config config;
+	config.directory = "/nonexistent/SharedMemoryRecorder_t";
+	artdaq::SharedMemoryRecorder recorder(shm, config);
+	BOOST_REQUIRE(!recorder.Start());
+	BOOST_REQUIRE(recorder.HasError());
+	BOOST_REQUIRE(!recorder.IsRunning());
+	TLOG(TLVL_DEBUG) << "END TEST BadDirectory";
+}
+
+BOOST_AUTO_TEST_SUITE_END()
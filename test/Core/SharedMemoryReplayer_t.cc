@@ -0,0 +1,278 @@
+#include "artdaq-core/Core/SharedMemoryReplayer.hh"
+#include "artdaq-core/Core/SharedMemoryManager.hh"
+#include "artdaq-core/Core/SharedMemoryRecorder.hh"
+
+#define BOOST_TEST_MODULE SharedMemoryReplayer_t
+#include "cetlib/quiet_unit_test.hpp"
+
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <vector>
+
+#define TRACE_NAME "SharedMemoryReplayer_t"
+#include "SharedMemoryTestShims.hh"
+#include "TRACE/tracemf.h"
+
+namespace {
+// Writes a file of count records, each filled with its index, with timestamps spaced by spacing_ns
+std::string WriteFile(size_t count, size_t size, uint64_t spacing_ns)
+{
+	char name[] = "/tmp/SharedMemoryReplayer_t_XXXXXX";
+	close(mkstemp(&name[0]));
+	std::ofstream os(&name[0], std::ios::binary);
+	for (size_t ii = 0; ii < count; ++ii)
+	{
+		artdaq::detail::RecordHeader header;
+		header.sequence_id = ii;
+		header.data_size = size;
+		header.timestamp_ns = 1000000000 + ii * spacing_ns;
+		std::vector<uint64_t> data(size / sizeof(uint64_t), ii);
+		os.write(reinterpret_cast<char*>(&header), sizeof(header));  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+		os.write(reinterpret_cast<char*>(data.data()), size);        // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	}
+	return &name[0];
+}
+
+// Reads count buffers, checking that each record was replayed loops times
+// (SharedMemoryManager does not guarantee that Full buffers are read in the order they were written)
+void ReadBuffers(artdaq::SharedMemoryManager& shm, size_t loops, size_t records_per_loop, size_t size)
+{
+	auto count = loops * records_per_loop;
+	std::vector<size_t> seen(records_per_loop, 0);
+	std::vector<uint64_t> data(size / sizeof(uint64_t));
+	for (size_t ii = 0; ii < count; ++ii)
+	{
+		int buf = -1;
+		for (int tries = 0; tries < 5000 && (buf = shm.GetBufferForReading()) == -1; ++tries)
+		{
+			usleep(1000);
+		}
+		BOOST_REQUIRE_NE(buf, -1);
+		BOOST_REQUIRE_EQUAL(shm.BufferDataSize(buf), size);
+		shm.Read(buf, data.data(), size);
+		BOOST_REQUIRE_LT(data[0], records_per_loop);
+		BOOST_REQUIRE_EQUAL(data.back(), data[0]);
+		++seen[data[0]];
+		shm.MarkBufferEmpty(buf);
+	}
+	for (auto times : seen)
+	{
+		BOOST_REQUIRE_EQUAL(times, loops);
+	}
+}
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(SharedMemoryReplayer_test)
+
+BOOST_AUTO_TEST_CASE(FixedRateLoop)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST FixedRateLoop";
+	uint32_t key = GetRandomKey(0x7357);
+	artdaq::SharedMemoryManager writer(key, 4, 0x1000);
+	artdaq::SharedMemoryManager reader(key);
+	auto file = WriteFile(10, 0x800, 1000);
+
+	artdaq::SharedMemoryReplayer::Config config;
+	config.files = {file};
+	config.rate_hz = 250;
+	config.multiplier = 2.0;
+	config.loops = 3;
+	artdaq::SharedMemoryReplayer replayer(writer, config);
+	BOOST_REQUIRE(replayer.Start());
+	ReadBuffers(reader, 3, 10, 0x800);
+	while (replayer.IsRunning())
+	{
+		usleep(1000);
+	}
+
+	BOOST_REQUIRE_EQUAL(replayer.GetEventCount(), 30);
+	BOOST_REQUIRE_EQUAL(replayer.GetBytesWritten(), 30 * 0x800);
+	BOOST_REQUIRE_EQUAL(replayer.GetTargetRateHz(), 500.0);
+	BOOST_REQUIRE_CLOSE(replayer.GetTargetThroughputGBps(), 500.0 * 0x800 / 1e9, 0.001);
+	TLOG(TLVL_INFO) << "Achieved " << replayer.GetAchievedRateHz() << " Hz";
+	BOOST_REQUIRE_GT(replayer.GetAchievedRateHz(), 250.0);
+	BOOST_REQUIRE_LT(replayer.GetAchievedRateHz(), 510.0);
+	unlink(file.c_str());
+	TLOG(TLVL_DEBUG) << "END TEST FixedRateLoop";
+}
+
+BOOST_AUTO_TEST_CASE(Bursty)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST Bursty";
+	uint32_t key = GetRandomKey(0x7357);
+	artdaq::SharedMemoryManager writer(key, 10, 0x1000);
+	artdaq::SharedMemoryManager reader(key);
+	auto file = WriteFile(20, 0x100, 1000);
+
+	artdaq::SharedMemoryReplayer::Config config;
+	config.files = {file};
+	config.mode = artdaq::SharedMemoryReplayer::ReplayMode::Bursty;
+	config.rate_hz = 100;
+	config.burst_size = 5;
+	artdaq::SharedMemoryReplayer replayer(writer, config);
+	BOOST_REQUIRE(replayer.Start());
+
+	// The first burst arrives at once, the next one 50 ms later
+	usleep(20000);
+	BOOST_REQUIRE_EQUAL(replayer.GetEventCount(), 5);
+	ReadBuffers(reader, 1, 20, 0x100);
+	replayer.Stop();
+	BOOST_REQUIRE_EQUAL(replayer.GetEventCount(), 20);
+	// Measured from the first to the last record: 19 records over three burst intervals
+	BOOST_REQUIRE_GT(replayer.GetAchievedRateHz(), 60.0);
+	BOOST_REQUIRE_LT(replayer.GetAchievedRateHz(), 130.0);
+	unlink(file.c_str());
+	TLOG(TLVL_DEBUG) << "END TEST Bursty";
+}
+
+BOOST_AUTO_TEST_CASE(AsRecorded)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST AsRecorded";
+	uint32_t key = GetRandomKey(0x7357);
+	artdaq::SharedMemoryManager writer(key, 4, 0x1000);
+	artdaq::SharedMemoryManager reader(key);
+	auto file1 = WriteFile(10, 0x400, 10000000);
+	auto file2 = WriteFile(10, 0x400, 10000000);
+
+	artdaq::SharedMemoryReplayer::Config config;
+	config.files = {file1, file2};
+	config.mode = artdaq::SharedMemoryReplayer::ReplayMode::AsRecorded;
+	config.multiplier = 4.0;
+	artdaq::SharedMemoryReplayer replayer(writer, config);
+	BOOST_REQUIRE(replayer.Start());
+
+	// Recorded at 100 Hz, replayed at 400 Hz. The second file restarts the timestamps, which is replayed without a gap.
+	auto start = std::chrono::steady_clock::now();
+	ReadBuffers(reader, 2, 10, 0x400);
+	auto elapsed = artdaq::TimeUtils::GetElapsedTime(start);
+	BOOST_REQUIRE_GT(elapsed, 0.035);
+	BOOST_REQUIRE_LT(elapsed, 1.0);
+	replayer.Stop();
+	BOOST_REQUIRE_EQUAL(replayer.GetEventCount(), 20);
+	unlink(file1.c_str());
+	unlink(file2.c_str());
+	TLOG(TLVL_DEBUG) << "END TEST AsRecorded";
+}
+
+BOOST_AUTO_TEST_CASE(RecordAndReplay)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST RecordAndReplay";
+	uint32_t key = GetRandomKey(0x7357);
+	char dir[] = "/tmp/SharedMemoryReplayer_t_XXXXXX";
+	mkdtemp(&dir[0]);
+
+	std::vector<std::string> files;
+	{
+		artdaq::SharedMemoryManager writer(key, 4, 0x1000);
+		artdaq::SharedMemoryManager reader(key);
+		artdaq::SharedMemoryRecorder::Config config;
+		config.directory = &dir[0];
+		config.max_file_records = 4;
+		artdaq::SharedMemoryRecorder recorder(reader, config);
+		BOOST_REQUIRE(recorder.Start());
+		for (uint64_t ii = 0; ii < 10; ++ii)
+		{
+			int buf = -1;
+			while ((buf = writer.GetBufferForWriting(false)) == -1)
+			{
+				usleep(100);
+			}
+			std::vector<uint64_t> data(0x80, ii);
+			writer.Write(buf, data.data(), 0x400);
+			writer.MarkBufferFull(buf);
+		}
+		while (writer.WriteReadyCount(false) < 4)
+		{
+			usleep(1000);
+		}
+		recorder.Stop();
+		files = recorder.GetFileNames();
+	}
+
+	artdaq::SharedMemoryManager writer(key + 1, 4, 0x1000);
+	artdaq::SharedMemoryManager reader(key + 1);
+	artdaq::SharedMemoryReplayer::Config config;
+	config.files = files;
+	config.loops = 3;
+	artdaq::SharedMemoryReplayer replayer(writer, config);
+	BOOST_REQUIRE(replayer.Start());
+	ReadBuffers(reader, 3, 10, 0x400);
+	replayer.Stop();
+	BOOST_REQUIRE_EQUAL(replayer.GetEventCount(), 30);
+
+	for (auto& file : files)
+	{
+		unlink(file.c_str());
+	}
+	rmdir(&dir[0]);
+	TLOG(TLVL_DEBUG) << "END TEST RecordAndReplay";
+}
+
+BOOST_AUTO_TEST_CASE(ChainedRecords)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST ChainedRecords";
+	uint32_t key = GetRandomKey(0x7357);
+	artdaq::SharedMemoryManager writer(key, 8, 0x1000);
+	artdaq::SharedMemoryManager reader(key);
+	writer.SetMaxChainLength(2);
+	auto file = WriteFile(3, 0x1800, 1000);
+	auto oversized = WriteFile(1, 0x2008, 1000);
+
+	// Records larger than one buffer are replayed as chained events, up to the maximum chain length
+	artdaq::SharedMemoryReplayer::Config config;
+	config.files = {file, oversized};
+	config.loops = 1;
+	artdaq::SharedMemoryReplayer replayer(writer, config);
+	BOOST_REQUIRE(replayer.Start());
+	ReadBuffers(reader, 1, 3, 0x1800);
+	while (replayer.IsRunning())
+	{
+		usleep(1000);
+	}
+	BOOST_REQUIRE_EQUAL(replayer.GetEventCount(), 3);
+	BOOST_REQUIRE_EQUAL(replayer.GetSkippedCount(), 1);
+	unlink(file.c_str());
+	unlink(oversized.c_str());
+	TLOG(TLVL_DEBUG) << "END TEST ChainedRecords";
+}
+
+BOOST_AUTO_TEST_CASE(MissingFile)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST MissingFile";
+	uint32_t key = GetRandomKey(0x7357);
+	artdaq::SharedMemoryManager shm(key, 2, 0x1000);
+	artdaq::SharedMemoryReplayer::Config config;
+	config.files = {"/nonexistent/SharedMemoryReplayer_t.dat"};
+	artdaq::SharedMemoryReplayer replayer(shm, config);
+	BOOST_REQUIRE(!replayer.Start());
+	BOOST_REQUIRE(!replayer.IsRunning());
+	TLOG(TLVL_DEBUG) << "END TEST MissingFile";
+}
+
+BOOST_AUTO_TEST_CASE(NoRecords)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST NoRecords";
+	uint32_t key = GetRandomKey(0x7357);
+	artdaq::SharedMemoryManager shm(key, 2, 0x1000);
+	auto empty = WriteFile(0, 0x800, 1000);
+	auto garbage = WriteFile(0, 0x800, 1000);
+	{
+		std::ofstream os(garbage, std::ios::binary);
+		os << "not a recording";
+	}
+
+	// With nothing to replay, an endless replay would only spin
+	artdaq::SharedMemoryReplayer::Config config;
+	config.files = {empty, garbage};
+	config.loops = 0;
+	artdaq::SharedMemoryReplayer replayer(shm, config);
+	BOOST_REQUIRE(!replayer.Start());
+	BOOST_REQUIRE(!replayer.IsRunning());
+	remove(empty.c_str());
+	remove(garbage.c_str());
+	TLOG(TLVL_DEBUG) << "END TEST NoRecords";
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,123 @@
+#include "artdaq-core/Core/SharedMemorySelector.hh"
+#include "artdaq-core/Core/SharedMemoryManager.hh"
+
+#define BOOST_TEST_MODULE SharedMemorySelector_t
+#include "cetlib/quiet_unit_test.hpp"
+
+#include <unistd.h>
+#include <thread>
+
+#define TRACE_NAME "SharedMemorySelector_t"
+#include "SharedMemoryTestShims.hh"
+#include "TRACE/tracemf.h"
+#include "artdaq-core/Utilities/TimeUtils.hh"
+
+namespace {
+void WriteOne(artdaq::SharedMemoryManager& shm)
+{
+	auto buf = shm.GetBufferForWriting(false);
+	BOOST_REQUIRE_NE(buf, -1);
+	uint64_t data = 0x5E1EC7;
+	shm.Write(buf, &data, sizeof(data));
+	shm.MarkBufferFull(buf);
+}
+
+void ReadOne(artdaq::SharedMemoryManager& shm)
+{
+	auto buf = shm.GetBufferForReading();
+	BOOST_REQUIRE_NE(buf, -1);
+	shm.MarkBufferEmpty(buf);
+}
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(SharedMemorySelector_test)
+
+BOOST_AUTO_TEST_CASE(Priority)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST Priority";
+	uint32_t high_key = GetRandomKey(0x5E1);
+	uint32_t low_key = GetRandomKey(0x5E2);
+	artdaq::SharedMemoryManager high_writer(high_key, 4, 0x1000);
+	artdaq::SharedMemoryManager low_writer(low_key, 4, 0x1000);
+	artdaq::SharedMemoryManager high(high_key);
+	artdaq::SharedMemoryManager low(low_key);
+
+	artdaq::SharedMemorySelector selector;
+	BOOST_REQUIRE_EQUAL(selector.AddLane(high), 0);
+	BOOST_REQUIRE_EQUAL(selector.AddLane(low), 1);
+	BOOST_REQUIRE_EQUAL(selector.Select(0), -1);
+
+	WriteOne(low_writer);
+	WriteOne(high_writer);
+	WriteOne(high_writer);
+	BOOST_REQUIRE_EQUAL(selector.Select(0), 0);
+	ReadOne(high);
+	BOOST_REQUIRE_EQUAL(selector.Select(0), 0);
+	ReadOne(high);
+	BOOST_REQUIRE_EQUAL(selector.Select(0), 1);
+	BOOST_REQUIRE_EQUAL(selector.Select(0, 1), -1);
+	ReadOne(low);
+	BOOST_REQUIRE_EQUAL(selector.Select(0), -1);
+	TLOG(TLVL_DEBUG) << "END TEST Priority";
+}
+
+BOOST_AUTO_TEST_CASE(IdleLanesAreNotScanned)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST IdleLanesAreNotScanned";
+	uint32_t key = GetRandomKey(0x5E1);
+	artdaq::SharedMemoryManager writer(key, 4, 0x1000);
+	artdaq::SharedMemoryManager reader(key);
+
+	artdaq::SharedMemorySelector selector(1000, 10000000);
+	selector.AddLane(reader);
+	BOOST_REQUIRE_EQUAL(selector.Select(0), -1);
+	auto scans = selector.GetScanCount(0);
+	for (int ii = 0; ii < 100; ++ii)
+	{
+		BOOST_REQUIRE_EQUAL(selector.Select(0), -1);
+	}
+	BOOST_REQUIRE_EQUAL(selector.GetScanCount(0), scans);
+
+	WriteOne(writer);
+	BOOST_REQUIRE_EQUAL(selector.Select(0), 0);
+	BOOST_REQUIRE_EQUAL(selector.GetScanCount(0), scans + 1);
+	TLOG(TLVL_DEBUG) << "END TEST IdleLanesAreNotScanned";
+}
+
+BOOST_AUTO_TEST_CASE(Blocking)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST Blocking";
+	uint32_t high_key = GetRandomKey(0x5E1);
+	uint32_t low_key = GetRandomKey(0x5E2);
+	artdaq::SharedMemoryManager high_writer(high_key, 4, 0x1000);
+	artdaq::SharedMemoryManager low_writer(low_key, 4, 0x1000);
+	artdaq::SharedMemoryManager high(high_key);
+	artdaq::SharedMemoryManager low(low_key);
+
+	artdaq::SharedMemorySelector selector;
+	selector.AddLane(high);
+	selector.AddLane(low);
+
+	auto start = artdaq::TimeUtils::gettimeofday_us();
+	BOOST_REQUIRE_EQUAL(selector.Select(50000), -1);
+	BOOST_REQUIRE_GE(artdaq::TimeUtils::gettimeofday_us() - start, 50000);
+
+	// A writer on the blocked (lowest-priority) lane wakes the selector up
+	std::thread low_thread([&]() { usleep(50000); WriteOne(low_writer); });
+	start = artdaq::TimeUtils::gettimeofday_us();
+	BOOST_REQUIRE_EQUAL(selector.Select(5000000), 1);
+	BOOST_REQUIRE_LT(artdaq::TimeUtils::gettimeofday_us() - start, 1000000);
+	low_thread.join();
+	ReadOne(low);
+
+	// Higher-priority lanes are noticed while blocked
+	std::thread high_thread([&]() { usleep(50000); WriteOne(high_writer); });
+	start = artdaq::TimeUtils::gettimeofday_us();
+	BOOST_REQUIRE_EQUAL(selector.Select(5000000), 0);
+	BOOST_REQUIRE_LT(artdaq::TimeUtils::gettimeofday_us() - start, 1000000);
+	high_thread.join();
+	ReadOne(high);
+	TLOG(TLVL_DEBUG) << "END TEST Blocking";
+}
+
+BOOST_AUTO_TEST_SUITE_END()
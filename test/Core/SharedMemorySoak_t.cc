@@ -0,0 +1,516 @@
+// Soak and fault-injection test for SharedMemoryManager.
+//
+// Runs writer and reader processes against one segment for a long time, while randomly killing (SIGKILL, then
+// restarting), stopping for longer than the buffer timeout (SIGSTOP/SIGCONT) or briefly delaying participants.
+// Checks that the read rate recovers after each fault, that no committed event is lost or corrupted, and that
+// every buffer is Empty again once the participants have stopped and the remaining events have been drained.
+// Prints one JSON document, including the time-to-recovery for each fault type. Not run by ctest:
+//
+//   SharedMemorySoak_t [--writers N] [--readers M] [--duration-s T] [--buffers N] [--buffer-size B]
+//                      [--timeout-ms T] [--fault-interval-ms T] [--recovery-fraction F] [--seed S] [--output file.json]
+
+#define TRACE_NAME "SharedMemorySoak_t"
+#include "TRACE/tracemf.h"
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SharedMemoryTestShims.hh"
+#include "artdaq-core/Core/SharedMemoryManager.hh"
+#include "cetlib_except/exception.h"
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t MAX_WRITERS = 16;
+constexpr size_t SEEN_WINDOW = 1 << 18;  ///< Events remembered per writer for duplicate detection
+constexpr uint64_t RECORD_MAGIC = 0x50A4CAFE50A4CAFE;
+constexpr auto SAMPLE_INTERVAL = std::chrono::milliseconds(20);
+constexpr auto RATE_WINDOW = std::chrono::milliseconds(250);  ///< Throughput is averaged over this window
+
+struct Options
+{
+	size_t writers{2};
+	size_t readers{2};
+	size_t duration_s{60};
+	size_t buffer_count{16};
+	size_t buffer_size{0x10000};
+	size_t timeout_ms{500};
+	size_t fault_interval_ms{2000};
+	double recovery_fraction{0.8};
+	uint64_t seed{0};
+	std::string output;
+};
+
+enum class Fault
+{
+	Kill,   ///< SIGKILL, then start a replacement
+	Stop,   ///< SIGSTOP for twice the buffer timeout, so that held buffers are reset
+	Delay,  ///< SIGSTOP for a quarter of the buffer timeout
+};
+constexpr size_t FAULT_TYPES = 3;
+char const* const FAULT_NAMES[FAULT_TYPES] = {"kill", "stop", "delay"};
+
+struct RecordHeader
+{
+	uint64_t magic;
+	uint64_t writer;
+	uint64_t sequence;
+	uint64_t words;
+	uint64_t check;
+
+	uint64_t Check() const { return magic ^ (writer * 0x100000001B3) ^ (sequence * 0x9E3779B97F4A7C15) ^ words; }
+};
+
+uint64_t payloadWord(uint64_t sequence, uint64_t index) { return (sequence * 0x9E3779B97F4A7C15) ^ (index * 0xC2B2AE3D27D4EB4F); }
+
+struct WriterSlot
+{
+	std::atomic<uint64_t> next_sequence{0};  ///< Shared with restarted writers, so that sequences keep increasing
+	std::atomic<uint64_t> committed{0};      ///< Events marked Full
+	std::atomic<uint64_t> unique_read{0};
+};
+
+/// Counters shared by all participants, in an anonymous mapping created before forking
+struct SharedState
+{
+	std::atomic<bool> running{true};
+	std::atomic<uint64_t> events_read{0};
+	std::atomic<uint64_t> duplicates{0};
+	std::atomic<uint64_t> corrupt{0};
+	std::atomic<uint64_t> phantom{0};    ///< Valid-looking records with a sequence that was never allocated
+	std::atomic<uint64_t> evictions{0};  ///< Buffers taken away from a reader after it was stopped for too long
+	WriterSlot writers[MAX_WRITERS];
+	std::atomic<uint64_t> seen[MAX_WRITERS][SEEN_WINDOW];  ///< sequence + 1 of the last event read in each slot
+};
+
+struct FaultStats
+{
+	uint64_t count{0};
+	uint64_t recovered{0};
+	double total_recovery_ms{0.0};
+	double max_recovery_ms{0.0};
+};
+
+/// Check a record and account for it. Returns false if the buffer does not hold a valid record.
+bool consumeRecord(SharedState* state, Options const& options, uint8_t const* data, size_t size)
+{
+	RecordHeader header;
+	if (size < sizeof(header))
+	{
+		return false;
+	}
+	memcpy(&header, data, sizeof(header));
+	if (header.magic != RECORD_MAGIC || header.check != header.Check() || header.writer >= options.writers ||
+	    size != sizeof(header) + header.words * sizeof(uint64_t))
+	{
+		return false;
+	}
+	auto words = reinterpret_cast<uint64_t const*>(data + sizeof(header));  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	for (uint64_t ii = 0; ii < header.words; ++ii)
+	{
+		if (words[ii] != payloadWord(header.sequence, ii))
+		{
+			return false;
+		}
+	}
+
+	auto& slot = state->writers[header.writer];
+	if (header.sequence >= slot.next_sequence)
+	{
+		++state->phantom;
+	}
+	else if (state->seen[header.writer][header.sequence % SEEN_WINDOW].exchange(header.sequence + 1) == header.sequence + 1)
+	{
+		++state->duplicates;
+	}
+	else
+	{
+		++slot.unique_read;
+	}
+	++state->events_read;
+	return true;
+}
+
+void runWriter(SharedState* state, Options const& options, uint32_t key, size_t index)
+{
+	artdaq::SharedMemoryManager shm(key);
+	std::mt19937_64 rng(options.seed + index + getpid());
+	auto max_words = (options.buffer_size - sizeof(RecordHeader)) / sizeof(uint64_t);
+	std::uniform_int_distribution<size_t> words_dist(0, max_words);
+	std::vector<uint64_t> record(sizeof(RecordHeader) / sizeof(uint64_t) + max_words);
+	auto& slot = state->writers[index];
+
+	while (state->running)
+	{
+		auto waiter = shm.GetWaitPolicy().MakeWaiter();
+		int buf = -1;
+		while ((buf = shm.GetBufferForWriting(false)) == -1 && state->running)
+		{
+			waiter.Wait();
+		}
+		if (buf == -1)
+		{
+			break;
+		}
+
+		// The sequence is allocated once a buffer is held, so that a killed writer loses at most the event it was writing
+		RecordHeader header = {RECORD_MAGIC, index, slot.next_sequence++, words_dist(rng), 0};
+		header.check = header.Check();
+		memcpy(record.data(), &header, sizeof(header));
+		auto words = record.data() + sizeof(header) / sizeof(uint64_t);
+		for (uint64_t ii = 0; ii < header.words; ++ii)
+		{
+			words[ii] = payloadWord(header.sequence, ii);
+		}
+		shm.Write(buf, record.data(), sizeof(header) + header.words * sizeof(uint64_t));
+		shm.MarkBufferFull(buf);
+		++slot.committed;
+	}
+}
+
+void runReader(SharedState* state, Options const& options, uint32_t key)
+{
+	auto shm = std::make_unique<artdaq::SharedMemoryManager>(key);
+	while (state->running)
+	{
+		try
+		{
+			auto waiter = shm->GetWaitPolicy().MakeWaiter();
+			int buf = -1;
+			while ((buf = shm->GetBufferForReading()) == -1 && state->running)
+			{
+				waiter.Wait();
+			}
+			if (buf == -1)
+			{
+				break;
+			}
+			auto data = static_cast<uint8_t const*>(shm->GetReadPos(buf));
+			if (!consumeRecord(state, options, data, shm->BufferDataSize(buf)))
+			{
+				// A buffer taken away while it was being read may have been overwritten in the meantime
+				if (shm->CheckBuffer(buf, artdaq::SharedMemoryManager::BufferSemaphoreFlags::Reading))
+				{
+					TLOG(TLVL_ERROR) << "Reader " << getpid() << ": corrupt record in buffer " << buf;
+					++state->corrupt;
+				}
+			}
+			shm->MarkBufferEmpty(buf);
+		}
+		catch (cet::exception const& ex)
+		{
+			// MarkBufferEmpty detaches and throws when the buffer was reset while this reader was stopped
+			TLOG(TLVL_INFO) << "Reader " << getpid() << " lost its buffer (" << ex.category() << "), re-attaching";
+			++state->evictions;
+			shm = std::make_unique<artdaq::SharedMemoryManager>(key);
+		}
+	}
+}
+
+pid_t spawn(SharedState* state, Options const& options, uint32_t key, size_t index)
+{
+	auto pid = fork();
+	if (pid == 0)
+	{
+		if (index < options.writers)
+		{
+			runWriter(state, options, key, index);
+		}
+		else
+		{
+			runReader(state, options, key);
+		}
+		_exit(0);
+	}
+	return pid;
+}
+
+/// Samples the total read count, to measure throughput over a sliding window
+class RateMonitor
+{
+public:
+	explicit RateMonitor(SharedState* state)
+	    : state_(state) {}
+
+	/// Record a sample and return the rate over the last RATE_WINDOW, or -1 if the window is not yet full
+	double Sample()
+	{
+		auto now = Clock::now();
+		samples_.emplace_back(now, state_->events_read.load());
+		while (samples_.size() > 2 && now - samples_[1].first >= RATE_WINDOW)
+		{
+			samples_.pop_front();
+		}
+		auto span = now - samples_.front().first;
+		if (span < RATE_WINDOW)
+		{
+			return -1.0;
+		}
+		return (samples_.back().second - samples_.front().second) / std::chrono::duration<double>(span).count();
+	}
+
+	/// Forget older samples, so that the next full window starts now
+	void Reset() { samples_.clear(); }
+
+private:
+	SharedState* state_;
+	std::deque<std::pair<Clock::time_point, uint64_t>> samples_;
+};
+
+std::string faultJson(FaultStats const& stats)
+{
+	std::ostringstream ostr;
+	ostr << "{\"count\": " << stats.count << ", \"recovered\": " << stats.recovered
+	     << ", \"mean_recovery_ms\": " << (stats.recovered > 0 ? stats.total_recovery_ms / stats.recovered : 0.0)
+	     << ", \"max_recovery_ms\": " << stats.max_recovery_ms << "}";
+	return ostr.str();
+}
+
+int runSoak(Options const& options)
+{
+	auto key = GetRandomKey(0x50A4);
+	artdaq::SharedMemoryManager owner(key, options.buffer_count, options.buffer_size, options.timeout_ms * 1000);
+
+	auto mapping = mmap(nullptr, sizeof(SharedState), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (mapping == MAP_FAILED)  // NOLINT(cppcoreguidelines-pro-type-cstyle-cast)
+	{
+		std::cerr << "Unable to map the shared counters" << std::endl;
+		return 1;
+	}
+	auto state = new (mapping) SharedState();
+
+	std::vector<pid_t> participants;
+	for (size_t ii = 0; ii < options.writers + options.readers; ++ii)
+	{
+		participants.push_back(spawn(state, options, key, ii));
+	}
+
+	std::mt19937_64 rng(options.seed);
+	std::uniform_int_distribution<size_t> participant_dist(0, participants.size() - 1);
+	std::uniform_int_distribution<size_t> fault_dist(0, FAULT_TYPES - 1);
+	std::uniform_int_distribution<size_t> interval_dist(options.fault_interval_ms / 2, options.fault_interval_ms * 3 / 2);
+	auto recovery_timeout = std::chrono::milliseconds(std::max(options.fault_interval_ms, options.timeout_ms * 4));
+	auto deadline = Clock::now() + std::chrono::seconds(options.duration_s);
+
+	// Baseline throughput, before any fault
+	RateMonitor monitor(state);
+	auto warmup_start = Clock::now();
+	auto warmup_count = state->events_read.load();
+	std::this_thread::sleep_for(std::chrono::milliseconds(options.fault_interval_ms));
+	auto baseline = (state->events_read - warmup_count) / std::chrono::duration<double>(Clock::now() - warmup_start).count();
+	TLOG(TLVL_INFO) << "Baseline read rate " << baseline << " Hz";
+
+	FaultStats faults[FAULT_TYPES];
+	uint64_t reader_faults = 0;
+	while (Clock::now() < deadline)
+	{
+		auto target = static_cast<size_t>(participant_dist(rng));
+		auto fault = static_cast<Fault>(fault_dist(rng));
+		auto& stats = faults[static_cast<size_t>(fault)];
+		++stats.count;
+		if (target >= options.writers && fault != Fault::Delay)
+		{
+			++reader_faults;
+		}
+		TLOG(TLVL_INFO) << "Injecting " << FAULT_NAMES[static_cast<size_t>(fault)] << " into " << (target < options.writers ? "writer " : "reader ") << participants[target];
+		switch (fault)
+		{
+			case Fault::Kill:
+				kill(participants[target], SIGKILL);
+				waitpid(participants[target], nullptr, 0);
+				participants[target] = spawn(state, options, key, target);
+				break;
+			case Fault::Stop:
+			case Fault::Delay:
+				kill(participants[target], SIGSTOP);
+				std::this_thread::sleep_for(std::chrono::milliseconds(fault == Fault::Stop ? options.timeout_ms * 2 : options.timeout_ms / 4));
+				kill(participants[target], SIGCONT);
+				break;
+		}
+
+		// Time-to-recovery: from the end of the fault to the start of the first window at the required rate
+		auto fault_end = Clock::now();
+		monitor.Reset();
+		while (Clock::now() - fault_end < recovery_timeout)
+		{
+			std::this_thread::sleep_for(SAMPLE_INTERVAL);
+			auto rate = monitor.Sample();
+			if (rate >= baseline * options.recovery_fraction)
+			{
+				auto recovery_ms = std::max(0.0, std::chrono::duration<double, std::milli>(Clock::now() - RATE_WINDOW - fault_end).count());
+				++stats.recovered;
+				stats.total_recovery_ms += recovery_ms;
+				stats.max_recovery_ms = std::max(stats.max_recovery_ms, recovery_ms);
+				TLOG(TLVL_INFO) << "Recovered after " << recovery_ms << " ms, read rate " << rate << " Hz";
+				break;
+			}
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(interval_dist(rng)));
+	}
+
+	// Stop everyone, then let the buffers held by killed or evicted participants time out and drain what is left
+	state->running = false;
+	for (auto pid : participants)
+	{
+		kill(pid, SIGCONT);
+		waitpid(pid, nullptr, 0);
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(options.timeout_ms * 2));
+	int buf = -1;
+	while ((buf = owner.GetBufferForReading()) != -1)
+	{
+		if (!consumeRecord(state, options, static_cast<uint8_t const*>(owner.GetReadPos(buf)), owner.BufferDataSize(buf)))
+		{
+			++state->corrupt;
+		}
+		owner.MarkBufferEmpty(buf);
+	}
+	auto leaked = owner.size() - owner.WriteReadyCount(false);
+	if (leaked > 0)
+	{
+		TLOG(TLVL_ERROR) << leaked << " buffers were not returned to the Empty state:" << std::endl
+		                 << owner.toString();
+	}
+
+	uint64_t committed = 0;
+	uint64_t unique = 0;
+	uint64_t lost = 0;
+	for (size_t ii = 0; ii < options.writers; ++ii)
+	{
+		auto& slot = state->writers[ii];
+		committed += slot.committed;
+		unique += slot.unique_read;
+		// A writer killed between MarkBufferFull and counting the event leaves more events read than committed
+		lost += slot.committed > slot.unique_read ? slot.committed - slot.unique_read : 0;
+	}
+	uint64_t not_recovered = 0;
+	for (auto& stats : faults)
+	{
+		not_recovered += stats.count - stats.recovered;
+	}
+	// A reader which is killed or stopped for too long gives its buffer back, so it may be read once more
+	auto ok = leaked == 0 && lost == 0 && state->corrupt == 0 && state->phantom == 0 && state->duplicates <= reader_faults && not_recovered == 0;
+
+	std::ostringstream json;
+	json << "{\n  \"soak\": \"SharedMemorySoak\",\n"
+	     << "  \"writers\": " << options.writers << ",\n"
+	     << "  \"readers\": " << options.readers << ",\n"
+	     << "  \"duration_s\": " << options.duration_s << ",\n"
+	     << "  \"buffer_count\": " << options.buffer_count << ",\n"
+	     << "  \"buffer_size\": " << options.buffer_size << ",\n"
+	     << "  \"buffer_timeout_ms\": " << options.timeout_ms << ",\n"
+	     << "  \"seed\": " << options.seed << ",\n"
+	     << "  \"baseline_read_rate_hz\": " << baseline << ",\n"
+	     << "  \"events_committed\": " << committed << ",\n"
+	     << "  \"events_read\": " << state->events_read << ",\n"
+	     << "  \"events_unique\": " << unique << ",\n"
+	     << "  \"events_lost\": " << lost << ",\n"
+	     << "  \"duplicates\": " << state->duplicates << ",\n"
+	     << "  \"corrupt\": " << state->corrupt << ",\n"
+	     << "  \"phantom\": " << state->phantom << ",\n"
+	     << "  \"evictions\": " << state->evictions << ",\n"
+	     << "  \"leaked_buffers\": " << leaked << ",\n"
+	     << "  \"faults\": {";
+	for (size_t ii = 0; ii < FAULT_TYPES; ++ii)
+	{
+		json << (ii > 0 ? ", " : "") << "\"" << FAULT_NAMES[ii] << "\": " << faultJson(faults[ii]);
+	}
+	json << "},\n  \"ok\": " << (ok ? "true" : "false") << "\n}\n";
+
+	if (options.output.empty())
+	{
+		std::cout << json.str();
+	}
+	else
+	{
+		std::ofstream(options.output) << json.str();
+	}
+
+	state->~SharedState();
+	munmap(mapping, sizeof(SharedState));
+	return ok ? 0 : 1;
+}
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+	Options options;
+	options.seed = artdaq::TimeUtils::gettimeofday_us();
+	for (int ii = 1; ii < argc; ++ii)
+	{
+		std::string arg = argv[ii];
+		auto value = [&]() { return ii + 1 < argc ? std::string(argv[++ii]) : std::string("0"); };
+		if (arg == "--writers")
+		{
+			options.writers = std::stoul(value());
+		}
+		else if (arg == "--readers")
+		{
+			options.readers = std::stoul(value());
+		}
+		else if (arg == "--duration-s")
+		{
+			options.duration_s = std::stoul(value());
+		}
+		else if (arg == "--buffers")
+		{
+			options.buffer_count = std::stoul(value());
+		}
+		else if (arg == "--buffer-size")
+		{
+			options.buffer_size = std::stoul(value(), nullptr, 0);
+		}
+		else if (arg == "--timeout-ms")
+		{
+			options.timeout_ms = std::stoul(value());
+		}
+		else if (arg == "--fault-interval-ms")
+		{
+			options.fault_interval_ms = std::stoul(value());
+		}
+		else if (arg == "--recovery-fraction")
+		{
+			options.recovery_fraction = std::stod(value());
+		}
+		else if (arg == "--seed")
+		{
+			options.seed = std::stoull(value());
+		}
+		else if (arg == "--output")
+		{
+			options.output = value();
+		}
+		else
+		{
+			std::cerr << "Usage: " << argv[0] << " [--writers N] [--readers M] [--duration-s T] [--buffers N] [--buffer-size B] [--timeout-ms T]"
+			          << " [--fault-interval-ms T] [--recovery-fraction F] [--seed S] [--output file.json]" << std::endl;
+			return 1;
+		}
+	}
+	if (options.writers == 0 || options.writers > MAX_WRITERS || options.readers == 0 || options.duration_s == 0 ||
+	    options.buffer_count == 0 || options.buffer_size < sizeof(RecordHeader) || options.timeout_ms == 0 || options.fault_interval_ms == 0)
+	{
+		std::cerr << "Between 1 and " << MAX_WRITERS << " writers, at least one reader, a buffer size of at least " << sizeof(RecordHeader)
+		          << " bytes and non-zero durations are required" << std::endl;
+		return 1;
+	}
+	TLOG(TLVL_INFO) << "Soak seed " << options.seed;
+	return runSoak(options);
+}
@@ -0,0 +1,247 @@
+#include "artdaq-core/Core/SocketBufferTransport.hh"
+#include "artdaq-core/Core/SharedMemoryManager.hh"
+
+#define BOOST_TEST_MODULE SocketBufferTransport_t
+#include "cetlib/quiet_unit_test.hpp"
+
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#define TRACE_NAME "SocketBufferTransport_t"
+#include "SharedMemoryTestShims.hh"
+#include "TRACE/tracemf.h"
+
+namespace {
+// The same consumer code works with a SharedMemoryManager or a SocketBufferClient
+template<typename Source>
+bool ReadOne(Source& source, std::vector<uint8_t>& out)
+{
+	if (!source.ReadyForRead())
+	{
+		return false;
+	}
+	auto buf = source.GetBufferForReading();
+	if (buf == -1)
+	{
+		return false;
+	}
+	out.resize(source.BufferDataSize(buf));
+	auto sts = source.Read(buf, out.data(), out.size());
+	source.MarkBufferEmpty(buf);
+	return sts;
+}
+
+void WriteOne(artdaq::SharedMemoryManager& shm, std::vector<uint8_t>& data)
+{
+	auto buf = shm.GetBufferForWriting(false);
+	BOOST_REQUIRE_NE(buf, -1);
+	shm.Write(buf, data.data(), data.size());
+	shm.MarkBufferFull(buf);
+}
+
+std::vector<uint8_t> MakeData(size_t size)
+{
+	std::vector<uint8_t> data(size);
+	uint8_t n = 0;
+	std::generate(data.begin(), data.end(), [&]() { return ++n; });
+	return data;
+}
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(SocketBufferTransport_test)
+
+BOOST_AUTO_TEST_CASE(UnixRead)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST UnixRead";
+	uint32_t key = GetRandomKey(0x7357);
+	artdaq::SharedMemoryManager writer(key, 4, 0x1000);
+	artdaq::SharedMemoryManager reader(key);
+
+	auto address = "unix:/tmp/SocketBufferTransport_t_" + std::to_string(getpid());
+	artdaq::SocketBufferServer server(reader, address);
+	BOOST_REQUIRE(server.IsRunning());
+	artdaq::SocketBufferClient client(address);
+	BOOST_REQUIRE(client.IsValid());
+	BOOST_REQUIRE_EQUAL(client.size(), 4);
+	BOOST_REQUIRE_EQUAL(client.BufferSize(), 0x1000);
+
+	std::vector<uint8_t> out;
+	BOOST_REQUIRE_EQUAL(ReadOne(client, out), false);
+
+	auto data = MakeData(0x1000);
+	WriteOne(writer, data);
+	WriteOne(writer, data);
+	BOOST_REQUIRE_EQUAL(ReadOne(client, out), true);
+	BOOST_REQUIRE(out == data);
+
+	// The release is batched with the next request
+	BOOST_REQUIRE_EQUAL(ReadOne(client, out), true);
+	BOOST_REQUIRE(out == data);
+	BOOST_REQUIRE_EQUAL(ReadOne(client, out), false);
+	BOOST_REQUIRE_EQUAL(writer.WriteReadyCount(false), 4);
+
+	// Reading past the end of the data is an error, but the connection survives
+	WriteOne(writer, data);
+	auto buf = client.GetBufferForReading();
+	BOOST_REQUIRE_NE(buf, -1);
+	BOOST_REQUIRE_EQUAL(client.Read(buf, out.data(), 0x800), true);
+	BOOST_REQUIRE_EQUAL(client.Read(buf, out.data(), 0x801), false);
+	BOOST_REQUIRE(client.IsValid());
+	client.MarkBufferEmpty(buf);
+	BOOST_REQUIRE(client.Flush());
+	TLOG(TLVL_DEBUG) << "END TEST UnixRead";
+}
+
+BOOST_AUTO_TEST_CASE(ChainedRead)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST ChainedRead";
+	uint32_t key = GetRandomKey(0x7357);
+	artdaq::SharedMemoryManager writer(key, 8, 0x1000);
+	artdaq::SharedMemoryManager reader(key);
+	writer.SetMaxChainLength(3);
+
+	auto address = "unix:/tmp/SocketBufferTransport_t_" + std::to_string(getpid());
+	artdaq::SocketBufferServer server(reader, address);
+	artdaq::SocketBufferClient client(address);
+	BOOST_REQUIRE(client.IsValid());
+
+	// The event spans three buffers, and is sent from each of them
+	auto data = MakeData(0x2800);
+	WriteOne(writer, data);
+	std::vector<uint8_t> out;
+	BOOST_REQUIRE_EQUAL(ReadOne(client, out), true);
+	BOOST_REQUIRE(out == data);
+
+	// Reads may cross the boundary between chained buffers, and are limited by the size of the whole chain
+	WriteOne(writer, data);
+	auto buf = client.GetBufferForReading();
+	BOOST_REQUIRE_NE(buf, -1);
+	BOOST_REQUIRE_EQUAL(client.BufferDataSize(buf), data.size());
+	out.assign(data.size(), 0);
+	BOOST_REQUIRE_EQUAL(client.Read(buf, out.data(), 0xF00), true);
+	BOOST_REQUIRE_EQUAL(client.Read(buf, out.data() + 0xF00, 0x1200), true);
+	BOOST_REQUIRE_EQUAL(client.Read(buf, out.data() + 0x2100, 0x800), false);
+	BOOST_REQUIRE(client.IsValid());
+	BOOST_REQUIRE_EQUAL(client.Read(buf, out.data() + 0x2100, 0x700), true);
+	BOOST_REQUIRE(out == data);
+	client.MarkBufferEmpty(buf);
+	BOOST_REQUIRE(client.Flush());
+	// Flush does not wait for the server to process the releases
+	for (int tries = 0; tries < 1000 && writer.WriteReadyCount(false) < 8; ++tries)
+	{
+		usleep(1000);
+	}
+	BOOST_REQUIRE_EQUAL(writer.WriteReadyCount(false), 8);
+	TLOG(TLVL_DEBUG) << "END TEST ChainedRead";
+}
+
+BOOST_AUTO_TEST_CASE(TcpWrite)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST TcpWrite";
+	uint32_t key = GetRandomKey(0x7357);
+	artdaq::SharedMemoryManager owner(key, 4, 0x10000);
+	artdaq::SharedMemoryManager reader(key);
+
+	artdaq::SocketBufferServer server(owner, "tcp:127.0.0.1:0", true);
+	BOOST_REQUIRE(server.IsRunning());
+	BOOST_REQUIRE_NE(server.GetPort(), 0);
+	artdaq::SocketBufferClient client("tcp:127.0.0.1:" + std::to_string(server.GetPort()));
+	BOOST_REQUIRE(client.IsValid());
+
+	auto data = MakeData(0x10000);
+	BOOST_REQUIRE(client.ReadyForWrite(false));
+	auto buf = client.GetBufferForWriting(false);
+	BOOST_REQUIRE_NE(buf, -1);
+	BOOST_REQUIRE_EQUAL(client.Write(buf, data.data(), 0x8000), 0x8000);
+	BOOST_REQUIRE_EQUAL(client.Write(buf, data.data() + 0x8000, 0x8000), 0x8000);
+	// Writing more than fits is rejected without detaching the server's shared memory
+	BOOST_REQUIRE_EQUAL(client.Write(buf, data.data(), 1), 0);
+	BOOST_REQUIRE_EQUAL(client.BufferDataSize(buf), 0x10000);
+	client.MarkBufferFull(buf);
+	BOOST_REQUIRE(client.Flush());
+
+	std::vector<uint8_t> out;
+	while (!reader.ReadyForRead())
+	{
+		usleep(1000);
+	}
+	BOOST_REQUIRE_EQUAL(ReadOne(reader, out), true);
+	BOOST_REQUIRE(out == data);
+	BOOST_REQUIRE(owner.IsValid());
+	TLOG(TLVL_DEBUG) << "END TEST TcpWrite";
+}
+
+BOOST_AUTO_TEST_CASE(TcpZeroCopyRead)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST TcpZeroCopyRead";
+	uint32_t key = GetRandomKey(0x7357);
+	artdaq::SharedMemoryManager writer(key, 4, 0x40000);
+	artdaq::SharedMemoryManager reader(key);
+
+	artdaq::SocketBufferServer server(reader, "tcp:127.0.0.1:0", true);
+	artdaq::SocketBufferClient client("tcp:127.0.0.1:" + std::to_string(server.GetPort()));
+	BOOST_REQUIRE(client.IsValid());
+
+	auto data = MakeData(0x40000);
+	std::vector<uint8_t> out;
+	for (int ii = 0; ii < 10; ++ii)
+	{
+		WriteOne(writer, data);
+		BOOST_REQUIRE_EQUAL(ReadOne(client, out), true);
+		BOOST_REQUIRE(out == data);
+	}
+	BOOST_REQUIRE(client.Flush());
+	TLOG(TLVL_DEBUG) << "END TEST TcpZeroCopyRead";
+}
+
+BOOST_AUTO_TEST_CASE(Disconnect)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST Disconnect";
+	uint32_t key = GetRandomKey(0x7357);
+	artdaq::SharedMemoryManager owner(key, 2, 0x1000);
+
+	auto address = "unix:/tmp/SocketBufferTransport_t_" + std::to_string(getpid());
+	artdaq::SocketBufferServer server(owner, address);
+	{
+		artdaq::SocketBufferClient client(address);
+		BOOST_REQUIRE_NE(client.GetBufferForWriting(false), -1);
+		BOOST_REQUIRE_NE(client.GetBufferForWriting(false), -1);
+		BOOST_REQUIRE_EQUAL(owner.WriteReadyCount(false), 0);
+		BOOST_REQUIRE_EQUAL(server.GetConnectionCount(), 1);
+	}
+
+	// Buffers held by a client are released when it disconnects
+	for (int ii = 0; ii < 1000 && server.GetConnectionCount() > 0; ++ii)
+	{
+		usleep(1000);
+	}
+	BOOST_REQUIRE_EQUAL(server.GetConnectionCount(), 0);
+	BOOST_REQUIRE_EQUAL(owner.WriteReadyCount(false), 2);
+
+	// An event a client was reading when it disconnected is not lost
+	auto data = MakeData(0x1000);
+	WriteOne(owner, data);
+	{
+		artdaq::SocketBufferClient client(address);
+		BOOST_REQUIRE_NE(client.GetBufferForReading(), -1);
+		BOOST_REQUIRE_EQUAL(owner.ReadReadyCount(), 0);
+	}
+	for (int ii = 0; ii < 1000 && server.GetConnectionCount() > 0; ++ii)
+	{
+		usleep(1000);
+	}
+	BOOST_REQUIRE_EQUAL(owner.ReadReadyCount(), 1);
+	{
+		artdaq::SocketBufferClient client(address);
+		std::vector<uint8_t> out;
+		BOOST_REQUIRE_EQUAL(ReadOne(client, out), true);
+		BOOST_REQUIRE(out == data);
+	}
+
+	BOOST_REQUIRE_EQUAL(artdaq::SocketBufferClient("unix:/tmp/SocketBufferTransport_t_nonexistent", 1000).IsValid(), false);
+	TLOG(TLVL_DEBUG) << "END TEST Disconnect";
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,58 @@
+#include "artdaq-core/Core/WaitPolicy.hh"
+
+#define BOOST_TEST_MODULE WaitPolicy_t
+#include "cetlib/quiet_unit_test.hpp"
+
+#define TRACE_NAME "WaitPolicy_t"
+#include "TRACE/tracemf.h"
+
+BOOST_AUTO_TEST_SUITE(WaitPolicy_test)
+
+BOOST_AUTO_TEST_CASE(Construct)
+{
+	artdaq::WaitPolicy policy(10, 20, 30, 40);
+	BOOST_REQUIRE_EQUAL(policy.SpinMicroseconds(), 10);
+	BOOST_REQUIRE_EQUAL(policy.YieldMicroseconds(), 20);
+	BOOST_REQUIRE_EQUAL(policy.MinSleepMicroseconds(), 30);
+	BOOST_REQUIRE_EQUAL(policy.MaxSleepMicroseconds(), 40);
+
+	// Maximum sleep is never less than the minimum
+	artdaq::WaitPolicy inverted(0, 0, 1000, 10);
+	BOOST_REQUIRE_EQUAL(inverted.MaxSleepMicroseconds(), 1000);
+
+	BOOST_REQUIRE_EQUAL(artdaq::WaitPolicy::Idle().SpinMicroseconds(), 0);
+	BOOST_REQUIRE_EQUAL(artdaq::WaitPolicy::Idle().MaxSleepMicroseconds(), 5000000);
+}
+
+BOOST_AUTO_TEST_CASE(Spin)
+{
+	auto waiter = artdaq::WaitPolicy(100000, 0, 1000000, 1000000).MakeWaiter();
+	BOOST_REQUIRE(waiter.Spinning());
+	size_t count = 0;
+	while (waiter.Spinning())
+	{
+		waiter.Wait();
+		++count;
+	}
+	TLOG(TLVL_INFO) << "Spun " << count << " times in " << waiter.ElapsedMicroseconds() << " us";
+	// A spinning wait never sleeps, so it should not overshoot by the sleep time
+	BOOST_REQUIRE_LT(waiter.ElapsedMicroseconds(), 1000000);
+	BOOST_REQUIRE_GT(count, 1);
+}
+
+BOOST_AUTO_TEST_CASE(Backoff)
+{
+	auto waiter = artdaq::WaitPolicy(0, 0, 10000, 40000).MakeWaiter();
+	BOOST_REQUIRE(!waiter.Spinning());
+
+	// Sleeps of 10, 20, 40 and 40 ms
+	for (int ii = 0; ii < 4; ++ii)
+	{
+		waiter.Wait();
+	}
+	auto elapsed = waiter.ElapsedMicroseconds();
+	TLOG(TLVL_INFO) << "Four backoff waits took " << elapsed << " us";
+	BOOST_REQUIRE_GE(elapsed, 110000);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
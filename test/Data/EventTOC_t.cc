@@ -0,0 +1,74 @@
+#include "artdaq-core/Data/EventTOC.hh"
+
+#define BOOST_TEST_MODULE(EventTOC_t)
+#include <cetlib/quiet_unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(EventTOC_test)
+
+BOOST_AUTO_TEST_CASE(Make)
+{
+	artdaq::FragmentPtrs frags;
+	for (int ii = 0; ii < 3; ++ii)
+	{
+		frags.emplace_back(new artdaq::Fragment(10 * ii));
+		frags.back()->setSequenceID(5);
+		frags.back()->setFragmentID(100 + ii);
+		frags.back()->setUserType(1 + ii);
+	}
+
+	auto frag = artdaq::EventTOC::Make(5, frags);
+	BOOST_REQUIRE_EQUAL(frag.type(), artdaq::Fragment::EventTOCFragmentType);
+	BOOST_REQUIRE_EQUAL(frag.typeString(), std::to_string(artdaq::Fragment::EventTOCFragmentType) + " (EventTOC)");
+	BOOST_REQUIRE_EQUAL(frag.sequenceID(), 5);
+	BOOST_REQUIRE_EQUAL(frag.size(), artdaq::EventTOC::SizeWords(3));
+
+	artdaq::FragmentView view(frag);
+	artdaq::EventTOC toc(view);
+	BOOST_REQUIRE_EQUAL(toc.size(), 3);
+	auto offset = sizeof(artdaq::detail::RawEventHeader) + frag.sizeBytes();
+	size_t ii = 0;
+	for (auto const& f : frags)
+	{
+		BOOST_REQUIRE_EQUAL(toc[ii].offset, offset);
+		BOOST_REQUIRE_EQUAL(toc[ii].word_count, f->size());
+		BOOST_REQUIRE_EQUAL(toc[ii].fragment_id, f->fragmentID());
+		BOOST_REQUIRE_EQUAL(toc[ii].type, f->type());
+		offset += f->sizeBytes();
+		++ii;
+	}
+	BOOST_REQUIRE_EQUAL(toc.end() - toc.begin(), 3);
+
+	artdaq::Fragments copies;
+	for (auto const& f : frags)
+	{
+		copies.push_back(*f);
+	}
+	auto frag2 = artdaq::EventTOC::Make(5, copies);
+	BOOST_REQUIRE(std::equal(frag.dataBegin(), frag.dataEnd(), frag2.dataBegin()));
+}
+
+BOOST_AUTO_TEST_CASE(Empty)
+{
+	auto frag = artdaq::EventTOC::Make(1, artdaq::Fragments());
+	BOOST_REQUIRE_EQUAL(frag.dataSize(), 1);
+	artdaq::FragmentView view(frag);
+	artdaq::EventTOC toc(view);
+	BOOST_REQUIRE_EQUAL(toc.size(), 0);
+	BOOST_REQUIRE(toc.begin() == toc.end());
+}
+
+BOOST_AUTO_TEST_CASE(Malformed)
+{
+	artdaq::Fragment data(4);
+	data.setUserType(1);
+	artdaq::FragmentView data_view(data);
+	BOOST_REQUIRE_THROW(artdaq::EventTOC toc(data_view), cet::exception);
+
+	artdaq::Fragments frags(2, artdaq::Fragment(3));
+	auto frag = artdaq::EventTOC::Make(1, frags);
+	frag.resize(frag.dataSize() - 1);
+	artdaq::FragmentView short_view(frag);
+	BOOST_REQUIRE_THROW(artdaq::EventTOC toc(short_view), cet::exception);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
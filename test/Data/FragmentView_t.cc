@@ -0,0 +1,123 @@
+#include "artdaq-core/Data/FragmentView.hh"
+#include "artdaq-core/Data/detail/RawFragmentHeader.hh"
+
+#define BOOST_TEST_MODULE(FragmentView_t)
+#include <cetlib/quiet_unit_test.hpp>
+
+/**
+ * \brief Test Metadata with three fields in two long words
+ */
+struct MetadataTypeOne
+{
+	uint64_t field1;  ///< 1. A 64-bit field
+	uint32_t field2;  ///< 2. A 32-bit field
+	uint32_t field3;  ///< 3. A 32-bit field
+};
+
+BOOST_AUTO_TEST_SUITE(FragmentView_test)
+
+BOOST_AUTO_TEST_CASE(Accessors)
+{
+	MetadataTypeOne md = {5, 6, 7};
+	artdaq::Fragment f(7, 0xFEED, 0xBEE7, 0x10, md, 0xCAFE);
+	for (size_t ii = 0; ii < f.dataSize(); ++ii)
+	{
+		*(f.dataBegin() + ii) = ii + 1;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	}
+
+	artdaq::FragmentView v(f);
+	BOOST_REQUIRE_EQUAL(v.size(), f.size());
+	BOOST_REQUIRE_EQUAL(v.sizeBytes(), f.sizeBytes());
+	BOOST_REQUIRE_EQUAL(v.version(), f.version());
+	BOOST_REQUIRE_EQUAL(v.type(), f.type());
+	BOOST_REQUIRE_EQUAL(v.typeString(), f.typeString());
+	BOOST_REQUIRE_EQUAL(v.sequenceID(), f.sequenceID());
+	BOOST_REQUIRE_EQUAL(v.fragmentID(), f.fragmentID());
+	BOOST_REQUIRE_EQUAL(v.timestamp(), f.timestamp());
+	BOOST_REQUIRE_EQUAL(v.dataSize(), f.dataSize());
+	BOOST_REQUIRE_EQUAL(v.dataSizeBytes(), f.dataSizeBytes());
+	BOOST_REQUIRE_EQUAL(v.headerSizeWords(), f.headerSizeWords());
+	BOOST_REQUIRE_EQUAL(v.hasMetadata(), true);
+	BOOST_REQUIRE_EQUAL(v.metadata<MetadataTypeOne>()->field3, 7);
+
+	// The view points into the Fragment's own memory
+	BOOST_REQUIRE_EQUAL(v.headerBegin(), &*f.headerBegin());
+	BOOST_REQUIRE_EQUAL(v.dataBegin(), &*f.dataBegin());
+	BOOST_REQUIRE_EQUAL(v.dataEnd(), &*f.dataEnd());
+	BOOST_REQUIRE_EQUAL(static_cast<void const*>(v.dataBeginBytes()), static_cast<void const*>(f.dataBeginBytes()));
+	BOOST_REQUIRE_EQUAL(static_cast<void const*>(v.dataEndBytes()), static_cast<void const*>(f.dataEndBytes()));
+
+	artdaq::Fragment empty;
+	artdaq::FragmentView ev(empty);
+	BOOST_REQUIRE_EQUAL(ev.dataSize(), 0);
+	BOOST_REQUIRE_EQUAL(ev.hasMetadata(), false);
+	BOOST_REQUIRE_THROW(ev.metadata<MetadataTypeOne>(), cet::exception);
+}
+
+BOOST_AUTO_TEST_CASE(Materialize)
+{
+	artdaq::Fragment f(7);
+	f.setSequenceID(0xFEED);
+	f.setFragmentID(0xBEE7);
+	f.setUserType(0x10);
+	for (size_t ii = 0; ii < f.dataSize(); ++ii)
+	{
+		*(f.dataBegin() + ii) = ii + 1;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	}
+
+	artdaq::FragmentView v(f);
+	auto copy = v.materialize();
+	BOOST_REQUIRE_NE(&*copy.headerBegin(), v.headerBegin());
+	BOOST_REQUIRE_EQUAL(copy.size(), f.size());
+	BOOST_REQUIRE_EQUAL(copy.sequenceID(), f.sequenceID());
+	BOOST_REQUIRE_EQUAL(copy.fragmentID(), f.fragmentID());
+	BOOST_REQUIRE_EQUAL(copy.type(), f.type());
+
+	// The copy is independent of the viewed memory
+	*f.dataBegin() = 0xDEAD;
+	BOOST_REQUIRE_EQUAL(*v.dataBegin(), 0xDEAD);
+	BOOST_REQUIRE_EQUAL(*copy.dataBegin(), 1);
+	for (size_t jj = 1; jj < copy.dataSize(); ++jj)
+	{
+		BOOST_REQUIRE_EQUAL(*(copy.dataBegin() + jj), jj + 1);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	}
+}
+
+BOOST_AUTO_TEST_CASE(Upgrade_V1)
+{
+	artdaq::Fragment f(7);
+	artdaq::detail::RawFragmentHeaderV1 hdr1;
+
+	hdr1.word_count = artdaq::detail::RawFragmentHeader::num_words() + 7;
+	hdr1.version = 1;
+	hdr1.type = 0xFE;
+	hdr1.metadata_word_count = 0;
+
+	hdr1.sequence_id = 0xFEEDDEADBEEF;
+	hdr1.fragment_id = 0xBEE7;
+	hdr1.timestamp = 0xCAFEFECAAAAABBBB;
+
+	memcpy(f.headerBeginBytes(), &hdr1, sizeof(hdr1));
+
+	artdaq::detail::RawFragmentHeader::RawDataType counter = 0;
+	for (size_t ii = artdaq::detail::RawFragmentHeaderV1::num_words(); ii < artdaq::detail::RawFragmentHeader::num_words() + 7; ++ii)
+	{
+		memcpy(f.headerBegin() + ii, &(++counter), sizeof(counter));
+	}
+
+	artdaq::FragmentView v(f);
+	BOOST_REQUIRE_EQUAL(v.version(), 1);
+	BOOST_REQUIRE_EQUAL(v.type(), 0xFE);
+	BOOST_REQUIRE_EQUAL(v.hasMetadata(), false);
+	BOOST_REQUIRE_EQUAL(v.sequenceID(), 0xFEEDDEADBEEF);
+	BOOST_REQUIRE_EQUAL(v.fragmentID(), 0xBEE7);
+	BOOST_REQUIRE_EQUAL(v.timestamp(), 0xCAFEFECAAAAABBBB);
+	BOOST_REQUIRE_EQUAL(v.dataSize(), f.dataSize());
+
+	for (size_t jj = 0; jj < v.dataSize(); ++jj)
+	{
+		BOOST_REQUIRE_EQUAL(*(v.dataBegin() + jj), jj + 1);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
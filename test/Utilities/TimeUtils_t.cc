@@ -2,6 +2,7 @@
 
 #define BOOST_TEST_MODULE TimeUtils_t
 #include <cmath>
+#include <unistd.h>
 #include "cetlib/quiet_unit_test.hpp"
 
 #define TRACE_NAME "TimeUtils_t"
@@ -74,4 +75,22 @@ BOOST_AUTO_TEST_CASE(GetTimeOfDayUS)
 	BOOST_REQUIRE_EQUAL(now / 1000000, ts.tv_sec);
 }
 
+BOOST_AUTO_TEST_CASE(MonotonicCoarseUS)
+{
+	auto then = artdaq::TimeUtils::gettime_monotonic_coarse_us();
+	usleep(50000);
+	auto now = artdaq::TimeUtils::gettime_monotonic_coarse_us();
+	BOOST_REQUIRE_GE(now, then);
+	// Allow for one kernel tick of resolution on either end
+	BOOST_REQUIRE_GE(now - then, 40000);
+
+	auto start = std::chrono::steady_clock::now();
+	for (int ii = 0; ii < 1000000; ++ii)
+	{
+		artdaq::TimeUtils::gettime_monotonic_coarse_us();
+	}
+	auto dur = artdaq::TimeUtils::GetElapsedTime(start);
+	TLOG(TLVL_INFO) << "Time to call gettime_monotonic_coarse_us 1000000 times: " << dur << " s ( ave: " << dur / 1000000 << " s/call ).";
+}
+
 BOOST_AUTO_TEST_SUITE_END()